@@ -10,7 +10,15 @@ workspace "stereogram-model-viewer"
 	configurations { "Debug", "Release" }
 	platforms { "x32", "x64" }
 
-	buildoptions "/std:c++latest"
+	-- The benchmark and the console tools also build with gcc and clang, e.g. premake5 gmake2 on Linux
+	filter "toolset:msc*"
+		buildoptions { "/std:c++latest", "/Zm100" }
+	filter "toolset:not msc*"
+		cppdialect "C++17"
+		buildoptions { "-Wno-unknown-pragmas" }
+	filter "system:linux"
+		links { "pthread" }
+	filter {}
 
 	configuration "windows"
 		defines { "_WINDOWS", "WIN32" }
@@ -32,6 +40,15 @@ workspace "stereogram-model-viewer"
 		flags { "MultiProcessorCompile" }
 		optimize "Debug"
 
+	-- AVX2 kernels are dispatched at runtime, only their own files get AVX2 code generation
+	filter "files:**_avx2.cpp"
+		flags { "NoPCH" }
+	filter { "files:**_avx2.cpp", "toolset:msc*" }
+		buildoptions { "/arch:AVX2" }
+	filter { "files:**_avx2.cpp", "toolset:not msc*" }
+		buildoptions { "-mavx2" }
+	filter {}
+
 	project "stereogram-model-viewer"
 		kind "WindowedApp"
 		language "C++"
@@ -40,6 +57,11 @@ workspace "stereogram-model-viewer"
 			"./src/**.hpp",
 			"./src/**.cpp",
 		}
+		removefiles {
+			"./src/cli/**",
+			"./src/benchmark/**",
+			"./src/bake/**",
+		}
 		includedirs {
 			"./src"
 		}
@@ -50,7 +72,6 @@ workspace "stereogram-model-viewer"
 		-- Pre-compiled header
 		pchheader "std_include.hpp" -- must be exactly same as used in #include directives
 		pchsource "src/std_include.cpp" -- real path
-		buildoptions { "/Zm100 -Zm100" }
 
 		vpaths {
 			["Docs/*"] = { "**.txt","**.md" },
@@ -69,6 +90,113 @@ workspace "stereogram-model-viewer"
 		glew.import()
 		glfw.import()
 
+	project "stereogram-cli"
+		kind "ConsoleApp"
+		language "C++"
+		files {
+			"./src/cli/**.cpp",
+			"./src/std_include.*",
+			"./src/synthesizer.*",
+			"./src/simd*.*",
+			"./src/thread_pool.*",
+			"./src/image.*",
+			"./src/random.hpp",
+		}
+		includedirs {
+			"./src"
+		}
+
+		-- Pre-compiled header
+		pchheader "std_include.hpp" -- must be exactly same as used in #include directives
+		pchsource "src/std_include.cpp" -- real path
+
+		-- Specific configurations
+		flags { "UndefinedIdentifiers", "ExtraWarnings" }
+
+		configuration "Release*"
+			flags { "FatalCompileWarnings" }
+		configuration {}
+
+		-- The engine is headless, GL headers are only needed by the shared pre-compiled header
+		gsl.includes()
+		glm.includes()
+		glew.includes()
+		glfw.includes()
+
+	project "stereogram-bench"
+		kind "ConsoleApp"
+		language "C++"
+		files {
+			"./src/benchmark/**.cpp",
+			"./src/std_include.*",
+			"./src/thread_pool.*",
+			"./src/mesh.hpp",
+			"./src/mapped_file.*",
+			"./src/obj_loader.*",
+			"./src/mapped_obj_loader.*",
+			"./src/mesh_optimizer.*",
+			"./src/mesh_simplifier.*",
+			"./src/mesh_clusters.*",
+			"./src/depth_rasterizer.*",
+			"./src/synthesizer.*",
+			"./src/simd*.*",
+			"./src/random.hpp",
+		}
+		includedirs {
+			"./src"
+		}
+
+		-- Pre-compiled header
+		pchheader "std_include.hpp" -- must be exactly same as used in #include directives
+		pchsource "src/std_include.cpp" -- real path
+
+		-- Specific configurations
+		flags { "UndefinedIdentifiers", "ExtraWarnings" }
+
+		configuration "Release*"
+			flags { "FatalCompileWarnings" }
+		configuration {}
+
+		-- Headless as well, GL headers are only needed by the shared pre-compiled header
+		gsl.includes()
+		glm.includes()
+		glew.includes()
+		glfw.includes()
+
+	project "stereogram-bake"
+		kind "ConsoleApp"
+		language "C++"
+		files {
+			"./src/bake/**.cpp",
+			"./src/std_include.*",
+			"./src/thread_pool.*",
+			"./src/mesh.hpp",
+			"./src/mesh_cache.*",
+			"./src/mapped_file.*",
+			"./src/mapped_obj_loader.*",
+			"./src/mesh_optimizer.*",
+			"./src/mesh_simplifier.*",
+		}
+		includedirs {
+			"./src"
+		}
+
+		-- Pre-compiled header
+		pchheader "std_include.hpp" -- must be exactly same as used in #include directives
+		pchsource "src/std_include.cpp" -- real path
+
+		-- Specific configurations
+		flags { "UndefinedIdentifiers", "ExtraWarnings" }
+
+		configuration "Release*"
+			flags { "FatalCompileWarnings" }
+		configuration {}
+
+		gsl.includes()
+		glm.includes()
+		glew.includes()
+		glfw.includes()
+
 	group "Dependencies"
 		glew.project()
 		glfw.project()
\ No newline at end of file
@@ -0,0 +1,437 @@
+#include "std_include.hpp"
+
+#include "animation_exporter.hpp"
+#include "context_saver.hpp"
+#include "gl_state.hpp"
+
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+namespace
+{
+	constexpr char y4m_frame_header[] = "FRAME\n";
+	constexpr size_t y4m_frame_header_size = sizeof(y4m_frame_header) - 1;
+
+	// BT.601 limited range in 8 bit fixed point
+	unsigned char get_luma(int r, int g, int b)
+	{
+		return static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+	}
+
+	unsigned char get_blue_difference(int r, int g, int b)
+	{
+		return static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+	}
+
+	unsigned char get_red_difference(int r, int g, int b)
+	{
+		return static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+	}
+
+	double get_elapsed_seconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+animation_exporter::animation_exporter(camera* _camera_object, painter_list* _scene, settings settings) :
+	camera_object(_camera_object), scene(_scene), options(std::move(settings))
+{
+	if (this->options.width <= 0 || this->options.height <= 0) throw std::runtime_error("Invalid export size");
+	if (!std::isfinite(this->options.fps) || this->options.fps <= 0.0) throw std::runtime_error("Invalid export frame rate");
+
+	this->create_targets();
+}
+
+animation_exporter::~animation_exporter()
+{
+	this->stop_threads();
+	this->destroy_targets();
+}
+
+void animation_exporter::run(const camera_path& path)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	// Both ends of the path are included
+	const auto last_frame = std::floor(path.get_duration() * this->options.fps + 1e-9);
+	if (!(last_frame >= 0.0 && last_frame < std::numeric_limits<int>::max()))
+	{
+		throw std::runtime_error("Too many frames to export, lower the frame rate or shorten the camera path");
+	}
+
+	this->frame_count = static_cast<int>(last_frame) + 1;
+	this->next_frame = 0;
+
+	this->open_output();
+
+	auto worker_count = this->options.threads ? this->options.threads : std::thread::hardware_concurrency();
+	worker_count = std::max(1u, worker_count);
+
+	// One frame per worker is synthesized while the next ones wait for a worker or the writer
+	this->slots.assign(static_cast<size_t>(worker_count) * 2, slot{});
+	for (auto& target : this->slots)
+	{
+		target.shifts.resize(static_cast<size_t>(this->options.width) * this->options.height);
+	}
+
+	this->start_threads(worker_count);
+
+	try
+	{
+		auto last_report = start;
+
+		for (int i = 0; i < this->frame_count; ++i)
+		{
+			slot* target = nullptr;
+
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->changed.wait(lock, [&]()
+				{
+					target = this->find(state::empty);
+					return this->error || target;
+				});
+
+				if (this->error) std::rethrow_exception(this->error);
+			}
+
+			// Only this thread touches empty slots
+			target->index = i;
+			this->render(*target, path);
+
+			{
+				std::lock_guard<std::mutex> _(this->mutex);
+				target->current = state::queued;
+			}
+
+			this->changed.notify_all();
+
+			// Keeps the window responsive, nothing is painted into it meanwhile
+			glfwPollEvents();
+
+			if (get_elapsed_seconds(last_report) >= 1.0)
+			{
+				last_report = std::chrono::high_resolution_clock::now();
+				fprintf(stderr, "Rendered %d of %d frames, %.1f fps\n", i + 1, this->frame_count, (i + 1) / get_elapsed_seconds(start));
+			}
+		}
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->changed.wait(lock, [this]()
+		{
+			return this->error || this->next_frame == this->frame_count;
+		});
+
+		if (this->error) std::rethrow_exception(this->error);
+	}
+	catch (...)
+	{
+		this->stop_threads();
+		throw;
+	}
+
+	this->stop_threads();
+
+	this->output->flush();
+	if (!*this->output) throw std::runtime_error("Unable to write the animation");
+
+	this->stats.frames = this->frame_count;
+	this->stats.seconds = get_elapsed_seconds(start);
+
+	fprintf(stderr, "Exported %d frames of %dx%d in %.2f s, %.1f fps end to end with %u worker(s)\n", this->stats.frames,
+		this->options.width, this->options.height, this->stats.seconds, this->stats.frames / this->stats.seconds, worker_count);
+}
+
+const animation_exporter::statistics& animation_exporter::get_statistics() const
+{
+	return this->stats;
+}
+
+void animation_exporter::create_targets()
+{
+	context_saver _;
+
+	glGenRenderbuffers(1, &this->color_buffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, this->color_buffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, this->options.width, this->options.height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	// Sampled by the depth reduction directly, no copy needed
+	glGenTextures(1, &this->depth_texture);
+	gl_state::bind_texture_2d(this->depth_texture);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, this->options.width, this->options.height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+
+	glGenFramebuffers(1, &this->framebuffer);
+	gl_state::bind_framebuffer(this->framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->color_buffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->depth_texture, 0);
+
+	const auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		throw std::runtime_error("Incomplete export framebuffer: " + std::to_string(status));
+	}
+}
+
+void animation_exporter::destroy_targets()
+{
+	gl_state::delete_framebuffer(this->framebuffer);
+	gl_state::delete_texture(this->depth_texture);
+
+	if (this->color_buffer) glDeleteRenderbuffers(1, &this->color_buffer);
+
+	this->framebuffer = 0;
+	this->depth_texture = 0;
+	this->color_buffer = 0;
+}
+
+void animation_exporter::open_output()
+{
+	if (this->options.output == "-")
+	{
+#ifdef _WIN32
+		// Line endings would be translated otherwise
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		this->output = &std::cout;
+	}
+	else
+	{
+		this->file = std::ofstream(this->options.output, std::ios::binary | std::ios::trunc);
+		if (!this->file) throw std::runtime_error("Unable to open " + this->options.output);
+
+		this->output = &this->file;
+	}
+
+	if (this->options.output_format == format::y4m)
+	{
+		// Frame rates are written in milliframes per second, exact for integer and NTSC-like rates
+		*this->output << "YUV4MPEG2 W" << this->options.width << " H" << this->options.height
+			<< " F" << std::llround(this->options.fps * 1000.0) << ":1000 Ip A1:1 C444\n";
+	}
+}
+
+void animation_exporter::start_threads(unsigned int worker_count)
+{
+	for (unsigned int i = 0; i < worker_count; ++i)
+	{
+		this->workers.emplace_back([this]()
+		{
+			this->work();
+		});
+	}
+
+	this->writer = std::thread([this]()
+	{
+		this->write();
+	});
+}
+
+void animation_exporter::stop_threads()
+{
+	{
+		std::lock_guard<std::mutex> _(this->mutex);
+		this->stopping = true;
+	}
+
+	this->changed.notify_all();
+
+	for (auto& worker : this->workers)
+	{
+		worker.join();
+	}
+
+	if (this->writer.joinable())
+	{
+		this->writer.join();
+	}
+
+	this->workers.clear();
+	this->stopping = false;
+}
+
+void animation_exporter::render(slot& target, const camera_path& path)
+{
+	context_saver _;
+
+	gl_state::bind_framebuffer(this->framebuffer);
+	gl_state::set_viewport({ 0, 0, this->options.width, this->options.height });
+
+	this->camera_object->set_path(&path);
+	this->camera_object->set_path_time(target.index / this->options.fps);
+	this->camera_object->paint();
+	this->camera_object->set_path(nullptr);
+
+	this->scene->paint();
+
+	// Synchronous, the workers overlap the synthesis with the next frames instead
+	const auto shifts = this->reduction.read_shifts(this->depth_texture, this->options.width, this->options.height, this->options.pattern_div, this->readback);
+	std::memcpy(target.shifts.data(), shifts, target.shifts.size() * sizeof(synthesizer::shift));
+}
+
+void animation_exporter::work()
+{
+	try
+	{
+		// The workers only share the seed, select_pattern makes every frame independent of the one before
+		synthesizer engine(this->options.width, this->options.height, this->options.pattern_div);
+		engine.set_seed(this->options.seed);
+
+		std::vector<synthesizer::color> colors(static_cast<size_t>(this->options.width) * this->options.height);
+
+		while (true)
+		{
+			slot* target = nullptr;
+
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->changed.wait(lock, [&]()
+				{
+					target = this->find(state::queued);
+					return this->stopping || target;
+				});
+
+				if (this->stopping) return;
+				target->current = state::synthesizing;
+			}
+
+			engine.select_pattern(this->options.stable_pattern ? 0 : static_cast<unsigned int>(target->index));
+			engine.synthesize(gsl::span<const synthesizer::shift>(target->shifts), colors);
+
+			this->convert(colors, target->payload);
+
+			{
+				std::lock_guard<std::mutex> _(this->mutex);
+				target->current = state::synthesized;
+			}
+
+			this->changed.notify_all();
+		}
+	}
+	catch (...)
+	{
+		this->fail(std::current_exception());
+	}
+}
+
+void animation_exporter::write()
+{
+	try
+	{
+		while (true)
+		{
+			slot* target = nullptr;
+
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->changed.wait(lock, [&]()
+				{
+					target = this->find(state::synthesized);
+					return this->stopping || (target && target->index == this->next_frame);
+				});
+
+				if (this->stopping) return;
+			}
+
+			// Nobody else touches synthesized slots
+			this->output->write(reinterpret_cast<const char*>(target->payload.data()), static_cast<std::streamsize>(target->payload.size()));
+			if (!*this->output) throw std::runtime_error("Unable to write the animation");
+
+			{
+				std::lock_guard<std::mutex> _(this->mutex);
+				target->current = state::empty;
+				++this->next_frame;
+			}
+
+			this->changed.notify_all();
+		}
+	}
+	catch (...)
+	{
+		this->fail(std::current_exception());
+	}
+}
+
+void animation_exporter::convert(const std::vector<synthesizer::color>& colors, std::vector<unsigned char>& payload) const
+{
+	const auto width = static_cast<size_t>(this->options.width);
+	const auto height = static_cast<size_t>(this->options.height);
+	const auto plane_size = width * height;
+
+	// Read back rows start at the bottom, files start at the top
+	const auto get_row = [&](size_t y)
+	{
+		return colors.data() + (height - 1 - y) * width;
+	};
+
+	if (this->options.output_format == format::rgb)
+	{
+		payload.resize(plane_size * sizeof(synthesizer::color));
+
+		for (size_t y = 0; y < height; ++y)
+		{
+			std::memcpy(payload.data() + y * width * sizeof(synthesizer::color), get_row(y), width * sizeof(synthesizer::color));
+		}
+
+		return;
+	}
+
+	payload.resize(y4m_frame_header_size + plane_size * 3);
+	std::memcpy(payload.data(), y4m_frame_header, y4m_frame_header_size);
+
+	auto luma = payload.data() + y4m_frame_header_size;
+	auto blue_difference = luma + plane_size;
+	auto red_difference = blue_difference + plane_size;
+
+	for (size_t y = 0; y < height; ++y)
+	{
+		const auto row = get_row(y);
+
+		for (size_t x = 0; x < width; ++x)
+		{
+			const auto& pixel = row[x];
+			const auto offset = y * width + x;
+
+			luma[offset] = get_luma(pixel.r, pixel.g, pixel.b);
+			blue_difference[offset] = get_blue_difference(pixel.r, pixel.g, pixel.b);
+			red_difference[offset] = get_red_difference(pixel.r, pixel.g, pixel.b);
+		}
+	}
+}
+
+animation_exporter::slot* animation_exporter::find(state state)
+{
+	slot* result = nullptr;
+
+	for (auto& target : this->slots)
+	{
+		if (target.current == state && (!result || target.index < result->index))
+		{
+			result = &target;
+		}
+	}
+
+	return result;
+}
+
+void animation_exporter::fail(std::exception_ptr exception)
+{
+	{
+		std::lock_guard<std::mutex> _(this->mutex);
+		if (!this->error) this->error = exception;
+	}
+
+	this->changed.notify_all();
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "camera.hpp"
+#include "camera_path.hpp"
+#include "painter_list.hpp"
+#include "synthesizer.hpp"
+#include "pixel_readback.hpp"
+#include "depth_reduction.hpp"
+
+// Renders a camera path offscreen at a fixed resolution and streams its stereograms to a file or stdout.
+// Depth is rendered and reduced to pattern shifts on the GPU one frame after the other, the frames are synthesized
+// in parallel on worker threads and written in order by a writer thread. At most two frames per worker are held
+// in memory, rendering waits for the writer when the output is slower than that.
+class animation_exporter
+{
+public:
+	enum class format
+	{
+		y4m, // YUV4MPEG2 with 4:4:4 BT.601 limited range YCbCr, as read by ffmpeg and most players
+		rgb, // Headerless rgb24 frames, top row first
+	};
+
+	struct settings
+	{
+		// - writes to stdout
+		std::string output;
+		format output_format = format::y4m;
+
+		int width = 1280;
+		int height = 720;
+		double fps = 30.0;
+
+		int pattern_div = 12;
+		unsigned int seed = 0;
+		bool stable_pattern = false;
+
+		// Synthesizing workers, 0 uses all cores
+		unsigned int threads = 0;
+	};
+
+	struct statistics
+	{
+		int frames = 0;
+		double seconds = 0.0;
+	};
+
+	// The camera is moved along the path before the scene is painted, both have to outlive the exporter
+	animation_exporter(camera* camera, painter_list* scene, settings settings);
+	~animation_exporter();
+
+	animation_exporter(const animation_exporter&) = delete;
+	animation_exporter& operator=(const animation_exporter&) = delete;
+
+	// Renders the whole path on the calling thread, which has to own the GL context.
+	// Returns once the last frame is written, errors of the workers and the writer are rethrown here.
+	void run(const camera_path& path);
+
+	const statistics& get_statistics() const;
+
+private:
+	enum class state
+	{
+		empty,
+		queued,
+		synthesizing,
+		synthesized,
+	};
+
+	struct slot
+	{
+		state current = state::empty;
+		int index = 0;
+
+		std::vector<synthesizer::shift> shifts;
+		std::vector<unsigned char> payload;
+	};
+
+	camera* camera_object;
+	painter_list* scene;
+	settings options;
+
+	GLuint framebuffer = 0;
+	GLuint color_buffer = 0;
+	GLuint depth_texture = 0;
+
+	depth_reduction reduction;
+	pixel_readback readback;
+
+	std::ofstream file;
+	std::ostream* output = nullptr;
+
+	std::vector<slot> slots;
+	int frame_count = 0;
+	int next_frame = 0;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	bool stopping = false;
+	std::exception_ptr error;
+
+	std::vector<std::thread> workers;
+	std::thread writer;
+
+	statistics stats;
+
+	void create_targets();
+	void destroy_targets();
+
+	void open_output();
+	void start_threads(unsigned int worker_count);
+	void stop_threads();
+
+	void render(slot& target, const camera_path& path);
+
+	void work();
+	void write();
+
+	void convert(const std::vector<synthesizer::color>& colors, std::vector<unsigned char>& payload) const;
+
+	// Lowest frame index first
+	slot* find(state state);
+	void fail(std::exception_ptr exception);
+};
\ No newline at end of file
@@ -7,6 +7,11 @@ background::background(float r, float g, float b) : _r(r), _g(g), _b(b)
 
 }
 
+const char* background::get_name() const
+{
+	return "background";
+}
+
 void background::paint()
 {
 	glClearColor(this->_r, this->_g, this->_b, 1.0f);
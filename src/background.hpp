@@ -8,6 +8,7 @@ public:
 	background(float r, float g, float b);
 
 	void paint() override;
+	const char* get_name() const override;
 
 private:
 	float _r, _g, _b;
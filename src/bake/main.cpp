@@ -0,0 +1,191 @@
+#include "std_include.hpp"
+
+#include "mesh_cache.hpp"
+#include "mesh_optimizer.hpp"
+#include "mapped_obj_loader.hpp"
+#include "thread_pool.hpp"
+
+namespace
+{
+	struct options
+	{
+		std::vector<std::filesystem::path> inputs;
+		std::filesystem::path cache_directory;
+
+		unsigned int threads = 0;
+		bool force = false;
+
+		unsigned int optimizations = mesh_optimizer::none;
+	};
+
+	void print_usage()
+	{
+		printf("Usage: stereogram-bake [options] <obj file or directory>...\n\n");
+		printf("Writes the binary mesh cache entries the viewer loads instead of parsing Wavefront objects.\n");
+		printf("Directories are searched recursively.\n\n");
+		printf("Options:\n");
+		printf("  --cache-dir <dir>     Cache directory (default: .stereogram-cache next to every object)\n");
+		printf("  --threads <n>         Threads parsing each object, 0 = all cores (default: 0)\n");
+		printf("  --force               Rebuild entries that are still up to date\n");
+		printf("  --optimize            Reorder for vertex cache and fetch locality, as the viewer's --optimize\n");
+		printf("  --optimize-overdraw   Additionally sort for less overdraw, as the viewer's --optimize-overdraw\n");
+		printf("  --lod                 Append simplified detail levels, as the viewer's --lod\n");
+	}
+
+	options parse_options(int argc, char* argv[])
+	{
+		options result;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string argument = argv[i];
+
+			const auto next_value = [&]() -> std::string
+			{
+				if (i + 1 >= argc) throw std::runtime_error("Missing value for " + argument);
+				return argv[++i];
+			};
+
+			if (argument == "--cache-dir") result.cache_directory = next_value();
+			else if (argument == "--threads") result.threads = std::max(0, atoi(next_value().data()));
+			else if (argument == "--force") result.force = true;
+			else if (argument == "--optimize") result.optimizations |= mesh_optimizer::vertex_cache | mesh_optimizer::vertex_fetch;
+			else if (argument == "--lod") result.optimizations |= mesh_optimizer::lods;
+			else if (argument == "--optimize-overdraw") result.optimizations |= mesh_optimizer::vertex_cache | mesh_optimizer::vertex_fetch | mesh_optimizer::overdraw;
+			else if (argument.size() > 2 && argument.substr(0, 2) == "--") throw std::runtime_error("Unknown option " + argument);
+			else result.inputs.push_back(argument);
+		}
+
+		if (result.inputs.empty()) throw std::invalid_argument("Invalid arguments");
+
+		return result;
+	}
+
+	bool is_object(const std::filesystem::path& path)
+	{
+		auto extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c)
+		{
+			return static_cast<char>(tolower(c));
+		});
+
+		return extension == ".obj";
+	}
+
+	std::vector<std::filesystem::path> collect_inputs(const std::vector<std::filesystem::path>& inputs)
+	{
+		std::vector<std::filesystem::path> files;
+
+		for (auto& input : inputs)
+		{
+			if (!std::filesystem::is_directory(input))
+			{
+				files.push_back(input);
+				continue;
+			}
+
+			for (auto& entry : std::filesystem::recursive_directory_iterator(input))
+			{
+				if (entry.is_regular_file() && is_object(entry.path()))
+				{
+					files.push_back(entry.path());
+				}
+			}
+		}
+
+		std::sort(files.begin(), files.end());
+		return files;
+	}
+
+	using clock_type = std::chrono::high_resolution_clock;
+
+	void run(const options& options)
+	{
+		const auto files = collect_inputs(options.inputs);
+
+		mesh_cache cache(options.cache_directory);
+		thread_pool pool(options.threads);
+
+		size_t baked = 0, skipped = 0, failed = 0;
+
+		for (auto& file : files)
+		{
+			const auto source = file.string();
+
+			try
+			{
+				if (!options.force && cache.find(source, options.optimizations))
+				{
+					++skipped;
+					continue;
+				}
+
+				const auto start = clock_type::now();
+
+				mapped_obj_loader loader(source, &pool);
+				auto& mesh = loader.get_mesh();
+
+				mesh_optimizer::statistics before;
+				if (options.optimizations)
+				{
+					before = mesh_optimizer::analyze_vertex_cache(mesh);
+					mesh_optimizer::optimize(mesh, options.optimizations);
+				}
+
+				cache.store(source, mesh, options.optimizations);
+
+				const auto duration_ms = std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+
+				const auto triangles = (mesh.lods.empty() ? mesh.get_index_count() : mesh.lods.front().index_count) / 3;
+
+				printf("%s -> %s (%zu vertices, %zu triangles, %.2f ms)\n", source.data(), cache.get_path(source).string().data(),
+					mesh.get_vertex_count(), triangles, duration_ms);
+
+				if (options.optimizations)
+				{
+					const auto after = mesh_optimizer::analyze_vertex_cache(mesh);
+					printf("  ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", before.acmr, after.acmr, before.atvr, after.atvr);
+				}
+
+				for (size_t i = 1; i < mesh.lods.size(); ++i)
+				{
+					printf("  LOD %zu: %u triangles, error %g\n", i, mesh.lods[i].index_count / 3, mesh.lods[i].error);
+				}
+
+				++baked;
+			}
+			catch (std::exception& e)
+			{
+				++failed;
+				fprintf(stderr, "%s: %s\n", source.data(), e.what());
+			}
+		}
+
+		printf("\nBaked %zu, up to date %zu, failed %zu of %zu object(s)\n", baked, skipped, failed, files.size());
+
+		if (failed)
+		{
+			throw std::runtime_error(std::to_string(failed) + " object(s) failed to bake");
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		run(parse_options(argc, argv));
+	}
+	catch (std::invalid_argument&)
+	{
+		print_usage();
+		return 1;
+	}
+	catch (std::exception& e)
+	{
+		fprintf(stderr, "ERROR: %s\n", e.what());
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "std_include.hpp"
+
+#include "allocation_tracker.hpp"
+
+namespace
+{
+	// Every block is prefixed with its size, padded to keep the default new alignment
+	constexpr size_t header_size = alignof(std::max_align_t);
+
+	std::atomic<unsigned long long> allocations = 0;
+	std::atomic<size_t> current_bytes = 0;
+	std::atomic<size_t> peak_bytes = 0;
+
+	void* allocate(size_t size)
+	{
+		auto block = static_cast<char*>(malloc(size + header_size));
+		if (!block) throw std::bad_alloc();
+
+		*reinterpret_cast<size_t*>(block) = size;
+
+		allocations++;
+		const auto current = current_bytes += size;
+
+		auto peak = peak_bytes.load();
+		while (current > peak && !peak_bytes.compare_exchange_weak(peak, current))
+		{
+		}
+
+		return block + header_size;
+	}
+
+	void release(void* memory)
+	{
+		if (!memory) return;
+
+		auto block = static_cast<char*>(memory) - header_size;
+		current_bytes -= *reinterpret_cast<size_t*>(block);
+
+		free(block);
+	}
+}
+
+namespace allocation_tracker
+{
+	statistics get_statistics()
+	{
+		statistics result;
+		result.allocations = allocations;
+		result.current_bytes = current_bytes;
+		result.peak_bytes = peak_bytes;
+		return result;
+	}
+
+	void reset()
+	{
+		allocations = 0;
+		peak_bytes = current_bytes.load();
+	}
+}
+
+void* operator new(size_t size)
+{
+	return allocate(size);
+}
+
+void* operator new[](size_t size)
+{
+	return allocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	release(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	release(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	release(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	release(memory);
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+// Counts heap allocations of the whole process through replaced global operator new and delete.
+// Only linked into the benchmark, memory mapped files and GPU buffers are not included.
+namespace allocation_tracker
+{
+	struct statistics
+	{
+		unsigned long long allocations = 0;
+		size_t current_bytes = 0;
+		size_t peak_bytes = 0;
+	};
+
+	statistics get_statistics();
+
+	// Starts a new measurement, the peak restarts at the memory currently in use
+	void reset();
+}
\ No newline at end of file
@@ -0,0 +1,712 @@
+#include "std_include.hpp"
+
+#include "obj_loader.hpp"
+#include "mapped_obj_loader.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_clusters.hpp"
+#include "depth_rasterizer.hpp"
+#include "synthesizer.hpp"
+#include "thread_pool.hpp"
+
+#include "allocation_tracker.hpp"
+
+namespace
+{
+	struct options
+	{
+		std::string benchmark;
+		std::vector<std::string> arguments;
+
+		unsigned int threads = 0;
+		int iterations = 3;
+
+		// Largest generated inputs of the synthetic benchmark
+		size_t max_triangles = 10000000;
+		int max_height = 4320;
+	};
+
+	void print_usage()
+	{
+		printf("Usage: stereogram-bench [options] <benchmark> <arguments>\n\n");
+		printf("Benchmarks:\n");
+		printf("  obj <file>            Wavefront object parsing, obj_loader against mapped_obj_loader\n");
+		printf("  optimize <file>       Mesh optimization passes and the vertex cache efficiency they reach\n");
+		printf("  lod <file>            Detail level generation, depth rendering time and depth error per level\n");
+		printf("  raster <file>         Software depth rasterization per instruction set and with threads against the scalar reference\n");
+		printf("  synthetic             Loader, cluster building and synthesis stages on generated meshes and depth maps\n\n");
+		printf("Options:\n");
+		printf("  --threads <n>         Worker threads, 0 = all cores (default: 0)\n");
+		printf("  --iterations <n>      Runs per measurement, the fastest one is reported (default: 3)\n");
+		printf("  --max-triangles <n>   Largest synthetic mesh, from 10K up to 10M triangles (default: 10000000)\n");
+		printf("  --max-height <n>      Largest synthetic depth map, from 720p up to 8K (default: 4320)\n");
+	}
+
+	options parse_options(int argc, char* argv[])
+	{
+		options result;
+		std::vector<std::string> positional;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string argument = argv[i];
+
+			const auto next_value = [&]() -> std::string
+			{
+				if (i + 1 >= argc) throw std::runtime_error("Missing value for " + argument);
+				return argv[++i];
+			};
+
+			if (argument == "--threads") result.threads = std::max(0, atoi(next_value().data()));
+			else if (argument == "--iterations") result.iterations = std::max(1, atoi(next_value().data()));
+			else if (argument == "--max-triangles") result.max_triangles = static_cast<size_t>(std::max(0ll, atoll(next_value().data())));
+			else if (argument == "--max-height") result.max_height = std::max(0, atoi(next_value().data()));
+			else if (argument.size() > 2 && argument.substr(0, 2) == "--") throw std::runtime_error("Unknown option " + argument);
+			else positional.push_back(argument);
+		}
+
+		if (positional.empty()) throw std::invalid_argument("Invalid arguments");
+
+		result.benchmark = positional.front();
+		result.arguments.assign(positional.begin() + 1, positional.end());
+
+		return result;
+	}
+
+	using clock_type = std::chrono::high_resolution_clock;
+
+	struct measurement
+	{
+		double ms = 0.0;
+
+		// Heap memory of the last run beyond what was in use before it. One-time allocations of
+		// earlier runs, like thread local buffers, don't count.
+		size_t peak_bytes = 0;
+		unsigned long long allocations = 0;
+	};
+
+	template <typename F>
+	measurement measure(int iterations, F&& callback)
+	{
+		measurement result;
+		result.ms = std::numeric_limits<double>::max();
+
+		for (int i = 0; i < iterations; ++i)
+		{
+			allocation_tracker::reset();
+			const auto base_bytes = allocation_tracker::get_statistics().current_bytes;
+
+			const auto start = clock_type::now();
+			callback();
+			result.ms = std::min(result.ms, std::chrono::duration<double, std::milli>(clock_type::now() - start).count());
+
+			if (i == iterations - 1)
+			{
+				const auto stats = allocation_tracker::get_statistics();
+				result.peak_bytes = stats.peak_bytes - base_bytes;
+				result.allocations = stats.allocations;
+			}
+		}
+
+		return result;
+	}
+
+	void print_measurement(const char* name, const measurement& measurement, double megabytes, double reference_ms)
+	{
+		printf("  %-30s %9.2f ms %9.2f MB/s %6.2fx   peak heap %8.2f MB in %llu allocations\n", name, measurement.ms, megabytes / (measurement.ms / 1000.0),
+			reference_ms / measurement.ms, measurement.peak_bytes / (1024.0 * 1024.0), measurement.allocations);
+	}
+
+	void benchmark_obj(const options& options)
+	{
+		if (options.arguments.size() != 1) throw std::invalid_argument("Invalid arguments");
+
+		const auto& path = options.arguments.front();
+		thread_pool pool(options.threads);
+
+		// Loaders are destroyed inside the measurement, the peak includes everything they held
+		const auto reference = measure(options.iterations, [&]()
+		{
+			obj_loader loader(path);
+		});
+
+		const auto single = measure(options.iterations, [&]()
+		{
+			mapped_obj_loader loader(path);
+		});
+
+		const auto parallel = measure(options.iterations, [&]()
+		{
+			mapped_obj_loader loader(path, &pool);
+		});
+
+		obj_loader reference_loader(path);
+		mapped_obj_loader loader(path, &pool);
+
+		const auto& result = loader.get_mesh();
+		const auto megabytes = loader.get_file_size() / (1024.0 * 1024.0);
+
+		printf("%s: %.2f MB, %zu vertices, %zu triangles, %.2f MB mesh\n", path.data(), megabytes, result.get_vertex_count(), result.get_index_count() / 3,
+			result.get_memory_size() / (1024.0 * 1024.0));
+
+		const auto threads_name = "mapped_obj_loader (" + std::to_string(pool.get_thread_count()) + " threads)";
+
+		print_measurement("obj_loader", reference, megabytes, reference.ms);
+		print_measurement("mapped_obj_loader (1 thread)", single, megabytes, reference.ms);
+		print_measurement(threads_name.data(), parallel, megabytes, reference.ms);
+
+		const auto& expected = reference_loader.get_mesh();
+		if (expected.positions != result.positions || expected.indices != result.indices)
+		{
+			// Expected for negative indices and polygons beyond quads, which obj_loader doesn't handle
+			printf("  Meshes differ: obj_loader produced %zu vertices and %zu triangles\n", expected.get_vertex_count(), expected.get_index_count() / 3);
+		}
+	}
+
+	void print_statistics(const char* name, const mesh& mesh)
+	{
+		const auto fifo_16 = mesh_optimizer::analyze_vertex_cache(mesh, 16);
+		const auto fifo_32 = mesh_optimizer::analyze_vertex_cache(mesh, 32);
+
+		printf("  %-30s ACMR %.3f / %.3f   ATVR %.3f / %.3f\n", name, fifo_16.acmr, fifo_32.acmr, fifo_16.atvr, fifo_32.atvr);
+	}
+
+	void benchmark_optimize(const options& options)
+	{
+		if (options.arguments.size() != 1) throw std::invalid_argument("Invalid arguments");
+
+		const auto& path = options.arguments.front();
+		thread_pool pool(options.threads);
+
+		mapped_obj_loader loader(path, &pool);
+		const auto& source = loader.get_mesh();
+
+		printf("%s: %zu vertices, %zu triangles\n", path.data(), source.get_vertex_count(), source.get_index_count() / 3);
+
+		struct pass
+		{
+			const char* name;
+			unsigned int flags;
+		};
+
+		const pass passes[] = {
+			{ "vertex cache", mesh_optimizer::vertex_cache },
+			{ "vertex cache, fetch", mesh_optimizer::vertex_cache | mesh_optimizer::vertex_fetch },
+			{ "vertex cache, overdraw, fetch", mesh_optimizer::vertex_cache | mesh_optimizer::overdraw | mesh_optimizer::vertex_fetch },
+		};
+
+		// Timings include copying the source mesh, every run has to start from the file's order
+		printf("\nDuration:\n");
+
+		std::vector<mesh> results;
+		auto reference_ms = 0.0;
+
+		for (auto& pass : passes)
+		{
+			const auto duration = measure(options.iterations, [&]()
+			{
+				auto result = source;
+				mesh_optimizer::optimize(result, pass.flags);
+			});
+
+			if (results.empty()) reference_ms = duration.ms;
+			print_measurement(pass.name, duration, source.get_memory_size() / (1024.0 * 1024.0), reference_ms);
+
+			results.push_back(source);
+			mesh_optimizer::optimize(results.back(), pass.flags);
+		}
+
+		printf("\nFIFO cache with 16 / 32 entries:\n");
+		print_statistics("file order", source);
+
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			print_statistics(passes[i].name, results[i]);
+		}
+	}
+
+	// Same conversion as synthesizer::get_depth_value, the pattern shift the stereogram encodes a depth value with
+	int get_shift(float depth, int pattern_div)
+	{
+		const auto level = static_cast<int>(std::min(std::max((1.0f - depth) * 255.0f, 0.0f), 255.0f));
+		return level / pattern_div;
+	}
+
+	struct bounding_sphere
+	{
+		glm::vec3 center;
+		float radius;
+	};
+
+	bounding_sphere get_bounding_sphere(const mesh& mesh)
+	{
+		glm::vec3 bounds_min(std::numeric_limits<float>::max()), bounds_max(std::numeric_limits<float>::lowest());
+		for (size_t i = 0; i + 2 < mesh.positions.size(); i += 3)
+		{
+			const glm::vec3 position(mesh.positions[i], mesh.positions[i + 1], mesh.positions[i + 2]);
+			bounds_min = glm::min(bounds_min, position);
+			bounds_max = glm::max(bounds_max, position);
+		}
+
+		return { (bounds_min + bounds_max) * 0.5f, std::max(glm::length(bounds_max - bounds_min) * 0.5f, 1.0f) };
+	}
+
+	// The viewer's window and camera projection
+	constexpr int view_width = 800;
+	constexpr int view_height = 600;
+
+	glm::mat4 get_projection()
+	{
+		return glm::perspective(glm::radians(65.0f), static_cast<float>(view_width) / view_height, 1.0f, 50000.0f);
+	}
+
+	// Looking at the model's center from distance times its radius
+	glm::mat4 get_view(const bounding_sphere& bounds, float distance)
+	{
+		const auto eye = bounds.center + glm::vec3(0.0f, 0.0f, bounds.radius * distance);
+		return glm::lookAt(eye, bounds.center, glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+
+	void benchmark_lod(const options& options)
+	{
+		if (options.arguments.size() != 1) throw std::invalid_argument("Invalid arguments");
+
+		const auto& path = options.arguments.front();
+		thread_pool pool(options.threads);
+
+		mapped_obj_loader loader(path, &pool);
+		auto& result = loader.get_mesh();
+
+		const auto generation = measure(1, [&]()
+		{
+			mesh_optimizer::generate_lods(result);
+		});
+
+		printf("%s: %zu vertices, %zu detail levels generated in %.2f ms\n", path.data(), result.get_vertex_count(), result.lods.size(), generation.ms);
+		if (result.lods.empty()) return;
+
+		const auto bounds = get_bounding_sphere(result);
+		const auto projection = get_projection();
+
+		constexpr int pattern_div = 12;
+
+		depth_rasterizer reference(view_width, view_height);
+		depth_rasterizer rasterizer(view_width, view_height);
+
+		// The error that projects to one pixel at the distance is where the viewer switches levels by default
+		for (auto distance : { 2.0f, 8.0f, 32.0f })
+		{
+			const auto view_projection = projection * get_view(bounds, distance);
+			const auto pixels_per_unit = projection[1][1] * view_height * 0.5f / (bounds.radius * distance - bounds.radius);
+
+			printf("\nCamera at %.0fx the bounding radius, %dx%d:\n", distance, view_width, view_height);
+			printf("  %-5s %10s %10s %10s %12s %14s\n", "level", "triangles", "error px", "depth ms", "shift diff %", "depth diff lvl");
+
+			for (size_t level = 0; level < result.lods.size(); ++level)
+			{
+				const auto& lod = result.lods[level];
+
+				const auto draw = [&](depth_rasterizer& target)
+				{
+					target.clear();
+
+					std::visit([&](auto& indices)
+					{
+						using index_type = typename std::decay_t<decltype(indices)>::value_type;
+						target.draw(result.positions, gsl::span<const index_type>(indices.data() + lod.first_index, lod.index_count), view_projection);
+					}, result.indices);
+				};
+
+				auto& target = level ? rasterizer : reference;
+				const auto duration = measure(options.iterations, [&]()
+				{
+					draw(target);
+				});
+
+				// Pixels whose pattern shift differs from the full mesh, and the mean depth difference in the stereogram's 255 levels
+				size_t shift_differences = 0;
+				auto depth_difference = 0.0;
+
+				const auto expected = reference.get_depth();
+				const auto actual = target.get_depth();
+
+				for (std::ptrdiff_t i = 0; i < expected.size(); ++i)
+				{
+					if (get_shift(expected[i], pattern_div) != get_shift(actual[i], pattern_div)) ++shift_differences;
+					depth_difference += std::abs(expected[i] - actual[i]) * 255.0;
+				}
+
+				const auto pixels = static_cast<double>(expected.size());
+
+				printf("  %-5zu %10u %10.3f %10.2f %12.3f %14.4f\n", level, lod.index_count / 3, lod.error * pixels_per_unit, duration.ms,
+					100.0 * static_cast<double>(shift_differences) / pixels, depth_difference / pixels);
+			}
+		}
+	}
+
+	void benchmark_raster(const options& options)
+	{
+		if (options.arguments.size() != 1) throw std::invalid_argument("Invalid arguments");
+
+		const auto& path = options.arguments.front();
+		thread_pool pool(options.threads);
+
+		mapped_obj_loader loader(path, &pool);
+		const auto& source = loader.get_mesh();
+
+		const auto bounds = get_bounding_sphere(source);
+		const auto pixels = static_cast<double>(view_width) * view_height;
+
+		printf("%s: %zu vertices, %zu triangles, %dx%d\n", path.data(), source.get_vertex_count(), source.get_index_count() / 3, view_width, view_height);
+
+		struct configuration
+		{
+			simd::instruction_set set;
+			bool threads;
+		};
+
+		std::vector<configuration> configurations{ { simd::instruction_set::none, false } };
+		for (auto set : { simd::instruction_set::sse2, simd::instruction_set::avx2 })
+		{
+			if (set <= simd::detect()) configurations.push_back({ set, false });
+		}
+
+		configurations.push_back({ simd::detect(), true });
+
+		// Filling the view, at a medium distance and mostly empty with small triangles
+		for (auto distance : { 1.5f, 4.0f, 16.0f })
+		{
+			const auto view_projection = get_projection() * get_view(bounds, distance);
+
+			printf("\nCamera at %.1fx the bounding radius:\n", distance);
+
+			depth_rasterizer reference(view_width, view_height);
+			auto reference_ms = 0.0;
+
+			for (auto& configuration : configurations)
+			{
+				depth_rasterizer rasterizer(view_width, view_height);
+				rasterizer.set_instruction_set(configuration.set);
+				rasterizer.set_thread_pool(configuration.threads ? &pool : nullptr);
+
+				auto& target = configurations.front().set == configuration.set && !configuration.threads ? reference : rasterizer;
+
+				const auto duration = measure(options.iterations, [&]()
+				{
+					target.clear();
+
+					std::visit([&](auto& indices)
+					{
+						using index_type = typename std::decay_t<decltype(indices)>::value_type;
+						target.draw(source.positions, gsl::span<const index_type>(indices), view_projection);
+					}, source.indices);
+				});
+
+				if (&target == &reference) reference_ms = duration.ms;
+
+				// Every path evaluates the same float expressions, anything but 0 is a bug
+				size_t differences = 0;
+				auto max_difference = 0.0f;
+
+				const auto expected = reference.get_depth();
+				const auto actual = target.get_depth();
+
+				for (std::ptrdiff_t i = 0; i < expected.size(); ++i)
+				{
+					const auto difference = std::abs(expected[i] - actual[i]);
+					if (difference > 0.0f) ++differences;
+
+					max_difference = std::max(max_difference, difference);
+				}
+
+				const auto name = std::string(simd::get_name(configuration.set)) + (configuration.threads ? ", " + std::to_string(pool.get_thread_count()) + " threads" : ", 1 thread");
+
+				printf("  %-20s %9.2f ms %8.2f ns/pixel %6.2fx   %zu pixels differ, max %g\n", name.data(), duration.ms, duration.ms * 1000000.0 / pixels,
+					reference_ms / duration.ms, differences, max_difference);
+			}
+		}
+	}
+
+	// Height field of size x size quads in the unit square, two triangles each, written with the
+	// vertex and face forms exported models commonly use
+	void write_grid_obj(const std::filesystem::path& path, int size)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file) throw std::runtime_error("Unable to create " + path.string());
+
+		// Lines are formatted with snprintf, the numbers must look like the ones exporters write
+		char line[96];
+		const auto write_line = [&](int length)
+		{
+			file.write(line, length);
+		};
+
+		std::mt19937 generator(1337);
+		std::uniform_real_distribution<float> noise(-0.002f, 0.002f);
+
+		const auto step = 1.0f / static_cast<float>(size);
+
+		for (int y = 0; y <= size; ++y)
+		{
+			for (int x = 0; x <= size; ++x)
+			{
+				const auto u = static_cast<float>(x) * step;
+				const auto v = static_cast<float>(y) * step;
+				const auto height = 0.1f * sinf(u * 12.0f) * cosf(v * 9.0f) + noise(generator);
+
+				write_line(snprintf(line, sizeof(line), "v %f %f %f\n", u, v, height));
+			}
+		}
+
+		for (int y = 0; y < size; ++y)
+		{
+			for (int x = 0; x < size; ++x)
+			{
+				const auto a = y * (size + 1) + x + 1;
+				const auto b = a + 1;
+				const auto c = a + size + 1;
+				const auto d = c + 1;
+
+				if ((x + y) & 1) write_line(snprintf(line, sizeof(line), "f %d %d %d\n", a, b, d));
+				else write_line(snprintf(line, sizeof(line), "f %d//%d %d//%d %d//%d\n", a, a, b, b, d, d));
+
+				write_line(snprintf(line, sizeof(line), "f %d %d %d\n", a, d, c));
+			}
+		}
+
+		if (!file.flush()) throw std::runtime_error("Unable to write " + path.string());
+	}
+
+	// Window space depth of a sphere in front of a tilted floor, with a far plane background in the top third
+	std::vector<float> generate_depth(int width, int height)
+	{
+		std::vector<float> depth(static_cast<size_t>(width) * height);
+
+		const auto radius = height * 0.3f;
+		const auto center_x = width * 0.5f;
+		const auto center_y = height * 0.45f;
+
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				auto value = y > height * 2 / 3 ? 1.0f : 0.6f + 0.3f * static_cast<float>(y) / static_cast<float>(height);
+
+				const auto dx = (static_cast<float>(x) - center_x) / radius;
+				const auto dy = (static_cast<float>(y) - center_y) / radius;
+				const auto distance = dx * dx + dy * dy;
+
+				if (distance < 1.0f) value = std::min(value, 0.5f - 0.3f * sqrtf(1.0f - distance));
+
+				depth[static_cast<size_t>(y) * width + x] = value;
+			}
+		}
+
+		return depth;
+	}
+
+	void print_stage(const char* name, const char* size, const measurement& measurement, double items, const char* unit, double megabytes)
+	{
+		printf("  %-38s %6s %10.2f ms %9.2f ns/%-8s %9.2f MB/s %8llu allocations\n", name, size, measurement.ms, measurement.ms * 1000000.0 / items, unit,
+			megabytes / (measurement.ms / 1000.0), measurement.allocations);
+	}
+
+	void benchmark_synthetic_meshes(const options& options, thread_pool& pool)
+	{
+		struct mesh_size
+		{
+			const char* name;
+			size_t triangles;
+		};
+
+		const mesh_size sizes[] = {
+			{ "10K", 10000 },
+			{ "100K", 100000 },
+			{ "1M", 1000000 },
+			{ "10M", 10000000 },
+		};
+
+		printf("Meshes, MB/s of the file for loaders and of the index buffer for clusters:\n");
+
+		const auto threads_name = "mapped_obj_loader (" + std::to_string(pool.get_thread_count()) + " threads)";
+
+		for (auto& size : sizes)
+		{
+			if (size.triangles > options.max_triangles) break;
+
+			const auto grid_size = static_cast<int>(ceil(sqrt(static_cast<double>(size.triangles) / 2.0)));
+			const auto path = std::filesystem::temp_directory_path() / ("stereogram-bench-" + std::to_string(grid_size) + ".obj");
+
+			write_grid_obj(path, grid_size);
+			auto _ = gsl::finally([&path]()
+			{
+				std::error_code error;
+				std::filesystem::remove(path, error);
+			});
+
+			const auto file_megabytes = static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+			const auto triangles = 2.0 * grid_size * grid_size;
+
+			const auto reference = measure(options.iterations, [&]()
+			{
+				obj_loader loader(path.string());
+			});
+
+			const auto single = measure(options.iterations, [&]()
+			{
+				mapped_obj_loader loader(path.string());
+			});
+
+			const auto parallel = measure(options.iterations, [&]()
+			{
+				mapped_obj_loader loader(path.string(), &pool);
+			});
+
+			print_stage("obj_loader", size.name, reference, triangles, "triangle", file_megabytes);
+			print_stage("mapped_obj_loader (1 thread)", size.name, single, triangles, "triangle", file_megabytes);
+			print_stage(threads_name.data(), size.name, parallel, triangles, "triangle", file_megabytes);
+
+			// The CPU side of creating a model, the upload itself needs a GL context
+			mapped_obj_loader loader(path.string(), &pool);
+			const auto& source = loader.get_mesh();
+
+			std::visit([&](auto& indices)
+			{
+				using index_type = typename std::decay_t<decltype(indices)>::value_type;
+				std::vector<index_type> ordered;
+
+				const auto clusters = measure(options.iterations, [&]()
+				{
+					ordered.clear();
+					mesh_clusters::build(source.positions, gsl::span<const index_type>(indices), {}, ordered);
+				});
+
+				print_stage("mesh_clusters::build", size.name, clusters, triangles, "triangle", static_cast<double>(indices.size() * sizeof(index_type)) / (1024.0 * 1024.0));
+			}, source.indices);
+		}
+	}
+
+	void benchmark_synthetic_depth(const options& options, thread_pool& pool)
+	{
+		struct resolution
+		{
+			const char* name;
+			int width;
+			int height;
+		};
+
+		const resolution resolutions[] = {
+			{ "720p", 1280, 720 },
+			{ "1080p", 1920, 1080 },
+			{ "1440p", 2560, 1440 },
+			{ "4K", 3840, 2160 },
+			{ "8K", 7680, 4320 },
+		};
+
+		printf("\nDepth maps, %u threads, MB/s of the color buffer:\n", pool.get_thread_count());
+
+		for (auto& resolution : resolutions)
+		{
+			if (resolution.height > options.max_height) break;
+
+			const auto depth = generate_depth(resolution.width, resolution.height);
+			const auto pixels = static_cast<double>(depth.size());
+
+			std::vector<synthesizer::color> colors(depth.size());
+			const auto megabytes = static_cast<double>(colors.size() * sizeof(synthesizer::color)) / (1024.0 * 1024.0);
+
+			synthesizer engine(resolution.width, resolution.height);
+			engine.set_thread_pool(&pool);
+			engine.set_seed(1);
+
+			// The shifts the GPU depth reduction reads back instead of float depth
+			std::vector<synthesizer::shift> shifts(depth.size());
+			std::transform(depth.begin(), depth.end(), shifts.begin(), [&engine](float value)
+			{
+				return synthesizer::shift{ static_cast<unsigned char>(get_shift(value, engine.get_pattern_div())) };
+			});
+
+			const auto float_depth = measure(options.iterations, [&]()
+			{
+				engine.randomize_pattern();
+				engine.synthesize(gsl::span<const float>(depth), colors);
+			});
+
+			// The same work as one full frame pass per stage, for the memory traffic fusing the rows saves
+			engine.set_fused_rows(false);
+
+			const auto passes = measure(options.iterations, [&]()
+			{
+				engine.randomize_pattern();
+				engine.synthesize(gsl::span<const float>(depth), colors);
+			});
+
+			engine.set_fused_rows(true);
+
+			const auto shift_depth = measure(options.iterations, [&]()
+			{
+				engine.randomize_pattern();
+				engine.synthesize(gsl::span<const synthesizer::shift>(shifts), colors);
+			});
+
+			// A still scene with a stable pattern, every row is hashed and none is rewritten
+			std::vector<unsigned char> dirty_rows;
+			engine.synthesize_changed(gsl::span<const float>(depth), colors, dirty_rows);
+
+			const auto unchanged = measure(options.iterations, [&]()
+			{
+				engine.synthesize_changed(gsl::span<const float>(depth), colors, dirty_rows);
+			});
+
+			const auto depth_view = measure(options.iterations, [&]()
+			{
+				engine.visualize(gsl::span<const float>(depth), colors);
+			});
+
+			print_stage("randomize_pattern + synthesize", resolution.name, float_depth, pixels, "pixel", megabytes);
+			print_stage("  same, one pass per stage", resolution.name, passes, pixels, "pixel", megabytes);
+			print_stage("randomize_pattern + synthesize shifts", resolution.name, shift_depth, pixels, "pixel", megabytes);
+			print_stage("synthesize_changed, unchanged", resolution.name, unchanged, pixels, "pixel", megabytes);
+			print_stage("visualize", resolution.name, depth_view, pixels, "pixel", megabytes);
+		}
+	}
+
+	void benchmark_synthetic(const options& options)
+	{
+		if (!options.arguments.empty()) throw std::invalid_argument("Invalid arguments");
+
+		thread_pool pool(options.threads);
+
+		benchmark_synthetic_meshes(options, pool);
+		benchmark_synthetic_depth(options, pool);
+	}
+
+	void run(const options& options)
+	{
+		if (options.benchmark == "obj") benchmark_obj(options);
+		else if (options.benchmark == "optimize") benchmark_optimize(options);
+		else if (options.benchmark == "lod") benchmark_lod(options);
+		else if (options.benchmark == "raster") benchmark_raster(options);
+		else if (options.benchmark == "synthetic") benchmark_synthetic(options);
+		else throw std::runtime_error("Unknown benchmark " + options.benchmark);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		run(parse_options(argc, argv));
+	}
+	catch (std::invalid_argument&)
+	{
+		print_usage();
+		return 1;
+	}
+	catch (std::exception& e)
+	{
+		fprintf(stderr, "ERROR: %s\n", e.what());
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "std_include.hpp"
 
 #include "camera.hpp"
+#include "gl_state.hpp"
 
 camera::camera(window* _frame) : 
 	frame(_frame),
@@ -18,13 +19,51 @@ camera::~camera()
 
 }
 
+const char* camera::get_name() const
+{
+	return "camera";
+}
+
 void camera::paint()
 {
-	this->adjust_angle();
-	this->adjust_position();
+	if (this->path)
+	{
+		this->follow_path();
+	}
+	else
+	{
+		this->adjust_angle();
+		this->adjust_position();
+	}
+
 	this->transform_world();
 }
 
+void camera::set_path(const camera_path* _path)
+{
+	// The cursor moved meanwhile, that is no reason to turn
+	if (this->path && !_path) glfwGetCursorPos(*this->frame, &this->last_x, &this->last_y);
+
+	this->path = _path;
+}
+
+void camera::set_path_time(double time)
+{
+	this->path_time = time;
+}
+
+void camera::follow_path()
+{
+	const auto pose = this->path->sample(this->path_time);
+	this->position = pose.position;
+
+	// Splines may pass through their focus point, keep the last direction there
+	if (pose.focus_point != pose.position)
+	{
+		this->direction = glm::normalize(pose.focus_point - pose.position);
+	}
+}
+
 glm::dvec3 camera::calculate_right_movement()
 {
 	auto right = glm::cross(this->direction, this->up);
@@ -116,23 +155,14 @@ void camera::adjust_angle()
 
 void camera::transform_world()
 {
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-
-	GLint viewport[4];
-	glGetIntegerv(GL_VIEWPORT, viewport);
+	const auto& viewport = gl_state::get_viewport();
 
 	int viewport_width = viewport[2] - viewport[0];
 	int viewport_height = viewport[3] - viewport[1];
 
-	gluPerspective(65, viewport_width * 1.0 / viewport_height, 1, 50000);
-
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
+	// Same matrices as gluPerspective and gluLookAt
+	gl_state::load_matrix(GL_PROJECTION, glm::perspective(glm::radians(65.0), viewport_width * 1.0 / viewport_height, 1.0, 50000.0));
 
 	auto focus_point = this->position + this->direction;
-
-	gluLookAt(this->position[0], this->position[1], this->position[2],
-		      focus_point[0]   , focus_point[1]   , focus_point[2],
-		      this->up[0]      , this->up[1]      , this->up[2]);
+	gl_state::load_matrix(GL_MODELVIEW, glm::lookAt(this->position, focus_point, this->up));
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "window.hpp"
 #include "paintable.hpp"
+#include "camera_path.hpp"
 
 class button
 {
@@ -32,10 +33,19 @@ public:
 	~camera() override;
 
 	void paint() override;
+	const char* get_name() const override;
+
+	// Follows the path instead of the keyboard and mouse, nullptr hands control back to them.
+	// The path has to outlive its use, the time is in seconds.
+	void set_path(const camera_path* path);
+	void set_path_time(double time);
 
 private:
 	window* frame;
 
+	const camera_path* path = nullptr;
+	double path_time = 0.0;
+
 	button key_up;
 	button key_down;
 	button key_left;
@@ -50,6 +60,7 @@ private:
 
 	void adjust_position();
 	void adjust_angle();
+	void follow_path();
 
 	void transform_world();
 
@@ -0,0 +1,91 @@
+#include "std_include.hpp"
+
+#include "camera_path.hpp"
+
+#include <sstream>
+
+namespace
+{
+	glm::dvec3 interpolate(const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3& p2, const glm::dvec3& p3, double t)
+	{
+		const auto t2 = t * t;
+		const auto t3 = t2 * t;
+
+		return 0.5 * ((2.0 * p1) + (p2 - p0) * t + (2.0 * p0 - 5.0 * p1 + 4.0 * p2 - p3) * t2 + (3.0 * p1 - p0 - 3.0 * p2 + p3) * t3);
+	}
+}
+
+camera_path::camera_path(const std::string& path)
+{
+	std::ifstream stream(path);
+	if (!stream) throw std::runtime_error("Unable to open camera path " + path);
+
+	std::string line;
+	for (int number = 1; std::getline(stream, line); ++number)
+	{
+		const auto start = line.find_first_not_of(" \t\r");
+		if (start == std::string::npos || line[start] == '#') continue;
+
+		keyframe frame{};
+		auto& position = frame.value.position;
+		auto& focus_point = frame.value.focus_point;
+
+		std::istringstream values(line);
+		values >> frame.time >> position.x >> position.y >> position.z >> focus_point.x >> focus_point.y >> focus_point.z;
+
+		if (values.fail())
+		{
+			throw std::runtime_error("Invalid keyframe in line " + std::to_string(number) + " of " + path);
+		}
+
+		if (frame.time < 0.0)
+		{
+			throw std::runtime_error("Keyframe times can't be negative, line " + std::to_string(number) + " of " + path);
+		}
+
+		if (!this->keyframes.empty() && frame.time <= this->keyframes.back().time)
+		{
+			throw std::runtime_error("Keyframe times must increase, line " + std::to_string(number) + " of " + path);
+		}
+
+		if (position == focus_point)
+		{
+			throw std::runtime_error("Keyframe looks at its own position, line " + std::to_string(number) + " of " + path);
+		}
+
+		this->keyframes.push_back(frame);
+	}
+
+	if (this->keyframes.empty()) throw std::runtime_error("No keyframes in " + path);
+}
+
+double camera_path::get_duration() const
+{
+	return this->keyframes.back().time;
+}
+
+camera_path::pose camera_path::sample(double time) const
+{
+	if (time <= this->keyframes.front().time) return this->keyframes.front().value;
+	if (time >= this->keyframes.back().time) return this->keyframes.back().value;
+
+	const auto next = std::upper_bound(this->keyframes.begin(), this->keyframes.end(), time, [](double value, const keyframe& frame)
+	{
+		return value < frame.time;
+	});
+
+	// The outer keyframes repeat at both ends of the path
+	const auto index = static_cast<size_t>(next - this->keyframes.begin()) - 1;
+	const auto& k0 = this->keyframes[index > 0 ? index - 1 : index];
+	const auto& k1 = this->keyframes[index];
+	const auto& k2 = this->keyframes[index + 1];
+	const auto& k3 = this->keyframes[std::min(index + 2, this->keyframes.size() - 1)];
+
+	const auto t = (time - k1.time) / (k2.time - k1.time);
+
+	pose result;
+	result.position = interpolate(k0.value.position, k1.value.position, k2.value.position, k3.value.position, t);
+	result.focus_point = interpolate(k0.value.focus_point, k1.value.focus_point, k2.value.focus_point, k3.value.focus_point, t);
+
+	return result;
+}
\ No newline at end of file
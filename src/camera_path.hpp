@@ -0,0 +1,31 @@
+#pragma once
+
+// Keyframed camera motion, read from a text file with one keyframe per line:
+//   <time in seconds> <position x y z> <focus point x y z>
+// Times start at 0 or later and increase. Empty lines and lines starting with # are skipped. Between keyframes the position and the focus point
+// follow Catmull-Rom splines, before the first and after the last one the camera rests.
+class camera_path
+{
+public:
+	struct pose
+	{
+		glm::dvec3 position;
+		glm::dvec3 focus_point;
+	};
+
+	explicit camera_path(const std::string& path);
+
+	// Time of the last keyframe
+	double get_duration() const;
+
+	pose sample(double time) const;
+
+private:
+	struct keyframe
+	{
+		double time;
+		pose value;
+	};
+
+	std::vector<keyframe> keyframes;
+};
\ No newline at end of file
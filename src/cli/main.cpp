@@ -0,0 +1,325 @@
+#include "std_include.hpp"
+
+#include "image.hpp"
+#include "synthesizer.hpp"
+#include "thread_pool.hpp"
+
+namespace
+{
+	struct options
+	{
+		std::filesystem::path input;
+		std::filesystem::path output;
+
+		std::string format = "png";
+		int pattern_div = 12;
+		unsigned int jobs = std::max(1u, std::thread::hardware_concurrency());
+		unsigned int threads = 1;
+		int chunk_rows = 0;
+		std::optional<unsigned int> seed;
+
+		bool compare = false;
+		simd::instruction_set instruction_set = simd::detect();
+	};
+
+	void print_usage()
+	{
+		printf("Usage: stereogram-cli [options] <depth map or directory> <output directory>\n\n");
+		printf("Converts PGM (8/16 bit) and PFM depth maps into random dot autostereograms.\n\n");
+		printf("Options:\n");
+		printf("  --format <ppm|png>    Output image format (default: png)\n");
+		printf("  --pattern-div <n>     Stereogram width divided by pattern width (default: 12)\n");
+		printf("  --jobs <n>            Number of depth maps converted concurrently (default: all cores)\n");
+		printf("  --threads <n>         Threads synthesizing the rows of one depth map, 0 = all cores (default: 1)\n");
+		printf("  --chunk-rows <n>      Rows per work item when using multiple threads (default: automatic)\n");
+		printf("  --kernel <name>       Synthesis kernel: scalar, sse2 or avx2 (default: best supported)\n");
+		printf("  --seed <n>            Pattern seed, the same seed always produces the same images (default: random)\n");
+		printf("  --compare             Also run the single threaded scalar reference, verify the output is\n");
+		printf("                        bit exact and report the speedup\n");
+	}
+
+	simd::instruction_set parse_instruction_set(const std::string& name)
+	{
+		for (auto set : { simd::instruction_set::none, simd::instruction_set::sse2, simd::instruction_set::avx2 })
+		{
+			if (name == simd::get_name(set)) return set;
+		}
+
+		throw std::runtime_error("Unknown kernel " + name);
+	}
+
+	options parse_options(int argc, char* argv[])
+	{
+		options result;
+		std::vector<std::string> positional;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string argument = argv[i];
+
+			const auto next_value = [&]() -> std::string
+			{
+				if (i + 1 >= argc) throw std::runtime_error("Missing value for " + argument);
+				return argv[++i];
+			};
+
+			if (argument == "--format") result.format = next_value();
+			else if (argument == "--pattern-div") result.pattern_div = atoi(next_value().data());
+			else if (argument == "--jobs") result.jobs = std::max(1, atoi(next_value().data()));
+			else if (argument == "--threads") result.threads = std::max(0, atoi(next_value().data()));
+			else if (argument == "--chunk-rows") result.chunk_rows = std::max(0, atoi(next_value().data()));
+			else if (argument == "--compare") result.compare = true;
+			else if (argument == "--kernel") result.instruction_set = parse_instruction_set(next_value());
+			else if (argument == "--seed") result.seed = static_cast<unsigned int>(strtoul(next_value().data(), nullptr, 0));
+			else if (argument.size() > 2 && argument.substr(0, 2) == "--") throw std::runtime_error("Unknown option " + argument);
+			else positional.push_back(argument);
+		}
+
+		if (positional.size() != 2) throw std::invalid_argument("Invalid arguments");
+		if (result.format != "ppm" && result.format != "png") throw std::runtime_error("Unsupported output format " + result.format);
+		if (result.pattern_div <= 0) throw std::runtime_error("Invalid pattern divisor");
+
+		// Checked here, the job threads would otherwise each throw it out of their entry function
+		if (result.instruction_set > simd::detect())
+		{
+			throw std::runtime_error("Instruction set "s + simd::get_name(result.instruction_set) + " is not supported by this CPU");
+		}
+
+		result.input = positional[0];
+		result.output = positional[1];
+
+		return result;
+	}
+
+	bool is_depth_map(const std::filesystem::path& path)
+	{
+		auto extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c)
+		{
+			return static_cast<char>(tolower(c));
+		});
+
+		return extension == ".pgm" || extension == ".pfm";
+	}
+
+	std::vector<std::filesystem::path> collect_inputs(const std::filesystem::path& input)
+	{
+		std::vector<std::filesystem::path> files;
+
+		if (std::filesystem::is_directory(input))
+		{
+			for (auto& entry : std::filesystem::directory_iterator(input))
+			{
+				if (entry.is_regular_file() && is_depth_map(entry.path()))
+				{
+					files.push_back(entry.path());
+				}
+			}
+
+			std::sort(files.begin(), files.end());
+		}
+		else
+		{
+			files.push_back(input);
+		}
+
+		return files;
+	}
+
+	using clock_type = std::chrono::high_resolution_clock;
+
+	double elapsed_ms(clock_type::time_point start, clock_type::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	struct totals
+	{
+		std::mutex mutex;
+
+		size_t converted = 0;
+		size_t failed = 0;
+		double pixels = 0.0;
+		double synthesis_ms = 0.0;
+		double reference_ms = 0.0;
+	};
+
+	template <typename T>
+	double measure_reference(synthesizer& engine, thread_pool* pool, int chunk_rows, const std::vector<T>& samples, const std::vector<synthesizer::color>& colors)
+	{
+		std::vector<synthesizer::color> reference(colors.size());
+
+		const auto instruction_set = engine.get_instruction_set();
+
+		engine.set_thread_pool(nullptr);
+		engine.set_instruction_set(simd::instruction_set::none);
+
+		auto _ = gsl::finally([&]()
+		{
+			engine.set_thread_pool(pool, chunk_rows);
+			engine.set_instruction_set(instruction_set);
+		});
+
+		const auto start = clock_type::now();
+		engine.synthesize(gsl::span<const T>(samples), reference);
+		const auto reference_ms = elapsed_ms(start, clock_type::now());
+
+		if (std::memcmp(reference.data(), colors.data(), colors.size() * sizeof(synthesizer::color)) != 0)
+		{
+			throw std::runtime_error("Synthesis output differs from the scalar reference");
+		}
+
+		return reference_ms;
+	}
+
+	void convert(const options& options, const std::filesystem::path& file, synthesizer& engine, thread_pool* pool, std::vector<synthesizer::color>& colors, totals& totals)
+	{
+		auto map = image::load_depth_map(file.string());
+		const auto size = static_cast<size_t>(map.width) * map.height;
+
+		engine.resize(map.width, map.height);
+		colors.resize(size);
+
+		// A fixed seed restarts the sequence for every file, so outputs don't depend on which job converts what
+		if (options.seed) engine.set_seed(*options.seed);
+		else engine.randomize_pattern();
+
+		const auto start = clock_type::now();
+
+		std::visit([&](auto& samples)
+		{
+			using sample_type = typename std::decay_t<decltype(samples)>::value_type;
+			engine.synthesize(gsl::span<const sample_type>(samples), colors);
+		}, map.samples);
+
+		const auto synthesis_ms = elapsed_ms(start, clock_type::now());
+
+		auto reference_ms = 0.0;
+		if (options.compare)
+		{
+			reference_ms = std::visit([&](auto& samples)
+			{
+				return measure_reference(engine, pool, options.chunk_rows, samples, colors);
+			}, map.samples);
+		}
+
+		auto target = options.output / file.filename();
+		target.replace_extension("." + options.format);
+
+		if (options.format == "ppm") image::write_ppm(target.string(), map.width, map.height, colors);
+		else image::write_png(target.string(), map.width, map.height, colors);
+
+		std::lock_guard<std::mutex> _(totals.mutex);
+		totals.converted++;
+		totals.pixels += static_cast<double>(size);
+		totals.synthesis_ms += synthesis_ms;
+		totals.reference_ms += reference_ms;
+
+		if (options.compare)
+		{
+			printf("%s -> %s (%dx%d, synthesis %.2f ms, reference %.2f ms, speedup %.2fx)\n", file.string().data(), target.string().data(),
+				map.width, map.height, synthesis_ms, reference_ms, reference_ms / std::max(synthesis_ms, 0.001));
+		}
+		else
+		{
+			printf("%s -> %s (%dx%d, synthesis %.2f ms)\n", file.string().data(), target.string().data(), map.width, map.height, synthesis_ms);
+		}
+	}
+
+	void run(const options& options)
+	{
+		auto files = collect_inputs(options.input);
+		std::filesystem::create_directories(options.output);
+
+		std::unique_ptr<thread_pool> pool;
+		if (options.threads != 1)
+		{
+			pool = std::make_unique<thread_pool>(options.threads);
+		}
+
+		totals totals;
+		std::atomic<size_t> next_file = 0;
+
+		const auto worker = [&]()
+		{
+			synthesizer engine(0, 0, options.pattern_div);
+			engine.set_thread_pool(pool.get(), options.chunk_rows);
+			engine.set_instruction_set(options.instruction_set);
+
+			std::vector<synthesizer::color> colors;
+
+			for (auto index = next_file++; index < files.size(); index = next_file++)
+			{
+				try
+				{
+					convert(options, files[index], engine, pool.get(), colors, totals);
+				}
+				catch (std::exception& e)
+				{
+					std::lock_guard<std::mutex> _(totals.mutex);
+					totals.failed++;
+
+					fprintf(stderr, "%s: %s\n", files[index].string().data(), e.what());
+				}
+			}
+		};
+
+		const auto start = clock_type::now();
+
+		std::vector<std::thread> threads;
+		const auto thread_count = std::min<size_t>(options.jobs, std::max<size_t>(files.size(), 1));
+
+		for (size_t i = 1; i < thread_count; ++i)
+		{
+			threads.emplace_back(worker);
+		}
+
+		worker();
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		const auto total_ms = elapsed_ms(start, clock_type::now());
+		const auto megapixels = totals.pixels / 1000000.0;
+
+		printf("\nConverted %zu of %zu depth maps in %.2f ms using %zu job(s) with %u thread(s) each, %s kernel\n", totals.converted, files.size(), total_ms,
+			thread_count, pool ? pool->get_thread_count() : 1, simd::get_name(options.instruction_set));
+
+		if (totals.synthesis_ms > 0.0 && total_ms > 0.0)
+		{
+			printf("Synthesis: %.2f MPixel/s per job, end to end: %.2f MPixel/s\n", megapixels / (totals.synthesis_ms / 1000.0), megapixels / (total_ms / 1000.0));
+		}
+
+		if (options.compare && totals.synthesis_ms > 0.0)
+		{
+			printf("Average synthesis speedup over the single threaded scalar reference: %.2fx\n", totals.reference_ms / totals.synthesis_ms);
+		}
+
+		if (totals.failed)
+		{
+			throw std::runtime_error(std::to_string(totals.failed) + " depth map(s) failed to convert");
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		run(parse_options(argc, argv));
+	}
+	catch (std::invalid_argument&)
+	{
+		print_usage();
+		return 1;
+	}
+	catch (std::exception& e)
+	{
+		fprintf(stderr, "ERROR: %s\n", e.what());
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
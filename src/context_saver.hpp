@@ -1,5 +1,8 @@
 #pragma once
 
+#include "gl_state.hpp"
+
+// Restores the tracked GL state when it goes out of scope, from the CPU copy without querying GL
 class context_saver
 {
 public:
@@ -7,11 +10,5 @@ public:
 	~context_saver();
 
 private:
-	int shader_program;
-	int texture_2d;
-	int matrix_mode;
-	int alignment;
-
-	double modelview_matrix[16];
-	double projection_matrix[16];
+	gl_state::snapshot state;
 };
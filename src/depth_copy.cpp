@@ -0,0 +1,54 @@
+#include "std_include.hpp"
+
+#include "depth_copy.hpp"
+#include "gl_state.hpp"
+
+depth_copy::depth_copy()
+{
+
+}
+
+depth_copy::~depth_copy()
+{
+	gl_state::delete_texture(this->texture);
+}
+
+GLuint depth_copy::update(int _width, int _height)
+{
+	const auto texture_2d = gl_state::get_texture_2d();
+
+	this->adjust_texture(_width, _height);
+
+	gl_state::bind_texture_2d(this->texture);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, this->width, this->height);
+
+	gl_state::bind_texture_2d(texture_2d);
+
+	return this->texture;
+}
+
+GLuint depth_copy::get_texture() const
+{
+	return this->texture;
+}
+
+void depth_copy::adjust_texture(int _width, int _height)
+{
+	if (this->texture && _width == this->width && _height == this->height) return;
+
+	this->width = _width;
+	this->height = _height;
+
+	gl_state::delete_texture(this->texture);
+
+	glGenTextures(1, &this->texture);
+	gl_state::bind_texture_2d(this->texture);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, this->width, this->height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+class depth_copy
+{
+public:
+	depth_copy();
+	~depth_copy();
+
+	// Copies the depth buffer of the current read framebuffer into a texture, without leaving the GPU
+	GLuint update(int width, int height);
+
+	GLuint get_texture() const;
+
+private:
+	int width = 0;
+	int height = 0;
+
+	GLuint texture = 0;
+
+	void adjust_texture(int width, int height);
+};
\ No newline at end of file
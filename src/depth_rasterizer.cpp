@@ -0,0 +1,422 @@
+#include "std_include.hpp"
+
+#include "depth_rasterizer.hpp"
+
+namespace
+{
+	// Square screen tiles, each rasterized by one task. Small enough to balance the threads, large enough
+	// that most triangles only land in a single bin.
+	constexpr int tile_size = 64;
+
+	// Triangles set up and binned per task
+	constexpr size_t triangles_per_batch = 4096;
+
+	constexpr int vertices_per_chunk = 16384;
+
+	glm::vec3 to_window(const glm::vec4& position, int width, int height)
+	{
+		const auto inverse_w = 1.0f / position.w;
+		return glm::vec3((position.x * inverse_w * 0.5f + 0.5f) * width, (position.y * inverse_w * 0.5f + 0.5f) * height,
+			position.z * inverse_w * 0.5f + 0.5f);
+	}
+
+	float get_area(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	}
+
+	// Pixels whose centers lie within [min, max], clamped to [0, size). Empty if first > last.
+	struct pixel_span
+	{
+		int first;
+		int last;
+	};
+
+	pixel_span get_pixel_span(float min, float max, int size)
+	{
+		// Also rejects non-finite coordinates
+		if (!(max >= 0.5f && min <= size - 0.5f)) return { 0, -1 };
+
+		return { static_cast<int>(ceilf(std::max(min - 0.5f, 0.0f))), static_cast<int>(floorf(std::min(max - 0.5f, size - 1.0f))) };
+	}
+}
+
+depth_rasterizer::depth_rasterizer(int _width, int _height)
+{
+	this->resize(_width, _height);
+}
+
+void depth_rasterizer::resize(int _width, int _height)
+{
+	_width = std::max(_width, 1);
+	_height = std::max(_height, 1);
+
+	if (_width == this->width && _height == this->height) return;
+
+	this->width = _width;
+	this->height = _height;
+
+	this->tiles_x = (this->width + tile_size - 1) / tile_size;
+	this->tiles_y = (this->height + tile_size - 1) / tile_size;
+
+	this->depth.resize(static_cast<size_t>(this->width) * this->height);
+	this->clear();
+}
+
+void depth_rasterizer::set_thread_pool(thread_pool* _pool)
+{
+	this->pool = _pool;
+}
+
+void depth_rasterizer::set_instruction_set(simd::instruction_set set)
+{
+	if (set > simd::detect())
+	{
+		throw std::runtime_error("Instruction set "s + simd::get_name(set) + " is not supported by this CPU");
+	}
+
+	this->instruction_set = set;
+}
+
+simd::instruction_set depth_rasterizer::get_instruction_set() const
+{
+	return this->instruction_set;
+}
+
+void depth_rasterizer::clear()
+{
+	std::fill(this->depth.begin(), this->depth.end(), 1.0f);
+}
+
+void depth_rasterizer::draw(gsl::span<const float> positions, gsl::span<const unsigned int> indices, const glm::mat4& view_projection, gsl::span<const range> ranges)
+{
+	this->transform(positions, view_projection);
+	this->create_batches(static_cast<size_t>(indices.size()), ranges);
+	this->draw_indexed(indices);
+}
+
+void depth_rasterizer::draw(gsl::span<const float> positions, gsl::span<const unsigned short> indices, const glm::mat4& view_projection, gsl::span<const range> ranges)
+{
+	this->transform(positions, view_projection);
+	this->create_batches(static_cast<size_t>(indices.size()), ranges);
+	this->draw_indexed(indices);
+}
+
+int depth_rasterizer::get_width() const
+{
+	return this->width;
+}
+
+int depth_rasterizer::get_height() const
+{
+	return this->height;
+}
+
+gsl::span<const float> depth_rasterizer::get_depth() const
+{
+	return this->depth;
+}
+
+void depth_rasterizer::for_each(int count, int chunk_size, const std::function<void(int, int)>& callback)
+{
+	if (this->pool)
+	{
+		this->pool->parallel_for(count, chunk_size, callback);
+	}
+	else
+	{
+		callback(0, count);
+	}
+}
+
+void depth_rasterizer::transform(gsl::span<const float> positions, const glm::mat4& view_projection)
+{
+	// Every vertex once, instead of once per triangle it is used by
+	const auto vertex_count = static_cast<size_t>(positions.size()) / 3;
+	this->clip_positions.resize(vertex_count);
+	this->window_positions.resize(vertex_count);
+
+	this->for_each(static_cast<int>(vertex_count), vertices_per_chunk, [&](int begin, int end)
+	{
+		for (auto i = static_cast<size_t>(begin); i < static_cast<size_t>(end); ++i)
+		{
+			const auto position = view_projection * glm::vec4(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2], 1.0f);
+			this->clip_positions[i] = position;
+
+			// Only used by triangles in front of the near plane, where w is positive
+			if (position.w > 0.0f)
+			{
+				this->window_positions[i] = to_window(position, this->width, this->height);
+			}
+		}
+	});
+}
+
+void depth_rasterizer::create_batches(size_t index_count, gsl::span<const range> ranges)
+{
+	const range everything{ 0, index_count };
+	if (ranges.empty()) ranges = gsl::span<const range>(&everything, 1);
+
+	this->batch_count = 0;
+
+	for (auto& range : ranges)
+	{
+		if (range.first_index >= index_count) continue;
+
+		const auto triangle_count = std::min(range.index_count, index_count - range.first_index) / 3;
+
+		for (size_t first = 0; first < triangle_count; first += triangles_per_batch)
+		{
+			if (this->batch_count == this->batches.size()) this->batches.emplace_back();
+
+			// Reused across frames, the bins keep their capacity
+			auto& target = this->batches[this->batch_count++];
+			target.first_index = range.first_index + first * 3;
+			target.triangle_count = std::min(triangles_per_batch, triangle_count - first);
+		}
+	}
+}
+
+template <typename T>
+void depth_rasterizer::draw_indexed(gsl::span<const T> indices)
+{
+	this->for_each(static_cast<int>(this->batch_count), 1, [&](int begin, int end)
+	{
+		for (auto i = begin; i < end; ++i)
+		{
+			this->bin_triangles(this->batches[i], indices);
+		}
+	});
+
+	this->for_each(this->tiles_x * this->tiles_y, 1, [&](int begin, int end)
+	{
+		for (auto tile = begin; tile < end; ++tile)
+		{
+			this->rasterize_tile(tile, indices);
+		}
+	});
+}
+
+template <typename T>
+void depth_rasterizer::bin_triangles(batch& batch, gsl::span<const T> indices)
+{
+	batch.clipped.clear();
+	batch.bins.resize(static_cast<size_t>(this->tiles_x) * this->tiles_y);
+
+	for (auto& bin : batch.bins) bin.clear();
+
+	const auto vertex_count = this->clip_positions.size();
+
+	for (size_t triangle = 0; triangle < batch.triangle_count; ++triangle)
+	{
+		const auto first = batch.first_index + triangle * 3;
+
+		const size_t index_a = indices[first];
+		const size_t index_b = indices[first + 1];
+		const size_t index_c = indices[first + 2];
+
+		if (index_a >= vertex_count || index_b >= vertex_count || index_c >= vertex_count) continue;
+
+		const auto& a = this->clip_positions[index_a];
+		const auto& b = this->clip_positions[index_b];
+		const auto& c = this->clip_positions[index_c];
+
+		// Entirely outside one of the clip planes
+		if (a.x < -a.w && b.x < -b.w && c.x < -c.w) continue;
+		if (a.x > a.w && b.x > b.w && c.x > c.w) continue;
+		if (a.y < -a.w && b.y < -b.w && c.y < -c.w) continue;
+		if (a.y > a.w && b.y > b.w && c.y > c.w) continue;
+		if (a.z < -a.w && b.z < -b.w && c.z < -c.w) continue;
+		if (a.z > a.w && b.z > b.w && c.z > c.w) continue;
+
+		if (a.z < -a.w || b.z < -b.w || c.z < -c.w)
+		{
+			this->clip_triangle(batch, a, b, c);
+		}
+		else
+		{
+			this->bin_triangle(batch, static_cast<unsigned int>(triangle << 1), this->window_positions[index_a], this->window_positions[index_b],
+				this->window_positions[index_c]);
+		}
+	}
+}
+
+void depth_rasterizer::clip_triangle(batch& batch, const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+	// Sutherland-Hodgman against the near plane, z >= -w. The other planes are handled by the scissoring in rasterize_triangle.
+	const glm::vec4 input[3] = { a, b, c };
+
+	glm::vec4 output[4];
+	int count = 0;
+
+	for (int i = 0; i < 3; ++i)
+	{
+		const auto& current = input[i];
+		const auto& next = input[(i + 1) % 3];
+
+		const auto current_distance = current.z + current.w;
+		const auto next_distance = next.z + next.w;
+
+		if (current_distance >= 0.0f) output[count++] = current;
+
+		if ((current_distance >= 0.0f) != (next_distance >= 0.0f))
+		{
+			const auto t = current_distance / (current_distance - next_distance);
+			output[count++] = current + (next - current) * t;
+		}
+	}
+
+	for (int i = 2; i < count; ++i)
+	{
+		window_triangle triangle{};
+		triangle.vertices[0] = to_window(output[0], this->width, this->height);
+		triangle.vertices[1] = to_window(output[i - 1], this->width, this->height);
+		triangle.vertices[2] = to_window(output[i], this->width, this->height);
+
+		const auto entry = static_cast<unsigned int>(batch.clipped.size() << 1) | 1;
+		batch.clipped.push_back(triangle);
+
+		this->bin_triangle(batch, entry, triangle.vertices[0], triangle.vertices[1], triangle.vertices[2]);
+	}
+}
+
+void depth_rasterizer::bin_triangle(batch& batch, unsigned int entry, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+	const auto area = get_area(a, b, c);
+	if (!(area != 0.0f)) return;
+
+	// Dense meshes seen from afar are mostly triangles between pixel centers, they are dropped here
+	const auto x = get_pixel_span(std::min({ a.x, b.x, c.x }), std::max({ a.x, b.x, c.x }), this->width);
+	if (x.first > x.last) return;
+
+	const auto y = get_pixel_span(std::min({ a.y, b.y, c.y }), std::max({ a.y, b.y, c.y }), this->height);
+	if (y.first > y.last) return;
+
+	for (auto tile_y = y.first / tile_size; tile_y <= y.last / tile_size; ++tile_y)
+	{
+		for (auto tile_x = x.first / tile_size; tile_x <= x.last / tile_size; ++tile_x)
+		{
+			batch.bins[static_cast<size_t>(tile_y) * this->tiles_x + tile_x].push_back(entry);
+		}
+	}
+}
+
+template <typename T>
+void depth_rasterizer::rasterize_tile(int tile, gsl::span<const T> indices)
+{
+	const auto tile_x = tile % this->tiles_x;
+	const auto tile_y = tile / this->tiles_x;
+
+	for (size_t i = 0; i < this->batch_count; ++i)
+	{
+		const auto& batch = this->batches[i];
+
+		for (const auto entry : batch.bins[tile])
+		{
+			if (entry & 1)
+			{
+				const auto& triangle = batch.clipped[entry >> 1];
+				this->rasterize_triangle(triangle.vertices[0], triangle.vertices[1], triangle.vertices[2], tile_x, tile_y);
+				continue;
+			}
+
+			const auto first = batch.first_index + (entry >> 1) * 3ull;
+			this->rasterize_triangle(this->window_positions[indices[first]], this->window_positions[indices[first + 1]],
+				this->window_positions[indices[first + 2]], tile_x, tile_y);
+		}
+	}
+}
+
+void depth_rasterizer::rasterize_triangle(glm::vec3 a, glm::vec3 b, glm::vec3 c, int tile_x, int tile_y)
+{
+	auto area = get_area(a, b, c);
+
+	if (area < 0.0f)
+	{
+		std::swap(b, c);
+		area = -area;
+	}
+
+	const auto x = get_pixel_span(std::min({ a.x, b.x, c.x }), std::max({ a.x, b.x, c.x }), this->width);
+	const auto y = get_pixel_span(std::min({ a.y, b.y, c.y }), std::max({ a.y, b.y, c.y }), this->height);
+
+	const auto min_x = std::max(x.first, tile_x * tile_size);
+	const auto max_x = std::min(x.last, tile_x * tile_size + tile_size - 1);
+	const auto min_y = std::max(y.first, tile_y * tile_size);
+	const auto max_y = std::min(y.last, tile_y * tile_size + tile_size - 1);
+
+	if (min_x > max_x || min_y > max_y) return;
+
+	// Edge functions, each is positive on the inside and changes linearly along x and y
+	const auto edge = [](const glm::vec3& from, const glm::vec3& to, float x, float y)
+	{
+		return (to.x - from.x) * (y - from.y) - (to.y - from.y) * (x - from.x);
+	};
+
+	// Window depth is affine in screen space, no perspective correction needed
+	const auto inverse_area = 1.0f / area;
+
+	simd::raster_row row{};
+	row.edge_steps[0] = -(c.y - b.y);
+	row.edge_steps[1] = -(a.y - c.y);
+	row.edge_steps[2] = -(b.y - a.y);
+	row.depth_step = (row.edge_steps[0] * a.z + row.edge_steps[1] * b.z + row.edge_steps[2] * c.z) * inverse_area;
+
+	const auto start_x = min_x + 0.5f;
+
+	for (int y = min_y; y <= max_y; ++y)
+	{
+		// Evaluated at the first pixel of every row, stepping would accumulate rounding errors across rows
+		const auto start_y = y + 0.5f;
+
+		row.edges[0] = edge(b, c, start_x, start_y);
+		row.edges[1] = edge(c, a, start_x, start_y);
+		row.edges[2] = edge(a, b, start_x, start_y);
+		row.depth = (row.edges[0] * a.z + row.edges[1] * b.z + row.edges[2] * c.z) * inverse_area;
+
+		// Where the edges cross the row, with a pixel of slack for rounding. The kernels still test every pixel,
+		// this only skips the ones that can't be covered, thin triangles would otherwise walk their whole bounds.
+		auto begin = 0.0f;
+		auto end = static_cast<float>(max_x - min_x + 1);
+
+		for (int i = 0; i < 3; ++i)
+		{
+			const auto crossing = -row.edges[i] / row.edge_steps[i];
+
+			if (row.edge_steps[i] > 0.0f) begin = std::max(begin, crossing - 1.0f);
+			else if (row.edge_steps[i] < 0.0f) end = std::min(end, crossing + 2.0f);
+			else if (row.edges[i] < 0.0f) end = 0.0f;
+		}
+
+		if (begin >= end) continue;
+
+		this->rasterize_row(row, this->depth.data() + static_cast<size_t>(y) * this->width + min_x, static_cast<int>(begin), static_cast<int>(end));
+	}
+}
+
+void depth_rasterizer::rasterize_row(const simd::raster_row& row, float* target, int begin, int end) const
+{
+	switch (this->instruction_set)
+	{
+	case simd::instruction_set::avx2:
+		simd::rasterize_row_avx2(row, target, begin, end);
+		return;
+	case simd::instruction_set::sse2:
+		simd::rasterize_row_sse2(row, target, begin, end);
+		return;
+	default:
+		break;
+	}
+
+	for (int x = begin; x < end; ++x)
+	{
+		const auto position = static_cast<float>(x);
+
+		const auto w0 = row.edges[0] + position * row.edge_steps[0];
+		const auto w1 = row.edges[1] + position * row.edge_steps[1];
+		const auto w2 = row.edges[2] + position * row.edge_steps[2];
+		const auto z = row.depth + position * row.depth_step;
+
+		if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f && z >= 0.0f && z <= 1.0f && z < target[x]) target[x] = z;
+	}
+}
\ No newline at end of file
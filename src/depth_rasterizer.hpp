@@ -0,0 +1,91 @@
+#pragma once
+
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+// Renders triangles into a depth buffer on the CPU, with the conventions of the GL depth buffer the stereogram reads:
+// window space depth from 0 at the near plane to 1 at the far plane, rows from bottom to top.
+class depth_rasterizer
+{
+public:
+	// Part of an index buffer, in indices
+	struct range
+	{
+		size_t first_index;
+		size_t index_count;
+	};
+
+	depth_rasterizer(int width, int height);
+
+	void resize(int width, int height);
+
+	// Vertices, triangle batches and screen tiles are distributed over the pool, no pool means single threaded.
+	// Depth is the minimum of all covered fragments, the result doesn't depend on threads or instruction sets.
+	void set_thread_pool(thread_pool* pool);
+
+	// Defaults to the best supported set, simd::instruction_set::none selects the scalar reference
+	void set_instruction_set(simd::instruction_set set);
+	simd::instruction_set get_instruction_set() const;
+
+	void clear();
+
+	// Both windings are drawn, the model doesn't cull faces either. Without ranges all indices are drawn.
+	void draw(gsl::span<const float> positions, gsl::span<const unsigned int> indices, const glm::mat4& view_projection, gsl::span<const range> ranges = {});
+	void draw(gsl::span<const float> positions, gsl::span<const unsigned short> indices, const glm::mat4& view_projection, gsl::span<const range> ranges = {});
+
+	int get_width() const;
+	int get_height() const;
+
+	gsl::span<const float> get_depth() const;
+
+private:
+	struct window_triangle
+	{
+		glm::vec3 vertices[3];
+	};
+
+	// Consecutive triangles set up and binned by one task. Bin entries are triangle numbers within the batch
+	// shifted left by one, or indices into clipped with the low bit set.
+	struct batch
+	{
+		size_t first_index;
+		size_t triangle_count;
+
+		std::vector<window_triangle> clipped;
+		std::vector<std::vector<unsigned int>> bins;
+	};
+
+	int width = 0;
+	int height = 0;
+
+	int tiles_x = 0;
+	int tiles_y = 0;
+
+	thread_pool* pool = nullptr;
+	simd::instruction_set instruction_set = simd::detect();
+
+	std::vector<float> depth;
+	std::vector<glm::vec4> clip_positions;
+	std::vector<glm::vec3> window_positions;
+
+	std::vector<batch> batches;
+	size_t batch_count = 0;
+
+	void for_each(int count, int chunk_size, const std::function<void(int begin, int end)>& callback);
+
+	void transform(gsl::span<const float> positions, const glm::mat4& view_projection);
+	void create_batches(size_t index_count, gsl::span<const range> ranges);
+
+	template <typename T>
+	void draw_indexed(gsl::span<const T> indices);
+
+	template <typename T>
+	void bin_triangles(batch& batch, gsl::span<const T> indices);
+	void bin_triangle(batch& batch, unsigned int entry, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+	void clip_triangle(batch& batch, const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+
+	template <typename T>
+	void rasterize_tile(int tile, gsl::span<const T> indices);
+	void rasterize_triangle(glm::vec3 a, glm::vec3 b, glm::vec3 c, int tile_x, int tile_y);
+	void rasterize_row(const simd::raster_row& row, float* target, int begin, int end) const;
+};
\ No newline at end of file
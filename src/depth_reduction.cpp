@@ -0,0 +1,125 @@
+#include "std_include.hpp"
+
+#include "depth_reduction.hpp"
+#include "context_saver.hpp"
+#include "gl_state.hpp"
+
+depth_reduction::depth_reduction()
+{
+	static_assert(sizeof(synthesizer::shift) == 1);
+
+	static auto vertex_shader_source =
+		"void main(void)"
+		"{"
+		"	gl_TexCoord[0] = gl_MultiTexCoord0;"
+		"	gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;"
+		"}";
+
+	// Same conversion as synthesizer::get_depth_value, the half level offset keeps the division away from integers
+	static auto fragment_shader_source =
+		"uniform sampler2D depth_sampler;"
+		"uniform float pattern_div;"
+		"uniform float max_shift;"
+		"void main(void)"
+		"{"
+		"	float depth = texture2D(depth_sampler, gl_TexCoord[0].st).r;"
+		"	float level = floor(clamp((1.0 - depth) * 255.0, 0.0, 255.0));"
+		"	float shift = min(floor((level + 0.5) / pattern_div), max_shift);"
+		"	gl_FragColor = vec4(shift / 255.0, 0.0, 0.0, 1.0);"
+		"}";
+
+	this->shader_program = std::make_unique<shader>(vertex_shader_source, fragment_shader_source);
+}
+
+depth_reduction::~depth_reduction()
+{
+	this->destroy_targets();
+}
+
+const synthesizer::shift* depth_reduction::read_shifts(GLuint depth_texture, int _width, int _height, int pattern_div, pixel_readback& readback)
+{
+	context_saver _;
+
+	this->adjust_targets(_width, _height);
+
+	const auto previous_framebuffer = gl_state::get().framebuffer;
+	gl_state::bind_framebuffer(this->framebuffer);
+
+	this->render_shifts(depth_texture, pattern_div);
+
+	auto shifts = readback.read(this->width, this->height, GL_RED, GL_UNSIGNED_BYTE, sizeof(synthesizer::shift));
+
+	gl_state::bind_framebuffer(previous_framebuffer);
+
+	return static_cast<const synthesizer::shift*>(shifts);
+}
+
+void depth_reduction::adjust_targets(int _width, int _height)
+{
+	if (this->framebuffer && _width == this->width && _height == this->height) return;
+
+	this->destroy_targets();
+
+	this->width = _width;
+	this->height = _height;
+
+	glGenTextures(1, &this->shift_texture);
+	gl_state::bind_texture_2d(this->shift_texture);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, this->width, this->height, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+
+	const auto previous_framebuffer = gl_state::get().framebuffer;
+
+	glGenFramebuffers(1, &this->framebuffer);
+	gl_state::bind_framebuffer(this->framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->shift_texture, 0);
+
+	const auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	gl_state::bind_framebuffer(previous_framebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		this->destroy_targets();
+		throw std::runtime_error("Unable to create depth reduction framebuffer");
+	}
+}
+
+void depth_reduction::destroy_targets()
+{
+	gl_state::delete_framebuffer(this->framebuffer);
+	gl_state::delete_texture(this->shift_texture);
+
+	this->framebuffer = 0;
+	this->shift_texture = 0;
+}
+
+void depth_reduction::render_shifts(GLuint depth_texture, int pattern_div)
+{
+	gl_state::set_viewport({ 0, 0, this->width, this->height });
+
+	gl_state::load_matrix(GL_PROJECTION, glm::dmat4(1.0));
+	gl_state::load_matrix(GL_MODELVIEW, glm::ortho(0.0, 1.0, 0.0, 1.0, -1.0, 1.0));
+
+	gl_state::set_enabled(GL_DEPTH_TEST, false);
+	gl_state::set_enabled(GL_BLEND, false);
+	gl_state::set_enabled(GL_LIGHTING, false);
+	gl_state::set_enabled(GL_TEXTURE_2D, true);
+
+	this->shader_program->use();
+	this->shader_program->set_uniform("depth_sampler", 0);
+	this->shader_program->set_uniform("pattern_div", static_cast<float>(pattern_div));
+	this->shader_program->set_uniform("max_shift", static_cast<float>(255 / pattern_div));
+
+	gl_state::active_texture(GL_TEXTURE0);
+	gl_state::bind_texture_2d(depth_texture);
+
+	glBegin(GL_QUADS);
+	glTexCoord2i(0, 0); glVertex2i(0, 0);
+	glTexCoord2i(0, 1); glVertex2i(0, 1);
+	glTexCoord2i(1, 1); glVertex2i(1, 1);
+	glTexCoord2i(1, 0); glVertex2i(1, 0);
+	glEnd();
+}
\ No newline at end of file
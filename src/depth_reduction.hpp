@@ -0,0 +1,30 @@
+#pragma once
+
+#include <shader.hpp>
+#include <synthesizer.hpp>
+#include <pixel_readback.hpp>
+
+class depth_reduction
+{
+public:
+	depth_reduction();
+	~depth_reduction();
+
+	// Converts a depth texture into 8 bit pattern shifts on the GPU and reads those back,
+	// instead of the full 32 bit float depth
+	const synthesizer::shift* read_shifts(GLuint depth_texture, int width, int height, int pattern_div, pixel_readback& readback);
+
+private:
+	int width = 0;
+	int height = 0;
+
+	GLuint shift_texture = 0;
+	GLuint framebuffer = 0;
+
+	std::unique_ptr<shader> shader_program;
+
+	void adjust_targets(int width, int height);
+	void destroy_targets();
+
+	void render_shifts(GLuint depth_texture, int pattern_div);
+};
\ No newline at end of file
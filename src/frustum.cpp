@@ -0,0 +1,33 @@
+#include "std_include.hpp"
+
+#include "frustum.hpp"
+
+frustum::frustum(const glm::dmat4& view_projection)
+{
+	const auto row = [&view_projection](int index)
+	{
+		return glm::dvec4(view_projection[0][index], view_projection[1][index], view_projection[2][index], view_projection[3][index]);
+	};
+
+	// Gribb and Hartmann: left, right, bottom, top, near and far are sums and differences of the matrix rows
+	for (int i = 0; i < 3; ++i)
+	{
+		this->planes[i * 2] = row(3) + row(i);
+		this->planes[i * 2 + 1] = row(3) - row(i);
+	}
+}
+
+bool frustum::intersects(const glm::vec3& bounds_min, const glm::vec3& bounds_max) const
+{
+	for (auto& plane : this->planes)
+	{
+		// The corner furthest along the plane's normal, if even that one is behind the plane the whole box is
+		const auto x = plane.x >= 0.0 ? bounds_max.x : bounds_min.x;
+		const auto y = plane.y >= 0.0 ? bounds_max.y : bounds_min.y;
+		const auto z = plane.z >= 0.0 ? bounds_max.z : bounds_min.z;
+
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0) return false;
+	}
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+
+// Clipping planes of a view projection matrix, to skip geometry before it is submitted
+class frustum
+{
+public:
+	frustum(const glm::dmat4& view_projection);
+
+	// Conservative, boxes near a corner of the frustum can pass even though they are outside
+	bool intersects(const glm::vec3& bounds_min, const glm::vec3& bounds_max) const;
+
+private:
+	glm::dvec4 planes[6];
+};
\ No newline at end of file
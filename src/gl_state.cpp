@@ -0,0 +1,317 @@
+#include "std_include.hpp"
+
+#include "gl_state.hpp"
+
+namespace gl_state
+{
+	namespace
+	{
+		constexpr GLenum tracked_capabilities[] = { GL_DEPTH_TEST, GL_BLEND, GL_LIGHTING, GL_TEXTURE_2D, GL_CULL_FACE };
+
+		snapshot current;
+
+		statistics frame_stats;
+		statistics last_frame_stats;
+
+		int get_capability_index(GLenum capability)
+		{
+			for (int i = 0; i < static_cast<int>(std::size(tracked_capabilities)); ++i)
+			{
+				if (tracked_capabilities[i] == capability) return i;
+			}
+
+			return -1;
+		}
+
+		// Counts a call, returns whether it has to be issued
+		bool update(bool changed)
+		{
+			if (changed) ++frame_stats.calls;
+			else ++frame_stats.skipped;
+
+			return changed;
+		}
+
+		GLuint get_binding(GLenum name)
+		{
+			GLint value = 0;
+			glGetIntegerv(name, &value);
+			return static_cast<GLuint>(value);
+		}
+	}
+
+	void initialize()
+	{
+		current.program = get_binding(GL_CURRENT_PROGRAM);
+		current.framebuffer = get_binding(GL_FRAMEBUFFER_BINDING);
+		current.active_texture = get_binding(GL_ACTIVE_TEXTURE);
+
+		for (int unit = 0; unit < texture_units; ++unit)
+		{
+			glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + unit));
+			current.textures_2d[unit] = get_binding(GL_TEXTURE_BINDING_2D);
+		}
+
+		glActiveTexture(current.active_texture);
+
+		current.array_buffer = get_binding(GL_ARRAY_BUFFER_BINDING);
+		current.element_array_buffer = get_binding(GL_ELEMENT_ARRAY_BUFFER_BINDING);
+
+		glGetIntegerv(GL_PACK_ALIGNMENT, &current.pack_alignment);
+		glGetIntegerv(GL_UNPACK_ALIGNMENT, &current.unpack_alignment);
+		glGetIntegerv(GL_VIEWPORT, &current.viewport[0]);
+
+		for (size_t i = 0; i < std::size(tracked_capabilities); ++i)
+		{
+			current.capabilities[i] = glIsEnabled(tracked_capabilities[i]) == GL_TRUE;
+		}
+
+		current.blend_source = get_binding(GL_BLEND_SRC);
+		current.blend_destination = get_binding(GL_BLEND_DST);
+
+		current.matrix_mode = get_binding(GL_MATRIX_MODE);
+		glGetDoublev(GL_PROJECTION_MATRIX, &current.projection[0][0]);
+		glGetDoublev(GL_MODELVIEW_MATRIX, &current.modelview[0][0]);
+	}
+
+	const snapshot& get()
+	{
+		return current;
+	}
+
+	void restore(const snapshot& state)
+	{
+		use_program(state.program);
+		bind_framebuffer(state.framebuffer);
+
+		// Units other than the active one are only touched if their binding differs
+		for (int unit = 0; unit < texture_units; ++unit)
+		{
+			if (state.textures_2d[unit] == current.textures_2d[unit]) continue;
+
+			active_texture(static_cast<GLenum>(GL_TEXTURE0 + unit));
+			bind_texture_2d(state.textures_2d[unit]);
+		}
+
+		active_texture(state.active_texture);
+
+		bind_buffer(GL_ARRAY_BUFFER, state.array_buffer);
+		bind_buffer(GL_ELEMENT_ARRAY_BUFFER, state.element_array_buffer);
+
+		set_alignment(GL_PACK_ALIGNMENT, state.pack_alignment);
+		set_alignment(GL_UNPACK_ALIGNMENT, state.unpack_alignment);
+		set_viewport(state.viewport);
+
+		for (size_t i = 0; i < std::size(tracked_capabilities); ++i)
+		{
+			set_enabled(tracked_capabilities[i], state.capabilities[i]);
+		}
+
+		set_blend_function(state.blend_source, state.blend_destination);
+
+		load_matrix(GL_PROJECTION, state.projection);
+		load_matrix(GL_MODELVIEW, state.modelview);
+
+		if (update(current.matrix_mode != state.matrix_mode))
+		{
+			current.matrix_mode = state.matrix_mode;
+			glMatrixMode(state.matrix_mode);
+		}
+	}
+
+	void use_program(GLuint program)
+	{
+		if (!update(current.program != program)) return;
+
+		current.program = program;
+		glUseProgram(program);
+	}
+
+	void bind_framebuffer(GLuint framebuffer)
+	{
+		if (!update(current.framebuffer != framebuffer)) return;
+
+		current.framebuffer = framebuffer;
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+
+	void active_texture(GLenum unit)
+	{
+		if (!update(current.active_texture != unit)) return;
+
+		current.active_texture = unit;
+		glActiveTexture(unit);
+	}
+
+	void bind_texture_2d(GLuint texture)
+	{
+		const auto unit = static_cast<int>(current.active_texture - GL_TEXTURE0);
+
+		// Untracked units are always bound
+		if (unit >= texture_units)
+		{
+			update(true);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			return;
+		}
+
+		if (!update(current.textures_2d[unit] != texture)) return;
+
+		current.textures_2d[unit] = texture;
+		glBindTexture(GL_TEXTURE_2D, texture);
+	}
+
+	GLuint get_texture_2d()
+	{
+		const auto unit = static_cast<int>(current.active_texture - GL_TEXTURE0);
+		return unit < texture_units ? current.textures_2d[unit] : get_binding(GL_TEXTURE_BINDING_2D);
+	}
+
+	void bind_buffer(GLenum target, GLuint buffer)
+	{
+		GLuint* binding = nullptr;
+		if (target == GL_ARRAY_BUFFER) binding = &current.array_buffer;
+		else if (target == GL_ELEMENT_ARRAY_BUFFER) binding = &current.element_array_buffer;
+
+		if (!update(!binding || *binding != buffer)) return;
+
+		if (binding) *binding = buffer;
+		glBindBuffer(target, buffer);
+	}
+
+	void set_alignment(GLenum name, GLint alignment)
+	{
+		auto& value = name == GL_PACK_ALIGNMENT ? current.pack_alignment : current.unpack_alignment;
+		if (!update(value != alignment)) return;
+
+		value = alignment;
+		glPixelStorei(name, alignment);
+	}
+
+	GLint get_alignment(GLenum name)
+	{
+		return name == GL_PACK_ALIGNMENT ? current.pack_alignment : current.unpack_alignment;
+	}
+
+	void set_viewport(const glm::ivec4& viewport)
+	{
+		if (!update(current.viewport != viewport)) return;
+
+		current.viewport = viewport;
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	}
+
+	const glm::ivec4& get_viewport()
+	{
+		return current.viewport;
+	}
+
+	void set_enabled(GLenum capability, bool enabled)
+	{
+		const auto index = get_capability_index(capability);
+
+		if (index >= 0)
+		{
+			if (!update(current.capabilities[index] != enabled)) return;
+			current.capabilities[index] = enabled;
+		}
+		else
+		{
+			update(true);
+		}
+
+		if (enabled) glEnable(capability);
+		else glDisable(capability);
+	}
+
+	void set_blend_function(GLenum source, GLenum destination)
+	{
+		if (!update(current.blend_source != source || current.blend_destination != destination)) return;
+
+		current.blend_source = source;
+		current.blend_destination = destination;
+		glBlendFunc(source, destination);
+	}
+
+	void load_matrix(GLenum mode, const glm::dmat4& matrix)
+	{
+		auto& target = mode == GL_PROJECTION ? current.projection : current.modelview;
+		if (!update(target != matrix)) return;
+
+		target = matrix;
+
+		if (current.matrix_mode != mode)
+		{
+			update(true);
+			current.matrix_mode = mode;
+			glMatrixMode(mode);
+		}
+
+		glLoadMatrixd(&matrix[0][0]);
+	}
+
+	const glm::dmat4& get_projection()
+	{
+		return current.projection;
+	}
+
+	const glm::dmat4& get_modelview()
+	{
+		return current.modelview;
+	}
+
+	void delete_texture(GLuint texture)
+	{
+		if (!texture) return;
+
+		for (auto& binding : current.textures_2d)
+		{
+			if (binding == texture) binding = 0;
+		}
+
+		glDeleteTextures(1, &texture);
+	}
+
+	void delete_buffer(GLuint buffer)
+	{
+		if (!buffer) return;
+
+		if (current.array_buffer == buffer) current.array_buffer = 0;
+		if (current.element_array_buffer == buffer) current.element_array_buffer = 0;
+
+		glDeleteBuffers(1, &buffer);
+	}
+
+	void delete_framebuffer(GLuint framebuffer)
+	{
+		if (!framebuffer) return;
+
+		if (current.framebuffer == framebuffer) current.framebuffer = 0;
+
+		glDeleteFramebuffers(1, &framebuffer);
+	}
+
+	void delete_program(GLuint program)
+	{
+		if (!program) return;
+
+		// Deleting the current program only flags it, but a new program may get its name
+		if (current.program == program)
+		{
+			use_program(0);
+		}
+
+		glDeleteProgram(program);
+	}
+
+	void begin_frame()
+	{
+		last_frame_stats = frame_stats;
+		frame_stats = {};
+	}
+
+	const statistics& get_frame_statistics()
+	{
+		return last_frame_stats;
+	}
+}
\ No newline at end of file
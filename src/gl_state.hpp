@@ -0,0 +1,89 @@
+#pragma once
+
+// CPU copy of the GL state the viewer changes, for the one context it renders with. As long as every change goes
+// through these functions the state is known without glGet queries, which wait for the GPU on many drivers,
+// and changes to the value already set are skipped.
+namespace gl_state
+{
+	// Texture units whose 2D binding is tracked
+	constexpr int texture_units = 8;
+
+	struct snapshot
+	{
+		GLuint program = 0;
+		GLuint framebuffer = 0;
+
+		GLenum active_texture = GL_TEXTURE0;
+		std::array<GLuint, texture_units> textures_2d{};
+
+		GLuint array_buffer = 0;
+		GLuint element_array_buffer = 0;
+
+		GLint pack_alignment = 4;
+		GLint unpack_alignment = 4;
+
+		glm::ivec4 viewport{};
+
+		// GL_DEPTH_TEST, GL_BLEND, GL_LIGHTING, GL_TEXTURE_2D and GL_CULL_FACE in this order
+		std::array<bool, 5> capabilities{};
+		GLenum blend_source = GL_ONE;
+		GLenum blend_destination = GL_ZERO;
+
+		GLenum matrix_mode = GL_MODELVIEW;
+		glm::dmat4 projection{1.0};
+		glm::dmat4 modelview{1.0};
+	};
+
+	struct statistics
+	{
+		unsigned long long calls = 0;
+		unsigned long long skipped = 0;
+	};
+
+	// Queries the whole state once, call it after the context is created and before anything else here
+	void initialize();
+
+	const snapshot& get();
+
+	// Issues only what differs from the current state
+	void restore(const snapshot& state);
+
+	void use_program(GLuint program);
+	void bind_framebuffer(GLuint framebuffer);
+
+	void active_texture(GLenum unit);
+	// On the active unit
+	void bind_texture_2d(GLuint texture);
+	GLuint get_texture_2d();
+
+	// Array and element array buffers are tracked, other targets are bound as they are
+	void bind_buffer(GLenum target, GLuint buffer);
+
+	// GL_PACK_ALIGNMENT or GL_UNPACK_ALIGNMENT
+	void set_alignment(GLenum name, GLint alignment);
+	GLint get_alignment(GLenum name);
+
+	void set_viewport(const glm::ivec4& viewport);
+	const glm::ivec4& get_viewport();
+
+	// Capabilities that aren't tracked are enabled or disabled as they are
+	void set_enabled(GLenum capability, bool enabled);
+	void set_blend_function(GLenum source, GLenum destination);
+
+	// GL_PROJECTION or GL_MODELVIEW, switches the matrix mode only if the matrix changes
+	void load_matrix(GLenum mode, const glm::dmat4& matrix);
+	const glm::dmat4& get_projection();
+	const glm::dmat4& get_modelview();
+
+	// Delete through these, GL unbinds deleted objects and may hand out their names again
+	void delete_texture(GLuint texture);
+	void delete_buffer(GLuint buffer);
+	void delete_framebuffer(GLuint framebuffer);
+	void delete_program(GLuint program);
+
+	// Starts counting the calls of a new frame
+	void begin_frame();
+
+	// State calls of the last complete frame, skipped ones weren't issued
+	const statistics& get_frame_statistics();
+}
\ No newline at end of file
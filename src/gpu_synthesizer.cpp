@@ -0,0 +1,176 @@
+#include "std_include.hpp"
+
+#include "gpu_synthesizer.hpp"
+#include "gl_state.hpp"
+
+namespace
+{
+	constexpr int rows_per_group = 64;
+}
+
+gpu_synthesizer::gpu_synthesizer()
+{
+	if (!is_supported())
+	{
+		throw std::runtime_error("GPU synthesis requires OpenGL 4.3");
+	}
+
+	// One invocation per row, the row is walked left to right as every pixel depends on earlier ones.
+	// Writes of an invocation are visible to its own later reads, so the output image doubles as the row buffer.
+	// The pattern comes from the same counter based generator as random_generator, byte for byte.
+	static auto compute_shader_source =
+		"#version 430\n"
+		"layout(local_size_x = 64) in;"
+		"layout(binding = 0) uniform sampler2D depth_sampler;"
+		"layout(binding = 0, rgba8) uniform image2D output_image;"
+		"uniform int width;"
+		"uniform int height;"
+		"uniform int pattern_width;"
+		"uniform int pattern_div;"
+		"uniform uint pattern_seed;"
+		"uniform int visualize;"
+		"uint mix_bits(uint value)"
+		"{"
+		"	value ^= value >> 16;"
+		"	value *= 0x7FEB352Du;"
+		"	value ^= value >> 15;"
+		"	value *= 0x846CA68Bu;"
+		"	value ^= value >> 16;"
+		"	return value;"
+		"}"
+		"float get_pattern_byte(uint key, int index)"
+		"{"
+		"	uint word = mix_bits(key + uint(index >> 2));"
+		"	return float((word >> uint((index & 3) * 8)) & 0xFFu) / 255.0;"
+		"}"
+		"int get_shift(int x, int y)"
+		"{"
+		"	float depth = texelFetch(depth_sampler, ivec2(x, y), 0).r;"
+		"	float level = floor(clamp((1.0 - depth) * 255.0, 0.0, 255.0));"
+		"	return int(min(floor((level + 0.5) / float(pattern_div)), float(255 / pattern_div)));"
+		"}"
+		"void main(void)"
+		"{"
+		"	int y = int(gl_GlobalInvocationID.x);"
+		"	if (y >= height) return;"
+		"	if (visualize != 0)"
+		"	{"
+		"		for (int x = 0; x < width; ++x)"
+		"		{"
+		"			float level = float(get_shift(x, y) * pattern_div) / 255.0;"
+		"			imageStore(output_image, ivec2(x, y), vec4(level, level, level, 1.0));"
+		"		}"
+		"		return;"
+		"	}"
+		"	if (pattern_width <= 0)"
+		"	{"
+		"		for (int x = 0; x < width; ++x) imageStore(output_image, ivec2(x, y), vec4(0.0, 0.0, 0.0, 1.0));"
+		"		return;"
+		"	}"
+		"	uint key = mix_bits(pattern_seed ^ mix_bits(uint(y) + 0x9E3779B9u));"
+		"	int x = 0;"
+		"	for (; x < min(pattern_width, width); ++x)"
+		"	{"
+		"		vec4 color = vec4(get_pattern_byte(key, x * 3), get_pattern_byte(key, x * 3 + 1), get_pattern_byte(key, x * 3 + 2), 1.0);"
+		"		imageStore(output_image, ivec2(x, y), color);"
+		"	}"
+		"	for (; x < width; ++x)"
+		"	{"
+		"		int source = min(x - pattern_width + get_shift(x, y), x - 1);"
+		"		imageStore(output_image, ivec2(x, y), imageLoad(output_image, ivec2(source, y)));"
+		"	}"
+		"}";
+
+	this->shader_program = std::make_unique<shader>(compute_shader_source);
+}
+
+gpu_synthesizer::~gpu_synthesizer()
+{
+	this->destroy_texture();
+}
+
+bool gpu_synthesizer::is_supported()
+{
+	return GLEW_VERSION_4_3 || GLEW_ARB_compute_shader;
+}
+
+GLuint gpu_synthesizer::synthesize(GLuint depth_texture, const synthesizer& settings)
+{
+	this->adjust_texture(settings.get_width(), settings.get_height());
+	this->dispatch(depth_texture, settings, false);
+
+	return this->output_texture;
+}
+
+GLuint gpu_synthesizer::visualize(GLuint depth_texture, const synthesizer& settings)
+{
+	this->adjust_texture(settings.get_width(), settings.get_height());
+	this->dispatch(depth_texture, settings, true);
+
+	return this->output_texture;
+}
+
+GLuint gpu_synthesizer::get_texture() const
+{
+	return this->output_texture;
+}
+
+void gpu_synthesizer::adjust_texture(int _width, int _height)
+{
+	if (this->output_texture && _width == this->width && _height == this->height) return;
+
+	this->destroy_texture();
+
+	this->width = _width;
+	this->height = _height;
+
+	const auto texture_2d = gl_state::get_texture_2d();
+
+	glGenTextures(1, &this->output_texture);
+	gl_state::bind_texture_2d(this->output_texture);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	// Immutable storage, image units can't bind anything else
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, std::max(1, this->width), std::max(1, this->height));
+
+	gl_state::bind_texture_2d(texture_2d);
+}
+
+void gpu_synthesizer::destroy_texture()
+{
+	gl_state::delete_texture(this->output_texture);
+	this->output_texture = 0;
+}
+
+void gpu_synthesizer::dispatch(GLuint depth_texture, const synthesizer& settings, bool visualize)
+{
+	const auto program = gl_state::get().program;
+	const auto active_texture = gl_state::get().active_texture;
+
+	gl_state::active_texture(GL_TEXTURE0);
+	const auto texture_2d = gl_state::get_texture_2d();
+	gl_state::bind_texture_2d(depth_texture);
+
+	glBindImageTexture(0, this->output_texture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
+
+	this->shader_program->use();
+	this->shader_program->set_uniform("width", this->width);
+	this->shader_program->set_uniform("height", this->height);
+	this->shader_program->set_uniform("pattern_width", settings.get_pattern_width());
+	this->shader_program->set_uniform("pattern_div", settings.get_pattern_div());
+	this->shader_program->set_uniform("pattern_seed", settings.get_pattern_seed());
+	this->shader_program->set_uniform("visualize", visualize ? 1 : 0);
+
+	glDispatchCompute(static_cast<GLuint>((this->height + rows_per_group - 1) / rows_per_group), 1, 1);
+
+	// The output is sampled or read back next
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+	gl_state::bind_texture_2d(texture_2d);
+	gl_state::active_texture(active_texture);
+	gl_state::use_program(program);
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <shader.hpp>
+#include <synthesizer.hpp>
+
+class gpu_synthesizer
+{
+public:
+	gpu_synthesizer();
+	~gpu_synthesizer();
+
+	// Compute shaders need OpenGL 4.3
+	static bool is_supported();
+
+	// Synthesizes the stereogram of a depth texture into an RGBA8 texture, nothing leaves the GPU.
+	// Dimensions and the current pattern are taken from the CPU synthesizer. Shifts are computed exactly
+	// like depth_reduction does and the pattern generator is ported, so the result matches the CPU path.
+	GLuint synthesize(GLuint depth_texture, const synthesizer& settings);
+	GLuint visualize(GLuint depth_texture, const synthesizer& settings);
+
+	GLuint get_texture() const;
+
+private:
+	int width = 0;
+	int height = 0;
+
+	GLuint output_texture = 0;
+
+	std::unique_ptr<shader> shader_program;
+
+	void adjust_texture(int width, int height);
+	void destroy_texture();
+
+	void dispatch(GLuint depth_texture, const synthesizer& settings, bool visualize);
+};
\ No newline at end of file
@@ -0,0 +1,301 @@
+#include "std_include.hpp"
+
+#include "image.hpp"
+
+namespace image
+{
+	namespace
+	{
+		std::string read_token(std::istream& stream)
+		{
+			std::string token;
+
+			while (stream.good())
+			{
+				auto value = stream.get();
+				if (value == EOF) break;
+
+				if (value == '#' && token.empty())
+				{
+					std::string comment;
+					std::getline(stream, comment);
+				}
+				else if (isspace(value))
+				{
+					if (!token.empty()) break;
+				}
+				else
+				{
+					token.push_back(static_cast<char>(value));
+				}
+			}
+
+			return token;
+		}
+
+		int read_number(std::istream& stream)
+		{
+			auto token = read_token(stream);
+			if (token.empty()) throw std::runtime_error("Unexpected end of image header");
+
+			return atoi(token.data());
+		}
+
+		void read_dimensions(std::istream& stream, depth_map& map)
+		{
+			map.width = read_number(stream);
+			map.height = read_number(stream);
+
+			if (map.width <= 0 || map.height <= 0)
+			{
+				throw std::runtime_error("Invalid image dimensions");
+			}
+		}
+
+		void read_pgm(std::istream& stream, depth_map& map)
+		{
+			read_dimensions(stream, map);
+
+			const auto max_value = read_number(stream);
+			const auto size = static_cast<size_t>(map.width) * map.height;
+
+			if (max_value <= 0 || max_value > 0xFFFF)
+			{
+				throw std::runtime_error("Invalid PGM maximum value");
+			}
+
+			if (max_value < 0x100)
+			{
+				std::vector<unsigned char> samples(size);
+				stream.read(reinterpret_cast<char*>(samples.data()), size);
+				if (!stream) throw std::runtime_error("Truncated PGM data");
+
+				if (max_value != 0xFF)
+				{
+					for (auto& sample : samples)
+					{
+						sample = static_cast<unsigned char>(std::min(sample * 0xFF / max_value, 0xFF));
+					}
+				}
+
+				map.samples = std::move(samples);
+			}
+			else
+			{
+				std::vector<unsigned char> bytes(size * 2);
+				stream.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+				if (!stream) throw std::runtime_error("Truncated PGM data");
+
+				// Rounded to the nearest level, 65535 * 65535 plus half the maximum still fits 32 bits
+				const auto maximum = static_cast<unsigned int>(max_value);
+
+				std::vector<unsigned short> samples(size);
+				for (size_t i = 0; i < size; ++i)
+				{
+					const auto sample = static_cast<unsigned int>((bytes[i * 2] << 8) | bytes[i * 2 + 1]); // Big endian
+					const auto scaled = maximum == 0xFFFF ? sample : (sample * 0xFFFFu + maximum / 2) / maximum;
+					samples[i] = static_cast<unsigned short>(std::min(scaled, 0xFFFFu));
+				}
+
+				map.samples = std::move(samples);
+			}
+		}
+
+		void read_pfm(std::istream& stream, depth_map& map, int channels)
+		{
+			read_dimensions(stream, map);
+
+			const auto scale = atof(read_token(stream).data());
+			const auto little_endian = scale < 0.0;
+			const auto size = static_cast<size_t>(map.width) * map.height;
+
+			std::vector<unsigned char> bytes(size * channels * sizeof(float));
+			stream.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+			if (!stream) throw std::runtime_error("Truncated PFM data");
+
+			std::vector<float> samples(size);
+			for (int y = 0; y < map.height; ++y)
+			{
+				// PFM stores rows bottom to top
+				auto source = bytes.data() + static_cast<size_t>(map.height - y - 1) * map.width * channels * sizeof(float);
+				auto target = samples.data() + static_cast<size_t>(y) * map.width;
+
+				for (int x = 0; x < map.width; ++x)
+				{
+					unsigned char value[sizeof(float)];
+					std::memcpy(value, source + static_cast<size_t>(x) * channels * sizeof(float), sizeof(value));
+
+					if (!little_endian)
+					{
+						std::reverse(std::begin(value), std::end(value));
+					}
+
+					std::memcpy(&target[x], value, sizeof(float));
+				}
+			}
+
+			map.samples = std::move(samples);
+		}
+
+		class png_writer
+		{
+		public:
+			png_writer(std::ostream& _stream) : stream(_stream)
+			{
+				for (unsigned int n = 0; n < 256; ++n)
+				{
+					auto c = n;
+					for (int k = 0; k < 8; ++k)
+					{
+						c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+					}
+
+					this->crc_table[n] = c;
+				}
+			}
+
+			void write_chunk(const char type[4], const std::string& data)
+			{
+				this->write_u32(static_cast<unsigned int>(data.size()));
+
+				std::string chunk(type, 4);
+				chunk.append(data);
+
+				this->stream.write(chunk.data(), chunk.size());
+				this->write_u32(this->crc(chunk));
+			}
+
+			// Zlib stream with stored (uncompressed) deflate blocks, the output is meant to be fast, not small
+			static std::string deflate_store(const std::string& data)
+			{
+				std::string result = "\x78\x01"s;
+
+				unsigned int a = 1, b = 0;
+				for (auto value : data)
+				{
+					a = (a + static_cast<unsigned char>(value)) % 65521;
+					b = (b + a) % 65521;
+				}
+
+				size_t offset = 0;
+				do
+				{
+					const auto length = std::min(data.size() - offset, size_t(0xFFFF));
+					const auto final_block = offset + length == data.size();
+
+					result.push_back(final_block ? 1 : 0);
+					result.push_back(static_cast<char>(length & 0xFF));
+					result.push_back(static_cast<char>(length >> 8));
+					result.push_back(static_cast<char>(~length & 0xFF));
+					result.push_back(static_cast<char>((~length >> 8) & 0xFF));
+					result.append(data, offset, length);
+
+					offset += length;
+				} while (offset < data.size());
+
+				append_u32(result, (b << 16) | a);
+				return result;
+			}
+
+			static void append_u32(std::string& data, unsigned int value)
+			{
+				for (int i = 3; i >= 0; --i)
+				{
+					data.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+				}
+			}
+
+		private:
+			std::ostream& stream;
+			unsigned int crc_table[256];
+
+			unsigned int crc(const std::string& data) const
+			{
+				auto c = 0xFFFFFFFFu;
+				for (auto value : data)
+				{
+					c = this->crc_table[(c ^ static_cast<unsigned char>(value)) & 0xFF] ^ (c >> 8);
+				}
+
+				return c ^ 0xFFFFFFFFu;
+			}
+
+			void write_u32(unsigned int value)
+			{
+				std::string data;
+				append_u32(data, value);
+				this->stream.write(data.data(), data.size());
+			}
+		};
+
+		std::ofstream open_output(const std::string& path)
+		{
+			std::ofstream stream(path, std::ios::binary);
+			if (!stream.good()) throw std::runtime_error("Unable to open " + path);
+
+			return stream;
+		}
+
+		void validate_pixels(int width, int height, gsl::span<const synthesizer::color> pixels)
+		{
+			if (width <= 0 || height <= 0 || pixels.size() < static_cast<std::ptrdiff_t>(width) * height)
+			{
+				throw std::runtime_error("Invalid image buffer");
+			}
+		}
+	}
+
+	depth_map load_depth_map(const std::string& path)
+	{
+		std::ifstream stream(path, std::ios::binary);
+		if (!stream.good()) throw std::runtime_error("Unable to open " + path);
+
+		depth_map map;
+		auto magic = read_token(stream);
+
+		if (magic == "P5") read_pgm(stream, map);
+		else if (magic == "Pf") read_pfm(stream, map, 1);
+		else if (magic == "PF") read_pfm(stream, map, 3);
+		else throw std::runtime_error("Unsupported depth map format: " + path);
+
+		return map;
+	}
+
+	void write_ppm(const std::string& path, int width, int height, gsl::span<const synthesizer::color> pixels)
+	{
+		validate_pixels(width, height, pixels);
+
+		auto stream = open_output(path);
+		stream << "P6\n" << width << " " << height << "\n255\n";
+		stream.write(reinterpret_cast<const char*>(pixels.data()), static_cast<std::streamsize>(width) * height * sizeof(synthesizer::color));
+	}
+
+	void write_png(const std::string& path, int width, int height, gsl::span<const synthesizer::color> pixels)
+	{
+		validate_pixels(width, height, pixels);
+
+		const auto row_length = width * sizeof(synthesizer::color);
+
+		std::string data;
+		data.reserve((row_length + 1) * height);
+
+		for (int y = 0; y < height; ++y)
+		{
+			data.push_back(0); // No filter
+			data.append(reinterpret_cast<const char*>(pixels.data() + static_cast<size_t>(y) * width), row_length);
+		}
+
+		std::string header;
+		png_writer::append_u32(header, width);
+		png_writer::append_u32(header, height);
+		header.append("\x08\x02\x00\x00\x00"s); // 8 bit, RGB, deflate, no filter, no interlace
+
+		auto stream = open_output(path);
+		stream.write("\x89PNG\r\n\x1A\n", 8);
+
+		png_writer writer(stream);
+		writer.write_chunk("IHDR", header);
+		writer.write_chunk("IDAT", png_writer::deflate_store(data));
+		writer.write_chunk("IEND", {});
+	}
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "synthesizer.hpp"
+
+namespace image
+{
+	struct depth_map
+	{
+		int width = 0;
+		int height = 0;
+
+		std::variant<std::vector<float>, std::vector<unsigned char>, std::vector<unsigned short>> samples;
+	};
+
+	// Supports binary PGM (8 and 16 bit) and PFM. Rows are returned top to bottom.
+	depth_map load_depth_map(const std::string& path);
+
+	void write_ppm(const std::string& path, int width, int height, gsl::span<const synthesizer::color> pixels);
+	void write_png(const std::string& path, int width, int height, gsl::span<const synthesizer::color> pixels);
+}
\ No newline at end of file
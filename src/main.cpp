@@ -4,11 +4,154 @@
 #include "camera.hpp"
 
 #include "model.hpp"
+#include "model_loader.hpp"
 #include "background.hpp"
 #include "stereogram.hpp"
+#include "status_display.hpp"
+#include "animation_exporter.hpp"
 
-#include "obj_loader.hpp"
+#include "mesh_optimizer.hpp"
+#include "thread_pool.hpp"
+#include "profiler.hpp"
+#include "gl_state.hpp"
 
+#include <charconv>
+
+namespace
+{
+	struct options
+	{
+		std::string model_path;
+
+		bool use_cache = true;
+		std::string cache_directory;
+
+		unsigned int optimizations = mesh_optimizer::none;
+		bool culling = true;
+		double lod_threshold = 1.0;
+
+		unsigned int threads = 0;
+		int chunk_rows = 0;
+
+		bool cpu_depth = false;
+		bool async_readback = false;
+
+		bool stable_pattern = false;
+
+		bool bgra = false;
+		bool mapped_upload = false;
+
+		bool pipelined = false;
+
+		bool gpu = false;
+		bool verify_gpu = false;
+
+		bool software_depth = false;
+		bool verify_software_depth = false;
+
+		bool profile = false;
+		std::string report_path;
+		std::string trace_path;
+
+		// Camera path of the animation to export, the window isn't shown then
+		std::string export_path;
+		animation_exporter::settings export_settings;
+	};
+
+	options parse_options(int argc, char* argv[])
+	{
+		options result;
+		result.export_settings.output = "animation.y4m";
+
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string argument = argv[i];
+
+			const auto next_value = [&]() -> std::string
+			{
+				if (i + 1 >= argc) throw std::runtime_error("Missing value for " + argument);
+				return argv[++i];
+			};
+
+			if (argument == "--threads") result.threads = std::max(0, atoi(next_value().data()));
+			else if (argument == "--chunk-rows") result.chunk_rows = std::max(0, atoi(next_value().data()));
+			else if (argument == "--cpu-depth") result.cpu_depth = true;
+			else if (argument == "--async-readback") result.async_readback = true;
+			else if (argument == "--no-cache") result.use_cache = false;
+			else if (argument == "--cache-dir") result.cache_directory = next_value();
+			else if (argument == "--optimize") result.optimizations |= mesh_optimizer::vertex_cache | mesh_optimizer::vertex_fetch;
+			else if (argument == "--optimize-overdraw") result.optimizations |= mesh_optimizer::vertex_cache | mesh_optimizer::vertex_fetch | mesh_optimizer::overdraw;
+			else if (argument == "--no-culling") result.culling = false;
+			else if (argument == "--lod") result.optimizations |= mesh_optimizer::lods;
+			else if (argument == "--lod-threshold") result.lod_threshold = std::max(0.0, atof(next_value().data()));
+			else if (argument == "--stable-pattern") result.stable_pattern = true;
+			else if (argument == "--bgra") result.bgra = true;
+			else if (argument == "--mapped-upload") result.mapped_upload = true;
+			else if (argument == "--pipelined") result.pipelined = true;
+			else if (argument == "--gpu") result.gpu = true;
+			else if (argument == "--verify-gpu") result.gpu = result.verify_gpu = true;
+			else if (argument == "--software-depth") result.software_depth = true;
+			else if (argument == "--verify-software-depth") result.software_depth = result.verify_software_depth = true;
+			else if (argument == "--profile") result.profile = true;
+			else if (argument == "--profile-report")
+			{
+				result.profile = true;
+				result.report_path = next_value();
+			}
+			else if (argument == "--trace") result.trace_path = next_value();
+			else if (argument == "--export") result.export_path = next_value();
+			else if (argument == "--export-output") result.export_settings.output = next_value();
+			else if (argument == "--export-size")
+			{
+				const auto value = next_value();
+				const auto end = value.data() + value.size();
+
+				auto& settings = result.export_settings;
+				const auto width = std::from_chars(value.data(), end, settings.width);
+				const auto separated = width.ec == std::errc() && width.ptr < end && *width.ptr == 'x';
+				const auto height = separated ? std::from_chars(width.ptr + 1, end, settings.height) : std::from_chars_result{ value.data(), std::errc::invalid_argument };
+
+				if (height.ec != std::errc() || height.ptr != end)
+				{
+					throw std::runtime_error("Invalid export size " + value + ", expected WIDTHxHEIGHT");
+				}
+			}
+			else if (argument == "--export-fps")
+			{
+				const auto value = next_value();
+				const auto end = value.data() + value.size();
+
+				auto& fps = result.export_settings.fps;
+				const auto parsed = std::from_chars(value.data(), end, fps);
+
+				if (parsed.ec != std::errc() || parsed.ptr != end || !std::isfinite(fps) || fps <= 0.0)
+				{
+					throw std::runtime_error("Invalid export frame rate " + value);
+				}
+			}
+			else if (argument == "--export-format")
+			{
+				const auto value = next_value();
+				if (value == "y4m") result.export_settings.output_format = animation_exporter::format::y4m;
+				else if (value == "rgb") result.export_settings.output_format = animation_exporter::format::rgb;
+				else throw std::runtime_error("Unknown export format " + value);
+			}
+			else if (argument.size() > 2 && argument.substr(0, 2) == "--") throw std::runtime_error("Unknown option " + argument);
+			else result.model_path = argument;
+		}
+
+		if (result.model_path.empty()) throw std::runtime_error("No model specified");
+		if (result.software_depth && result.gpu) throw std::runtime_error("Software depth can't be combined with GPU synthesis");
+
+		// The viewer has no console on Windows, stdout would be lost
+		if (result.profile && result.report_path.empty()) result.report_path = "profile.txt";
+
+		result.export_settings.threads = result.threads;
+		result.export_settings.stable_pattern = result.stable_pattern;
+
+		return result;
+	}
+}
 
 int main(int argc, char* argv[])
 {
@@ -16,23 +159,243 @@ int main(int argc, char* argv[])
 
 	try
 	{
+		auto options = parse_options(argc, argv);
+		thread_pool pool(options.threads);
+
 		window window(800, 600, "stereogram-model-viewer");
 		camera camera(&window);
 
+		std::unique_ptr<profiler> frame_profiler;
+		if (options.profile || !options.trace_path.empty())
+		{
+			frame_profiler = std::make_unique<profiler>();
+			frame_profiler->set_tracing(!options.trace_path.empty());
+			window.set_profiler(frame_profiler.get());
+		}
+
 		auto list = window.get_painter_list();
 
-		obj_loader loader(argv[1]);
-		model model = loader.get_model();
+		// The window paints right away, the model fills in while it is loaded
+		model model(options.software_depth);
+		model.set_culling(options.culling);
+		model.set_lod_threshold(options.lod_threshold);
+
+		model_loader::settings load_settings;
+		load_settings.path = options.model_path;
+		load_settings.use_cache = options.use_cache;
+		load_settings.cache_directory = options.cache_directory;
+		load_settings.optimizations = options.optimizations;
+		load_settings.threads = options.threads;
+		if (!options.export_path.empty() && options.export_settings.output == "-") load_settings.log = stderr;
+
+		model_loader loader(&model, std::move(load_settings));
+
+		stereogram stereogram(&pool, options.chunk_rows);
+		stereogram.set_depth_reduction(!options.cpu_depth);
+		stereogram.set_readback_mode(options.async_readback ? pixel_readback::mode::asynchronous : pixel_readback::mode::synchronous);
+		stereogram.set_stable_pattern(options.stable_pattern);
+		stereogram.set_color_format(options.bgra ? stereogram::color_format::bgra : stereogram::color_format::rgb);
+		stereogram.set_mapped_upload(options.mapped_upload);
+		stereogram.set_pipelined(options.pipelined);
+		stereogram.set_gpu_synthesis(options.gpu);
+		stereogram.set_gpu_verification(options.verify_gpu);
+		stereogram.set_software_depth(options.software_depth ? &model : nullptr);
+		stereogram.set_software_verification(options.verify_software_depth);
+		stereogram.set_profiler(frame_profiler.get());
 
-		stereogram stereogram;
 		background background(0.0, 0.0, 0.0);
 
+		if (!options.export_path.empty())
+		{
+			// The window only provides the GL context, every exported frame shows the complete model
+			while (!loader.is_complete())
+			{
+				loader.paint();
+				glfwPollEvents();
+				std::this_thread::sleep_for(1ms);
+			}
+
+			painter_list scene;
+			scene.add(&background);
+			scene.add(&model);
+
+			const camera_path path(options.export_path);
+
+			animation_exporter exporter(&camera, &scene, options.export_settings);
+			exporter.run(path);
+
+			return 0;
+		}
+
+		status_display status(&window, "stereogram-model-viewer");
+		status.add([&stereogram, last = pixel_readback::statistics{}]() mutable
+		{
+			const auto stats = stereogram.get_readback_statistics();
+			const auto frames = stats.frames - last.frames;
+			const auto stall_ms = frames ? (stats.stall_us - last.stall_us) / 1000.0 / frames : 0.0;
+			last = stats;
+
+			char buffer[64];
+			snprintf(buffer, sizeof(buffer), "readback stall %.2f ms/frame", stall_ms);
+			return std::string(buffer);
+		});
+
+		if (!options.gpu)
+		{
+			status.add([&stereogram, last = pixel_upload::statistics{}]() mutable
+			{
+				const auto stats = stereogram.get_upload_statistics();
+				const auto frames = stats.frames - last.frames;
+				const auto upload_ms = frames ? (stats.upload_us - last.upload_us + stats.stall_us - last.stall_us) / 1000.0 / frames : 0.0;
+				last = stats;
+
+				char buffer[64];
+				snprintf(buffer, sizeof(buffer), "upload %.2f ms/frame", upload_ms);
+				return std::string(buffer);
+			});
+
+			status.add([&stereogram, last = stereogram::present_statistics{}, last_time = std::chrono::high_resolution_clock::now()]() mutable
+			{
+				const auto now = std::chrono::high_resolution_clock::now();
+				const auto elapsed = std::chrono::duration<double>(now - last_time).count();
+				last_time = now;
+
+				const auto stats = stereogram.get_present_statistics();
+				const auto images = stats.images - last.images;
+				const auto latency_ms = images ? (stats.latency_us - last.latency_us) / 1000.0 / images : 0.0;
+				const auto frames_behind = images ? static_cast<double>(stats.frames_behind - last.frames_behind) / images : 0.0;
+				last = stats;
+
+				char buffer[96];
+				snprintf(buffer, sizeof(buffer), "stereograms %.0f/s, latency %.1f ms, %.1f frames", elapsed > 0.0 ? images / elapsed : 0.0, latency_ms, frames_behind);
+				return std::string(buffer);
+			});
+		}
+
+		status.add([&loader]()
+		{
+			const auto& stats = loader.get_statistics();
+
+			char buffer[64];
+			if (loader.is_complete())
+			{
+				snprintf(buffer, sizeof(buffer), "loaded in %.0f ms", stats.complete_ms);
+			}
+			else
+			{
+				snprintf(buffer, sizeof(buffer), "loading %.0f%%", stats.total_indices ? 100.0 * stats.loaded_indices / stats.total_indices : 0.0);
+			}
+
+			return std::string(buffer);
+		});
+
+		if (options.optimizations & mesh_optimizer::vertex_cache)
+		{
+			status.add([&loader]()
+			{
+				const auto& stats = loader.get_statistics();
+				if (!stats.optimized) return std::string();
+
+				char buffer[64];
+				snprintf(buffer, sizeof(buffer), "ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", stats.vertex_cache_before.acmr, stats.vertex_cache_after.acmr,
+					stats.vertex_cache_before.atvr, stats.vertex_cache_after.atvr);
+				return std::string(buffer);
+			});
+		}
+
+		if (options.optimizations & mesh_optimizer::lods)
+		{
+			status.add([&model]()
+			{
+				const auto& stats = model.get_statistics();
+				return "lod " + std::to_string(stats.level) + "/" + std::to_string(stats.levels - 1);
+			});
+		}
+
+		if (options.culling)
+		{
+			status.add([&model]()
+			{
+				const auto& stats = model.get_statistics();
+
+				char buffer[96];
+				snprintf(buffer, sizeof(buffer), "clusters %zu/%zu, triangles %zu/%zu", stats.visible_clusters, stats.clusters, stats.visible_triangles, stats.triangles);
+				return std::string(buffer);
+			});
+		}
+
+		if (options.stable_pattern)
+		{
+			status.add([&stereogram, last = stereogram::update_statistics{}]() mutable
+			{
+				const auto stats = stereogram.get_update_statistics();
+				const auto rows = stats.rows - last.rows;
+				const auto ratio = rows ? 100.0 * (stats.dirty_rows - last.dirty_rows) / rows : 0.0;
+				last = stats;
+
+				char buffer[64];
+				snprintf(buffer, sizeof(buffer), "dirty rows %.1f%%", ratio);
+				return std::string(buffer);
+			});
+		}
+
+		if (options.verify_gpu)
+		{
+			status.add([&stereogram]()
+			{
+				return "gpu mismatches " + std::to_string(stereogram.get_gpu_mismatches());
+			});
+		}
+
+		if (options.verify_software_depth)
+		{
+			status.add([&stereogram]()
+			{
+				return "depth mismatches " + std::to_string(stereogram.get_software_mismatches());
+			});
+		}
+
+		if (options.profile)
+		{
+			status.add([&frame_profiler]()
+			{
+				return frame_profiler->get_summary();
+			});
+
+			status.add([]()
+			{
+				const auto& stats = gl_state::get_frame_statistics();
+
+				char buffer[64];
+				snprintf(buffer, sizeof(buffer), "gl calls %llu/frame, %llu skipped", stats.calls, stats.skipped);
+				return std::string(buffer);
+			});
+		}
+
 		list->add(&camera);
 		list->add(&background);
-		list->add(&model);
+		list->add(&loader);
+
+		// Software depth alone needs no GL rendering of the model, verification compares against it
+		if (!options.software_depth || options.verify_software_depth)
+		{
+			list->add(&model);
+		}
+
 		list->add(&stereogram);
+		list->add(&status);
 
 		window.show();
+
+		if (options.profile)
+		{
+			frame_profiler->write_report(options.report_path);
+		}
+
+		if (!options.trace_path.empty())
+		{
+			frame_profiler->write_trace(options.trace_path);
+		}
 	}
 	catch (std::exception& e)
 	{
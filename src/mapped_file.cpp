@@ -0,0 +1,102 @@
+#include "std_include.hpp"
+
+#include "mapped_file.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+mapped_file::mapped_file(const std::string& path)
+{
+#ifdef _WIN32
+	this->file = CreateFileA(path.data(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (this->file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("Unable to open " + path);
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(this->file, &file_size))
+	{
+		this->close();
+		throw std::runtime_error("Unable to get the size of " + path);
+	}
+
+	this->size = static_cast<size_t>(file_size.QuadPart);
+
+	// Empty files can't be mapped, there is nothing to read anyway
+	if (!this->size) return;
+
+	this->mapping = CreateFileMappingA(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	this->data = this->mapping ? static_cast<const char*>(MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+	this->file = open(path.data(), O_RDONLY);
+	if (this->file < 0)
+	{
+		throw std::runtime_error("Unable to open " + path);
+	}
+
+	struct stat file_stat;
+	if (fstat(this->file, &file_stat) != 0)
+	{
+		this->close();
+		throw std::runtime_error("Unable to get the size of " + path);
+	}
+
+	this->size = static_cast<size_t>(file_stat.st_size);
+
+	// Empty files can't be mapped, there is nothing to read anyway
+	if (!this->size) return;
+
+	auto view = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, this->file, 0);
+	if (view != MAP_FAILED)
+	{
+		this->data = static_cast<const char*>(view);
+		madvise(view, this->size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	if (!this->data)
+	{
+		this->close();
+		throw std::runtime_error("Unable to map " + path);
+	}
+}
+
+mapped_file::~mapped_file()
+{
+	this->close();
+}
+
+const char* mapped_file::get_data() const
+{
+	return this->data;
+}
+
+size_t mapped_file::get_size() const
+{
+	return this->size;
+}
+
+void mapped_file::close()
+{
+#ifdef _WIN32
+	if (this->data) UnmapViewOfFile(this->data);
+	if (this->mapping) CloseHandle(this->mapping);
+	if (this->file != INVALID_HANDLE_VALUE) CloseHandle(this->file);
+
+	this->mapping = nullptr;
+	this->file = INVALID_HANDLE_VALUE;
+#else
+	if (this->data) munmap(const_cast<char*>(this->data), this->size);
+	if (this->file >= 0) ::close(this->file);
+
+	this->file = -1;
+#endif
+
+	this->data = nullptr;
+	this->size = 0;
+}
\ No newline at end of file
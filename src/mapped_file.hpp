@@ -0,0 +1,28 @@
+#pragma once
+
+// Read only view of a whole file, mapped into memory instead of read through a stream
+class mapped_file
+{
+public:
+	mapped_file(const std::string& path);
+	~mapped_file();
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	const char* get_data() const;
+	size_t get_size() const;
+
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#else
+	int file = -1;
+#endif
+
+	void close();
+};
\ No newline at end of file
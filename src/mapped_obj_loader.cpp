@@ -0,0 +1,338 @@
+#include "std_include.hpp"
+
+#include "mapped_obj_loader.hpp"
+#include "mapped_file.hpp"
+
+#include <charconv>
+
+namespace
+{
+	// Chunks smaller than this cost more to schedule than they save
+	constexpr size_t min_chunk_size = 1024 * 1024;
+
+	// Reported progress should advance in steps of a few percent, even without threads
+	constexpr size_t min_progress_chunks = 16;
+
+	bool is_space(char value)
+	{
+		return value == ' ' || value == '\t' || value == '\r';
+	}
+
+	const char* skip_spaces(const char* position, const char* end)
+	{
+		while (position < end && is_space(*position)) ++position;
+		return position;
+	}
+
+	const char* skip_token(const char* position, const char* end)
+	{
+		while (position < end && !is_space(*position)) ++position;
+		return position;
+	}
+
+	// from_chars doesn't take a leading plus, atof did
+	template <typename T>
+	const char* parse_number(const char* position, const char* end, T& value)
+	{
+		if (position < end && *position == '+') ++position;
+
+		const auto result = std::from_chars(position, end, value);
+		return result.ec == std::errc() ? result.ptr : nullptr;
+	}
+
+	// Same commands as obj_loader, everything else is ignored. Lines are numbered from 0 within the range,
+	// the return value is their number.
+	template <typename F>
+	size_t for_each_command(const char* position, const char* end, F&& callback)
+	{
+		size_t line = 0;
+
+		for (; position < end; ++line)
+		{
+			auto line_end = static_cast<const char*>(memchr(position, '\n', end - position));
+			if (!line_end) line_end = end;
+
+			if (line_end - position > 2 && is_space(position[1]) && (position[0] == 'v' || position[0] == 'f'))
+			{
+				callback(position[0], position + 2, line_end, line);
+			}
+
+			position = line_end + 1;
+		}
+
+		return line;
+	}
+
+	size_t count_face_vertices(const char* position, const char* end)
+	{
+		size_t count = 0;
+
+		while (true)
+		{
+			position = skip_spaces(position, end);
+			if (position >= end) break;
+
+			position = skip_token(position, end);
+			++count;
+		}
+
+		return count;
+	}
+}
+
+mapped_obj_loader::mapped_obj_loader(const std::string& path, thread_pool* _pool, const progress_callback& progress) : pool(_pool)
+{
+	mapped_file file(path);
+	this->file_size = file.get_size();
+
+	auto max_chunks = this->pool ? static_cast<size_t>(this->pool->get_thread_count()) * 4 : 1;
+	if (progress) max_chunks = std::max(max_chunks, min_progress_chunks);
+
+	auto chunks = this->split(file.get_data(), file.get_size(), max_chunks);
+
+	// A counting pass first, so every chunk is parsed straight into its final place in the mesh
+	this->for_each(static_cast<int>(chunks.size()), [&](int index)
+	{
+		mapped_obj_loader::count_chunk(chunks[index]);
+	});
+
+	this->allocate(chunks);
+
+	// Chunks finish in any order, progress only covers the parsed prefix of the file
+	std::mutex progress_mutex;
+	std::vector<unsigned char> parsed(chunks.size());
+	size_t parsed_chunks = 0;
+
+	std::visit([&](auto& indices)
+	{
+		this->for_each(static_cast<int>(chunks.size()), [&](int index)
+		{
+			mapped_obj_loader::parse_chunk(chunks[index], path, this->data.positions.data(), indices.data());
+
+			if (!progress) return;
+
+			std::lock_guard<std::mutex> _(progress_mutex);
+
+			parsed[index] = 1;
+
+			const auto previous = parsed_chunks;
+			while (parsed_chunks < chunks.size() && parsed[parsed_chunks]) ++parsed_chunks;
+
+			if (parsed_chunks != previous)
+			{
+				const auto& last = chunks[parsed_chunks - 1];
+				progress(this->data, last.vertex_offset + last.vertex_count, last.index_offset + last.index_count);
+			}
+		});
+	}, this->data.indices);
+}
+
+mapped_obj_loader::~mapped_obj_loader()
+{
+
+}
+
+mesh& mapped_obj_loader::get_mesh()
+{
+	return this->data;
+}
+
+const mesh& mapped_obj_loader::get_mesh() const
+{
+	return this->data;
+}
+
+size_t mapped_obj_loader::get_file_size() const
+{
+	return this->file_size;
+}
+
+std::vector<mapped_obj_loader::chunk> mapped_obj_loader::split(const char* data, size_t size, size_t max_chunks) const
+{
+	const auto chunk_count = std::clamp<size_t>(size / min_chunk_size, 1, max_chunks);
+
+	std::vector<chunk> chunks;
+	chunks.reserve(chunk_count);
+
+	const auto end = data + size;
+	auto begin = data;
+
+	for (size_t i = 1; i <= chunk_count && begin < end; ++i)
+	{
+		auto chunk_end = data + size * i / chunk_count;
+
+		// Every chunk ends after a newline, so no line is split between two of them
+		if (chunk_end < begin) chunk_end = begin;
+		if (chunk_end < end)
+		{
+			auto newline = static_cast<const char*>(memchr(chunk_end, '\n', end - chunk_end));
+			chunk_end = newline ? newline + 1 : end;
+		}
+
+		chunk current;
+		current.begin = begin;
+		current.end = chunk_end;
+
+		chunks.push_back(current);
+		begin = chunk_end;
+	}
+
+	return chunks;
+}
+
+void mapped_obj_loader::allocate(std::vector<chunk>& chunks)
+{
+	size_t vertex_count = 0, index_count = 0, line_count = 0;
+
+	for (auto& chunk : chunks)
+	{
+		chunk.vertex_offset = vertex_count;
+		chunk.index_offset = index_count;
+		chunk.line_offset = line_count;
+
+		vertex_count += chunk.vertex_count;
+		index_count += chunk.index_count;
+		line_count += chunk.line_count;
+	}
+
+	for (auto& chunk : chunks)
+	{
+		chunk.total_vertex_count = vertex_count;
+	}
+
+	this->data.positions.resize(vertex_count * 3);
+
+	// The vertex count is known before any index is parsed, so indices are written in their final size right away
+	if (vertex_count > 0x10000)
+	{
+		this->data.indices = std::vector<unsigned int>(index_count);
+	}
+	else
+	{
+		this->data.indices = std::vector<unsigned short>(index_count);
+	}
+}
+
+void mapped_obj_loader::for_each(int count, const std::function<void(int)>& callback)
+{
+	const auto run = [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i) callback(i);
+	};
+
+	if (this->pool && count > 1)
+	{
+		this->pool->parallel_for(count, 1, run);
+	}
+	else
+	{
+		run(0, count);
+	}
+}
+
+void mapped_obj_loader::count_chunk(chunk& chunk)
+{
+	chunk.line_count = for_each_command(chunk.begin, chunk.end, [&chunk](char command, const char* position, const char* end, size_t)
+	{
+		if (command == 'v')
+		{
+			++chunk.vertex_count;
+		}
+		else
+		{
+			const auto count = count_face_vertices(position, end);
+			if (count >= 3) chunk.index_count += (count - 2) * 3;
+		}
+	});
+}
+
+template <typename T>
+void mapped_obj_loader::parse_chunk(const chunk& chunk, const std::string& path, float* positions, T* indices)
+{
+	auto position_target = positions + chunk.vertex_offset * 3;
+	auto index_target = indices + chunk.index_offset;
+
+	for_each_command(chunk.begin, chunk.end, [&](char command, const char* position, const char* end, size_t line)
+	{
+		if (command == 'v')
+		{
+			position_target = mapped_obj_loader::parse_vertex(position, end, position_target);
+			return;
+		}
+
+		const auto vertex_count = static_cast<size_t>(position_target - positions) / 3;
+		index_target = mapped_obj_loader::parse_face(position, end, vertex_count, chunk.total_vertex_count, index_target);
+
+		if (!index_target)
+		{
+			throw std::runtime_error("Invalid face index in line " + std::to_string(chunk.line_offset + line + 1) + " of " + path);
+		}
+	});
+}
+
+float* mapped_obj_loader::parse_vertex(const char* position, const char* end, float* positions)
+{
+	// Parsed as double and rounded once, exactly like atof followed by a float cast
+	double vertex[3] = { 1.0, 1.0, 1.0 };
+
+	for (auto& value : vertex)
+	{
+		position = skip_spaces(position, end);
+		if (position >= end) break;
+
+		position = parse_number(position, end, value);
+		if (!position) break;
+	}
+
+	for (auto value : vertex)
+	{
+		*positions++ = static_cast<float>(value);
+	}
+
+	return positions;
+}
+
+template <typename T>
+T* mapped_obj_loader::parse_face(const char* position, const char* end, size_t vertex_count, size_t total_vertex_count, T* indices)
+{
+	T first = 0, previous = 0;
+	int count = 0;
+
+	while (true)
+	{
+		position = skip_spaces(position, end);
+		if (position >= end) break;
+
+		// Only the position index matters, texture and normal indices behind slashes are skipped
+		int value = 0;
+		parse_number(position, end, value);
+		position = skip_token(position, end);
+
+		// Negative indices count back from the last vertex defined so far, 0 is no index at all
+		const auto magnitude = static_cast<size_t>(std::abs(static_cast<long long>(value)));
+		if (value == 0 || (value > 0 && magnitude > total_vertex_count) || (value < 0 && magnitude > vertex_count)) return nullptr;
+
+		const auto current = static_cast<T>(value < 0 ? vertex_count - magnitude : magnitude - 1);
+
+		// Polygons are fanned, quads turn into the same two triangles obj_loader produces
+		if (count == 2)
+		{
+			*indices++ = first;
+			*indices++ = previous;
+			*indices++ = current;
+		}
+		else if (count > 2)
+		{
+			*indices++ = previous;
+			*indices++ = current;
+			*indices++ = first;
+		}
+
+		if (count == 0) first = current;
+
+		previous = current;
+		++count;
+	}
+
+	return indices;
+}
\ No newline at end of file
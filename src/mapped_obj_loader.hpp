@@ -0,0 +1,64 @@
+#pragma once
+
+#include "mesh.hpp"
+#include "thread_pool.hpp"
+
+// Parses Wavefront objects straight from the mapped file, split into newline aligned chunks that are
+// parsed in parallel. Produces the same mesh as obj_loader, but also resolves negative indices and fans
+// polygons with more than four vertices.
+class mapped_obj_loader
+{
+public:
+	// Called whenever the parsed part of the file grows. The mesh already has its final size, its first vertex_count
+	// positions and index_count indices are final. Calls come from the pool's threads one at a time, in file order.
+	using progress_callback = std::function<void(const mesh& data, size_t vertex_count, size_t index_count)>;
+
+	mapped_obj_loader(const std::string& path, thread_pool* pool = nullptr, const progress_callback& progress = {});
+	~mapped_obj_loader();
+
+	mesh& get_mesh();
+	const mesh& get_mesh() const;
+	size_t get_file_size() const;
+
+private:
+	struct chunk
+	{
+		const char* begin = nullptr;
+		const char* end = nullptr;
+
+		size_t vertex_count = 0;
+		size_t index_count = 0;
+
+		size_t vertex_offset = 0;
+		size_t index_offset = 0;
+
+		// Lines of the chunk and of all chunks before it
+		size_t line_count = 0;
+		size_t line_offset = 0;
+
+		// Of the whole file, indices may refer to vertices defined further down
+		size_t total_vertex_count = 0;
+	};
+
+	mesh data;
+	size_t file_size = 0;
+
+	thread_pool* pool = nullptr;
+
+	std::vector<chunk> split(const char* data, size_t size, size_t max_chunks) const;
+	void allocate(std::vector<chunk>& chunks);
+
+	void for_each(int count, const std::function<void(int index)>& callback);
+
+	static void count_chunk(chunk& chunk);
+
+	// Throws on face indices outside of the mesh, with their line in the file
+	template <typename T>
+	static void parse_chunk(const chunk& chunk, const std::string& path, float* positions, T* indices);
+
+	// Returns nullptr on an invalid index. Negative indices are resolved against the vertex_count vertices defined
+	// before the face, positive ones against all of them.
+	template <typename T>
+	static T* parse_face(const char* position, const char* end, size_t vertex_count, size_t total_vertex_count, T* indices);
+	static float* parse_vertex(const char* position, const char* end, float* positions);
+};
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+// Triangle mesh in the layout it is uploaded in: packed xyz float positions and 0 based triangle indices.
+// Indices are 16 bit whenever the vertex count allows it.
+struct mesh
+{
+	// Detail level, a range of the indices. Coarser levels follow the full mesh and index the same positions.
+	struct lod
+	{
+		unsigned int first_index;
+		unsigned int index_count;
+
+		// Estimated distance the level deviates from the full mesh, in model units
+		float error;
+	};
+
+	std::vector<float> positions;
+	std::variant<std::vector<unsigned short>, std::vector<unsigned int>> indices;
+
+	// Empty if all indices form a single level
+	std::vector<lod> lods;
+
+	size_t get_vertex_count() const
+	{
+		return this->positions.size() / 3;
+	}
+
+	size_t get_index_count() const
+	{
+		return std::visit([](auto& values) { return values.size(); }, this->indices);
+	}
+
+	size_t get_memory_size() const
+	{
+		return this->positions.size() * sizeof(float) + std::visit([](auto& values)
+		{
+			return values.size() * sizeof(values[0]);
+		}, this->indices);
+	}
+
+	// Narrows to 16 bit indices if every vertex can be addressed with them
+	void set_indices(std::vector<unsigned int>&& values)
+	{
+		if (this->get_vertex_count() > 0x10000)
+		{
+			this->indices = std::move(values);
+			return;
+		}
+
+		std::vector<unsigned short> narrow_values(values.size());
+		std::transform(values.begin(), values.end(), narrow_values.begin(), [](unsigned int value)
+		{
+			return static_cast<unsigned short>(value);
+		});
+
+		values = {};
+		this->indices = std::move(narrow_values);
+	}
+};
\ No newline at end of file
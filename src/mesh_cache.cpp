@@ -0,0 +1,262 @@
+#include "std_include.hpp"
+
+#include "mesh_cache.hpp"
+
+namespace
+{
+	constexpr unsigned int cache_version = 3;
+	constexpr char cache_magic[4] = { 'S', 'M', 'S', 'H' };
+
+	// Little endian, followed by lod_count detail levels, vertex_count * 3 floats and index_count indices of index_size bytes
+	struct header
+	{
+		char magic[4];
+		unsigned int version;
+
+		unsigned long long source_size;
+		long long source_time;
+
+		unsigned int vertex_count;
+		unsigned int index_count;
+		unsigned int index_size;
+		unsigned int optimizations;
+
+		float bounds_min[3];
+		float bounds_max[3];
+
+		unsigned int lod_count;
+		unsigned int reserved[3];
+	};
+
+	static_assert(sizeof(header) == 80);
+	static_assert(sizeof(mesh::lod) == 12);
+
+	struct source_state
+	{
+		unsigned long long size;
+		long long time;
+	};
+
+	source_state get_source_state(const std::string& source)
+	{
+		return {
+			static_cast<unsigned long long>(std::filesystem::file_size(source)),
+			static_cast<long long>(std::filesystem::last_write_time(source).time_since_epoch().count()),
+		};
+	}
+
+	template <typename T>
+	bool are_indices_valid(const char* data, unsigned int count, unsigned int vertex_count)
+	{
+		const auto indices = reinterpret_cast<const T*>(data);
+		return std::all_of(indices, indices + count, [vertex_count](T index)
+		{
+			return index < vertex_count;
+		});
+	}
+
+	const header* get_header(const mapped_file& file)
+	{
+		if (file.get_size() < sizeof(header)) return nullptr;
+
+		auto result = reinterpret_cast<const header*>(file.get_data());
+		if (std::memcmp(result->magic, cache_magic, sizeof(cache_magic)) != 0 || result->version != cache_version) return nullptr;
+
+		if (result->index_size != sizeof(unsigned short) && result->index_size != sizeof(unsigned int)) return nullptr;
+
+		const auto expected_size = sizeof(header) + result->lod_count * 1ull * sizeof(mesh::lod) + result->vertex_count * 3ull * sizeof(float) +
+			result->index_count * 1ull * result->index_size;
+		if (file.get_size() != expected_size) return nullptr;
+
+		// Levels outside the indices would make the renderer read past the index buffer
+		auto lods = reinterpret_cast<const mesh::lod*>(file.get_data() + sizeof(header));
+		for (unsigned int i = 0; i < result->lod_count; ++i)
+		{
+			if (lods[i].first_index + 1ull * lods[i].index_count > result->index_count) return nullptr;
+		}
+
+		// So would indices past the vertices, and the optimizer and simplifier index arrays with them
+		const auto indices = file.get_data() + file.get_size() - result->index_count * 1ull * result->index_size;
+		const auto valid = result->index_size == sizeof(unsigned short)
+			? are_indices_valid<unsigned short>(indices, result->index_count, result->vertex_count)
+			: are_indices_valid<unsigned int>(indices, result->index_count, result->vertex_count);
+
+		if (!valid) return nullptr;
+
+		return result;
+	}
+}
+
+mesh_cache::entry::entry(const std::string& path) : file(path)
+{
+	auto file_header = get_header(this->file);
+	if (!file_header)
+	{
+		throw std::runtime_error("Invalid mesh cache entry " + path);
+	}
+
+	auto lods_data = reinterpret_cast<const mesh::lod*>(this->file.get_data() + sizeof(header));
+	auto positions_data = reinterpret_cast<const float*>(lods_data + file_header->lod_count);
+	auto indices_data = positions_data + file_header->vertex_count * 3ull;
+
+	this->lods = gsl::span<const mesh::lod>(lods_data, file_header->lod_count);
+	this->positions = gsl::span<const float>(positions_data, file_header->vertex_count * 3ull);
+
+	if (file_header->index_size == sizeof(unsigned short))
+	{
+		this->indices = gsl::span<const unsigned short>(reinterpret_cast<const unsigned short*>(indices_data), file_header->index_count);
+	}
+	else
+	{
+		this->indices = gsl::span<const unsigned int>(reinterpret_cast<const unsigned int*>(indices_data), file_header->index_count);
+	}
+
+	this->bounds_min = { file_header->bounds_min[0], file_header->bounds_min[1], file_header->bounds_min[2] };
+	this->bounds_max = { file_header->bounds_max[0], file_header->bounds_max[1], file_header->bounds_max[2] };
+
+	this->source_size = file_header->source_size;
+	this->source_time = file_header->source_time;
+	this->optimizations = file_header->optimizations;
+}
+
+gsl::span<const float> mesh_cache::entry::get_positions() const
+{
+	return this->positions;
+}
+
+mesh_cache::index_span mesh_cache::entry::get_indices() const
+{
+	return this->indices;
+}
+
+gsl::span<const mesh::lod> mesh_cache::entry::get_lods() const
+{
+	return this->lods;
+}
+
+glm::vec3 mesh_cache::entry::get_bounds_min() const
+{
+	return this->bounds_min;
+}
+
+glm::vec3 mesh_cache::entry::get_bounds_max() const
+{
+	return this->bounds_max;
+}
+
+mesh_cache::mesh_cache(std::filesystem::path _directory) : directory(std::move(_directory))
+{
+
+}
+
+std::filesystem::path mesh_cache::get_path(const std::string& source) const
+{
+	const auto source_path = std::filesystem::absolute(source);
+	const auto key = source_path.generic_string();
+
+	// FNV-1a of the absolute path, the name alone stays readable
+	unsigned long long hash = 0xCBF29CE484222325ull;
+	for (auto value : key)
+	{
+		hash = (hash ^ static_cast<unsigned char>(value)) * 0x100000001B3ull;
+	}
+
+	char name[32];
+	snprintf(name, sizeof(name), "-%016llx.mesh", hash);
+
+	const auto folder = this->directory.empty() ? source_path.parent_path() / ".stereogram-cache" : this->directory;
+	return folder / (source_path.stem().string() + name);
+}
+
+std::unique_ptr<mesh_cache::entry> mesh_cache::find(const std::string& source, unsigned int optimizations) const
+{
+	const auto path = this->get_path(source);
+
+	std::error_code error;
+	if (!std::filesystem::is_regular_file(path, error)) return {};
+
+	try
+	{
+		const auto state = get_source_state(source);
+
+		auto result = std::make_unique<entry>(path.string());
+
+		// The entry is only valid for the source as it was when the entry was written
+		if (result->source_size != state.size || result->source_time != state.time) return {};
+		if (result->optimizations != optimizations) return {};
+
+		return result;
+	}
+	catch (std::exception&)
+	{
+		return {};
+	}
+}
+
+void mesh_cache::store(const std::string& source, const mesh& mesh, unsigned int optimizations) const
+{
+	const auto path = this->get_path(source);
+	std::filesystem::create_directories(path.parent_path());
+
+	const auto state = get_source_state(source);
+
+	header file_header{};
+	std::memcpy(file_header.magic, cache_magic, sizeof(cache_magic));
+	file_header.version = cache_version;
+	file_header.source_size = state.size;
+	file_header.source_time = state.time;
+	file_header.vertex_count = static_cast<unsigned int>(mesh.get_vertex_count());
+	file_header.index_count = static_cast<unsigned int>(mesh.get_index_count());
+	file_header.index_size = static_cast<unsigned int>(std::holds_alternative<std::vector<unsigned short>>(mesh.indices) ? sizeof(unsigned short) : sizeof(unsigned int));
+	file_header.optimizations = optimizations;
+	file_header.lod_count = static_cast<unsigned int>(mesh.lods.size());
+
+	glm::vec3 bounds_min(std::numeric_limits<float>::max()), bounds_max(std::numeric_limits<float>::lowest());
+
+	for (size_t i = 0; i + 2 < mesh.positions.size(); i += 3)
+	{
+		const glm::vec3 position(mesh.positions[i], mesh.positions[i + 1], mesh.positions[i + 2]);
+
+		bounds_min = glm::min(bounds_min, position);
+		bounds_max = glm::max(bounds_max, position);
+	}
+
+	if (mesh.positions.empty())
+	{
+		bounds_min = bounds_max = glm::vec3(0.0f);
+	}
+
+	for (int i = 0; i < 3; ++i)
+	{
+		file_header.bounds_min[i] = bounds_min[i];
+		file_header.bounds_max[i] = bounds_max[i];
+	}
+
+	// Written under a temporary name and renamed, so readers never map a half written entry
+	auto temporary_path = path;
+	temporary_path += ".tmp";
+
+	{
+		std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			throw std::runtime_error("Unable to write " + temporary_path.string());
+		}
+
+		file.write(reinterpret_cast<const char*>(&file_header), sizeof(file_header));
+		file.write(reinterpret_cast<const char*>(mesh.lods.data()), static_cast<std::streamsize>(mesh.lods.size() * sizeof(mesh::lod)));
+		file.write(reinterpret_cast<const char*>(mesh.positions.data()), static_cast<std::streamsize>(mesh.positions.size() * sizeof(float)));
+
+		std::visit([&file](auto& indices)
+		{
+			file.write(reinterpret_cast<const char*>(indices.data()), static_cast<std::streamsize>(indices.size() * sizeof(indices[0])));
+		}, mesh.indices);
+
+		if (!file)
+		{
+			throw std::runtime_error("Unable to write " + temporary_path.string());
+		}
+	}
+
+	std::filesystem::rename(temporary_path, path);
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "mesh.hpp"
+#include "mapped_file.hpp"
+
+// Binary copies of parsed meshes, ready to be handed to the GPU without parsing.
+// Entries are keyed by the source path and only used while the source's size and modification time match.
+class mesh_cache
+{
+public:
+	using index_span = std::variant<gsl::span<const unsigned short>, gsl::span<const unsigned int>>;
+
+	class entry
+	{
+	public:
+		entry(const std::string& path);
+
+		gsl::span<const float> get_positions() const;
+
+		// Same index size as the mesh the entry was stored from
+		index_span get_indices() const;
+
+		// Detail levels within the indices, empty if the entry has only one
+		gsl::span<const mesh::lod> get_lods() const;
+
+		glm::vec3 get_bounds_min() const;
+		glm::vec3 get_bounds_max() const;
+
+	private:
+		friend class mesh_cache;
+
+		mapped_file file;
+
+		unsigned long long source_size = 0;
+		long long source_time = 0;
+		unsigned int optimizations = 0;
+
+		gsl::span<const float> positions;
+		index_span indices;
+		gsl::span<const mesh::lod> lods;
+
+		glm::vec3 bounds_min{};
+		glm::vec3 bounds_max{};
+	};
+
+	// An empty directory keeps the cache in a .stereogram-cache folder next to each source
+	mesh_cache(std::filesystem::path directory = {});
+
+	std::filesystem::path get_path(const std::string& source) const;
+
+	// Returns nullptr if there is no valid entry for the current state of the source.
+	// Optimizations are the mesh_optimizer flags the stored mesh went through, they have to match as well.
+	std::unique_ptr<entry> find(const std::string& source, unsigned int optimizations = 0) const;
+	void store(const std::string& source, const mesh& mesh, unsigned int optimizations = 0) const;
+
+private:
+	std::filesystem::path directory;
+};
\ No newline at end of file
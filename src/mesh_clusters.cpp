@@ -0,0 +1,154 @@
+#include "std_include.hpp"
+
+#include "mesh_clusters.hpp"
+
+namespace mesh_clusters
+{
+	namespace
+	{
+		// Small enough to cull a useful share of a large model, large enough to keep draws and frustum tests cheap
+		constexpr size_t triangles_per_cluster = 1024;
+
+		struct triangle_range
+		{
+			size_t begin;
+			size_t end;
+		};
+
+		// Splits the triangles at the median of their centroids along the longest axis until the ranges are small enough.
+		// Triangles keep their original relative order inside a range, so a vertex cache optimized order survives.
+		template <typename T>
+		std::vector<triangle_range> split_triangles(gsl::span<const float> positions, gsl::span<const T> indices, std::vector<unsigned int>& triangles)
+		{
+			const auto triangle_count = static_cast<size_t>(indices.size()) / 3;
+			const auto vertex_count = static_cast<size_t>(positions.size()) / 3;
+
+			std::vector<glm::vec3> centroids(triangle_count, glm::vec3(0.0f));
+			for (size_t i = 0; i < triangle_count; ++i)
+			{
+				for (size_t c = 0; c < 3; ++c)
+				{
+					const size_t index = indices[i * 3 + c];
+					if (index >= vertex_count) continue;
+
+					centroids[i] += glm::vec3(positions[index * 3], positions[index * 3 + 1], positions[index * 3 + 2]) / 3.0f;
+				}
+			}
+
+			triangles.resize(triangle_count);
+			for (size_t i = 0; i < triangle_count; ++i) triangles[i] = static_cast<unsigned int>(i);
+
+			std::vector<triangle_range> result;
+			if (!triangle_count) return result;
+
+			std::vector<triangle_range> pending{ { 0, triangle_count } };
+
+			while (!pending.empty())
+			{
+				const auto range = pending.back();
+				pending.pop_back();
+
+				const auto begin = triangles.begin() + range.begin;
+				const auto end = triangles.begin() + range.end;
+
+				if (range.end - range.begin <= triangles_per_cluster)
+				{
+					std::sort(begin, end);
+					result.push_back(range);
+					continue;
+				}
+
+				glm::vec3 bounds_min(std::numeric_limits<float>::max()), bounds_max(std::numeric_limits<float>::lowest());
+				for (auto i = begin; i != end; ++i)
+				{
+					bounds_min = glm::min(bounds_min, centroids[*i]);
+					bounds_max = glm::max(bounds_max, centroids[*i]);
+				}
+
+				const auto extent = bounds_max - bounds_min;
+				const auto axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+				const auto middle = range.begin + (range.end - range.begin) / 2;
+				std::nth_element(begin, triangles.begin() + middle, end, [&centroids, axis](unsigned int a, unsigned int b)
+				{
+					return centroids[a][axis] < centroids[b][axis];
+				});
+
+				// The first half is split next, clusters end up in a spatially coherent order
+				pending.push_back({ middle, range.end });
+				pending.push_back({ range.begin, middle });
+			}
+
+			return result;
+		}
+
+		template <typename T>
+		std::vector<level> build_levels(gsl::span<const float> positions, gsl::span<const T> indices, gsl::span<const mesh::lod> lods, std::vector<T>& ordered)
+		{
+			std::vector<mesh::lod> ranges(lods.begin(), lods.end());
+			if (ranges.empty()) ranges.push_back({ 0, static_cast<unsigned int>(indices.size()), 0.0f });
+
+			const auto vertex_count = static_cast<size_t>(positions.size()) / 3;
+			ordered.reserve(ordered.size() + static_cast<size_t>(indices.size()));
+
+			std::vector<unsigned int> triangles;
+
+			std::vector<level> result;
+			result.reserve(ranges.size());
+
+			for (auto& range : ranges)
+			{
+				const auto level_indices = indices.subspan(range.first_index, range.index_count);
+				const auto triangle_ranges = split_triangles(positions, level_indices, triangles);
+
+				level entry{};
+				entry.error = range.error;
+				entry.first_index = static_cast<int>(ordered.size());
+				entry.index_count = static_cast<int>(triangles.size() * 3);
+				entry.clusters.reserve(triangle_ranges.size());
+
+				for (auto& triangle_range : triangle_ranges)
+				{
+					cluster target{};
+					target.first_index = static_cast<int>(ordered.size());
+					target.index_count = static_cast<int>((triangle_range.end - triangle_range.begin) * 3);
+					target.bounds_min = glm::vec3(std::numeric_limits<float>::max());
+					target.bounds_max = glm::vec3(std::numeric_limits<float>::lowest());
+
+					for (auto i = triangle_range.begin; i < triangle_range.end; ++i)
+					{
+						for (size_t c = 0; c < 3; ++c)
+						{
+							const auto index = level_indices[triangles[i] * 3ull + c];
+							ordered.push_back(index);
+
+							if (index >= vertex_count) continue;
+
+							const glm::vec3 position(positions[index * 3ull], positions[index * 3ull + 1], positions[index * 3ull + 2]);
+							target.bounds_min = glm::min(target.bounds_min, position);
+							target.bounds_max = glm::max(target.bounds_max, position);
+						}
+					}
+
+					entry.clusters.push_back(target);
+				}
+
+				result.push_back(std::move(entry));
+			}
+
+			return result;
+		}
+	}
+
+	std::vector<level> build(gsl::span<const float> positions, gsl::span<const unsigned int> indices, gsl::span<const mesh::lod> lods,
+		std::vector<unsigned int>& ordered)
+	{
+		return build_levels(positions, indices, lods, ordered);
+	}
+
+	std::vector<level> build(gsl::span<const float> positions, gsl::span<const unsigned short> indices, gsl::span<const mesh::lod> lods,
+		std::vector<unsigned short>& ordered)
+	{
+		return build_levels(positions, indices, lods, ordered);
+	}
+}
\ No newline at end of file
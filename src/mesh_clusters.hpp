@@ -0,0 +1,34 @@
+#pragma once
+
+#include "mesh.hpp"
+
+// Splits detail levels into spatially compact groups of triangles, the unit models are culled in
+namespace mesh_clusters
+{
+	// Spatially close triangles, stored contiguously in the index buffer
+	struct cluster
+	{
+		int first_index;
+		int index_count;
+
+		glm::vec3 bounds_min;
+		glm::vec3 bounds_max;
+	};
+
+	struct level
+	{
+		float error;
+
+		int first_index;
+		int index_count;
+
+		std::vector<cluster> clusters;
+	};
+
+	// Appends the indices of every level to ordered in cluster order, ranges refer to ordered.
+	// Without lods all indices form one level.
+	std::vector<level> build(gsl::span<const float> positions, gsl::span<const unsigned int> indices, gsl::span<const mesh::lod> lods,
+		std::vector<unsigned int>& ordered);
+	std::vector<level> build(gsl::span<const float> positions, gsl::span<const unsigned short> indices, gsl::span<const mesh::lod> lods,
+		std::vector<unsigned short>& ordered);
+}
\ No newline at end of file
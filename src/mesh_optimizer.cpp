@@ -0,0 +1,434 @@
+#include "std_include.hpp"
+
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+
+namespace mesh_optimizer
+{
+	namespace
+	{
+		// Modelled LRU cache of the vertex cache optimization, larger than the FIFO it is measured against
+		constexpr int cache_size = 32;
+		constexpr int max_valence = 32;
+
+		// FIFO cache the overdraw clusters are measured with, the same as analyze_vertex_cache's default
+		constexpr unsigned int fifo_size = 16;
+
+		constexpr size_t max_lods = 8;
+
+		// Scores from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+		struct score_table
+		{
+			float cache[cache_size + 3];
+			float valence[max_valence + 1];
+
+			score_table()
+			{
+				for (int i = 0; i < cache_size + 3; ++i)
+				{
+					// The last triangle's vertices get a fixed score, so their order doesn't matter
+					this->cache[i] = i < 3 ? 0.75f : powf(1.0f - static_cast<float>(i - 3) / static_cast<float>(cache_size - 3), 1.5f);
+				}
+
+				this->valence[0] = 0.0f;
+				for (int i = 1; i <= max_valence; ++i)
+				{
+					// Vertices with few triangles left are finished first, to get them out of the way
+					this->valence[i] = 2.0f / sqrtf(static_cast<float>(i));
+				}
+			}
+
+			float get(int cache_position, unsigned int valence) const
+			{
+				if (valence == 0) return -1.0f;
+
+				const auto cache_score = cache_position >= 0 && cache_position < cache_size ? this->cache[cache_position] : 0.0f;
+				const auto valence_score = valence <= max_valence ? this->valence[valence] : 2.0f / sqrtf(static_cast<float>(valence));
+
+				return cache_score + valence_score;
+			}
+		};
+
+		template <typename T>
+		statistics analyze_vertex_cache(gsl::span<const T> indices, size_t vertex_count, unsigned int size)
+		{
+			statistics result;
+			if (indices.size() < 3 || !vertex_count) return result;
+
+			std::vector<unsigned int> timestamps(vertex_count, 0);
+			unsigned int timestamp = size + 1;
+			size_t misses = 0;
+
+			for (auto index : indices)
+			{
+				if (index >= vertex_count) continue;
+
+				// A vertex stays cached until size more vertices have been transformed
+				if (timestamp - timestamps[index] > size)
+				{
+					timestamps[index] = timestamp++;
+					++misses;
+				}
+			}
+
+			result.acmr = static_cast<double>(misses) / static_cast<double>(static_cast<size_t>(indices.size()) / 3);
+			result.atvr = static_cast<double>(misses) / static_cast<double>(vertex_count);
+			return result;
+		}
+
+		template <typename T>
+		void optimize_vertex_cache(std::vector<T>& indices, size_t vertex_count)
+		{
+			static const score_table scores;
+
+			const auto triangle_count = indices.size() / 3;
+			if (!triangle_count) return;
+
+			// Triangles of every vertex, packed into one array
+			std::vector<unsigned int> valence(vertex_count, 0);
+			for (auto index : indices) ++valence[index];
+
+			std::vector<unsigned int> offsets(vertex_count + 1, 0);
+			for (size_t i = 0; i < vertex_count; ++i) offsets[i + 1] = offsets[i] + valence[i];
+
+			std::vector<unsigned int> adjacency(indices.size());
+			{
+				auto fill = offsets;
+				for (size_t i = 0; i < indices.size(); ++i)
+				{
+					adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+				}
+			}
+
+			std::vector<int> cache_positions(vertex_count, -1);
+			std::vector<float> vertex_scores(vertex_count);
+			for (size_t i = 0; i < vertex_count; ++i) vertex_scores[i] = scores.get(-1, valence[i]);
+
+			std::vector<unsigned char> emitted(triangle_count, 0);
+
+			std::vector<T> result;
+			result.reserve(indices.size());
+
+			std::vector<unsigned int> cache, next_cache;
+			cache.reserve(cache_size + 3);
+			next_cache.reserve(cache_size + 3);
+
+			size_t scan_position = 0;
+			auto best_triangle = std::numeric_limits<size_t>::max();
+
+			for (size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count)
+			{
+				// Nothing adjacent to the cache is left, continue with the next triangle in input order
+				if (best_triangle == std::numeric_limits<size_t>::max())
+				{
+					while (emitted[scan_position]) ++scan_position;
+					best_triangle = scan_position;
+				}
+
+				const auto triangle = best_triangle;
+				emitted[triangle] = 1;
+
+				const unsigned int corners[3] = { indices[triangle * 3], indices[triangle * 3 + 1], indices[triangle * 3 + 2] };
+
+				for (auto vertex : corners)
+				{
+					result.push_back(static_cast<T>(vertex));
+
+					// Drop the triangle from the vertex's list of remaining triangles
+					auto begin = adjacency.begin() + offsets[vertex];
+					auto end = begin + valence[vertex];
+					auto entry = std::find(begin, end, static_cast<unsigned int>(triangle));
+
+					if (entry != end)
+					{
+						std::iter_swap(entry, end - 1);
+						--valence[vertex];
+					}
+				}
+
+				// Move the triangle's vertices to the front of the LRU cache
+				next_cache.assign(corners, corners + 3);
+				for (auto vertex : cache)
+				{
+					if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+					{
+						next_cache.push_back(vertex);
+					}
+				}
+
+				for (size_t i = cache_size; i < next_cache.size(); ++i)
+				{
+					cache_positions[next_cache[i]] = -1;
+					vertex_scores[next_cache[i]] = scores.get(-1, valence[next_cache[i]]);
+				}
+
+				if (next_cache.size() > cache_size) next_cache.resize(cache_size);
+				std::swap(cache, next_cache);
+
+				for (size_t i = 0; i < cache.size(); ++i)
+				{
+					cache_positions[cache[i]] = static_cast<int>(i);
+					vertex_scores[cache[i]] = scores.get(static_cast<int>(i), valence[cache[i]]);
+				}
+
+				// Only triangles touching the cache changed their score, the best next one is among them
+				best_triangle = std::numeric_limits<size_t>::max();
+				auto best_score = 0.0f;
+
+				for (auto vertex : cache)
+				{
+					for (auto i = offsets[vertex]; i < offsets[vertex] + valence[vertex]; ++i)
+					{
+						const auto candidate = adjacency[i];
+						const auto score = vertex_scores[indices[candidate * 3]] + vertex_scores[indices[candidate * 3 + 1]] + vertex_scores[indices[candidate * 3 + 2]];
+
+						if (score > best_score)
+						{
+							best_score = score;
+							best_triangle = candidate;
+						}
+					}
+				}
+			}
+
+			indices = std::move(result);
+		}
+
+		template <typename T>
+		void optimize_overdraw(std::vector<T>& indices, const std::vector<float>& positions, double threshold)
+		{
+			const auto triangle_count = indices.size() / 3;
+			const auto vertex_count = positions.size() / 3;
+			if (triangle_count < 2) return;
+
+			const auto base = analyze_vertex_cache(gsl::span<const T>(indices), vertex_count, fifo_size);
+
+			// A cluster ends as soon as its own ACMR, measured from an empty cache, is within the threshold.
+			// Clusters then keep about the same cache efficiency in any order (Sander et al., "Fast Triangle Reordering").
+			std::vector<size_t> cluster_starts{ 0 };
+			{
+				std::vector<unsigned int> timestamps(vertex_count, 0);
+				unsigned int timestamp = fifo_size + 1;
+				size_t misses = 0;
+
+				for (size_t i = 0; i < triangle_count; ++i)
+				{
+					for (size_t c = 0; c < 3; ++c)
+					{
+						const auto index = indices[i * 3 + c];
+						if (timestamp - timestamps[index] > fifo_size)
+						{
+							timestamps[index] = timestamp++;
+							++misses;
+						}
+					}
+
+					const auto cluster_size = i + 1 - cluster_starts.back();
+					if (i + 1 < triangle_count && static_cast<double>(misses) <= base.acmr * threshold * static_cast<double>(cluster_size))
+					{
+						cluster_starts.push_back(i + 1);
+						misses = 0;
+
+						// Flushes the simulated cache
+						timestamp += fifo_size + 1;
+					}
+				}
+			}
+
+			cluster_starts.push_back(triangle_count);
+
+			const auto get_position = [&positions](size_t index)
+			{
+				return glm::vec3(positions[index * 3], positions[index * 3 + 1], positions[index * 3 + 2]);
+			};
+
+			glm::vec3 mesh_center(0.0f);
+			for (size_t i = 0; i < vertex_count; ++i) mesh_center += get_position(i);
+			mesh_center /= static_cast<float>(std::max<size_t>(vertex_count, 1));
+
+			struct cluster
+			{
+				size_t begin;
+				size_t end;
+				float sort_key;
+			};
+
+			std::vector<cluster> clusters;
+			clusters.reserve(cluster_starts.size());
+
+			for (size_t c = 0; c + 1 < cluster_starts.size(); ++c)
+			{
+				glm::vec3 center(0.0f), normal(0.0f);
+				auto area = 0.0f;
+
+				for (auto i = cluster_starts[c]; i < cluster_starts[c + 1]; ++i)
+				{
+					const auto a = get_position(indices[i * 3]);
+					const auto b = get_position(indices[i * 3 + 1]);
+					const auto d = get_position(indices[i * 3 + 2]);
+
+					const auto cross = glm::cross(b - a, d - a);
+					const auto triangle_area = glm::length(cross);
+
+					center += (a + b + d) * (triangle_area / 3.0f);
+					normal += cross;
+					area += triangle_area;
+				}
+
+				center = area > 0.0f ? center / area : get_position(indices[cluster_starts[c] * 3]);
+
+				const auto normal_length = glm::length(normal);
+				const auto direction = normal_length > 0.0f ? normal / normal_length : glm::vec3(0.0f);
+
+				// Clusters facing away from the center are drawn first, they tend to occlude the rest
+				clusters.push_back({ cluster_starts[c], cluster_starts[c + 1], glm::dot(center - mesh_center, direction) });
+			}
+
+			std::stable_sort(clusters.begin(), clusters.end(), [](const cluster& a, const cluster& b)
+			{
+				return a.sort_key > b.sort_key;
+			});
+
+			std::vector<T> result;
+			result.reserve(indices.size());
+
+			for (auto& cluster : clusters)
+			{
+				result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+			}
+
+			// Keep the cache order if sorting costs more cache reuse than allowed
+			if (analyze_vertex_cache(gsl::span<const T>(result), vertex_count, fifo_size).acmr <= base.acmr * threshold)
+			{
+				indices = std::move(result);
+			}
+		}
+
+		template <typename T>
+		void optimize_vertex_fetch(std::vector<T>& indices, std::vector<float>& positions)
+		{
+			const auto vertex_count = positions.size() / 3;
+			constexpr auto unused = std::numeric_limits<unsigned int>::max();
+
+			std::vector<unsigned int> remap(vertex_count, unused);
+			std::vector<float> result;
+			result.reserve(positions.size());
+
+			// Vertices are stored in the order the indices first reference them, unreferenced ones are dropped
+			for (auto& index : indices)
+			{
+				auto& target = remap[index];
+				if (target == unused)
+				{
+					target = static_cast<unsigned int>(result.size() / 3);
+					result.insert(result.end(), positions.begin() + index * 3ull, positions.begin() + index * 3ull + 3);
+				}
+
+				index = static_cast<T>(target);
+			}
+
+			positions = std::move(result);
+		}
+
+		template <typename T>
+		void generate_lods(std::vector<T>& indices, const std::vector<float>& positions, std::vector<mesh::lod>& lods, size_t min_triangles)
+		{
+			std::vector<unsigned int> level(indices.begin(), indices.end());
+			std::vector<mesh::lod> result{ { 0, static_cast<unsigned int>(indices.size()), 0.0f } };
+
+			auto error = 0.0f;
+
+			while (result.size() < max_lods)
+			{
+				const auto triangles = level.size() / 3;
+				if (triangles / 4 < min_triangles) break;
+
+				// Errors add up, every level is simplified from the previous one
+				error += mesh_simplifier::simplify(positions, level, triangles / 4);
+
+				// A level that barely shrinks isn't worth its memory, the mesh can't be simplified much further
+				if (level.size() / 3 > triangles / 2) break;
+
+				result.push_back({ static_cast<unsigned int>(indices.size()), static_cast<unsigned int>(level.size()), error });
+
+				std::transform(level.begin(), level.end(), std::back_inserter(indices), [](unsigned int index)
+				{
+					return static_cast<T>(index);
+				});
+			}
+
+			if (result.size() > 1) lods = std::move(result);
+		}
+
+		// Indices that don't reference a vertex would break every pass, such meshes are left alone
+		bool has_valid_indices(const mesh& mesh)
+		{
+			const auto vertex_count = mesh.get_vertex_count();
+
+			return std::visit([vertex_count](auto& indices)
+			{
+				return std::all_of(indices.begin(), indices.end(), [vertex_count](auto index)
+				{
+					return index < vertex_count;
+				});
+			}, mesh.indices);
+		}
+	}
+
+	statistics analyze_vertex_cache(const mesh& mesh, unsigned int cache_size)
+	{
+		return std::visit([&](auto& indices)
+		{
+			using index_type = typename std::decay_t<decltype(indices)>::value_type;
+
+			// Only the full mesh, detail levels are drawn instead of it and not after it
+			const auto count = mesh.lods.empty() ? indices.size() : mesh.lods.front().index_count;
+			return analyze_vertex_cache(gsl::span<const index_type>(indices.data(), count), mesh.get_vertex_count(), cache_size);
+		}, mesh.indices);
+	}
+
+	void optimize(mesh& mesh, unsigned int flags)
+	{
+		if (!has_valid_indices(mesh)) return;
+
+		// Overdraw sorting works on the clusters of the cache order and fetch order follows the final triangle order
+		if (flags & (vertex_cache | overdraw)) optimize_vertex_cache(mesh);
+		if (flags & overdraw) optimize_overdraw(mesh);
+		if (flags & vertex_fetch) optimize_vertex_fetch(mesh);
+		if (flags & lods) generate_lods(mesh);
+	}
+
+	void optimize_vertex_cache(mesh& mesh)
+	{
+		std::visit([&](auto& indices)
+		{
+			optimize_vertex_cache(indices, mesh.get_vertex_count());
+		}, mesh.indices);
+	}
+
+	void optimize_overdraw(mesh& mesh, double threshold)
+	{
+		std::visit([&](auto& indices)
+		{
+			optimize_overdraw(indices, mesh.positions, threshold);
+		}, mesh.indices);
+	}
+
+	void optimize_vertex_fetch(mesh& mesh)
+	{
+		std::visit([&](auto& indices)
+		{
+			optimize_vertex_fetch(indices, mesh.positions);
+		}, mesh.indices);
+	}
+
+	void generate_lods(mesh& mesh, size_t min_triangles)
+	{
+		if (!mesh.lods.empty()) return;
+
+		std::visit([&](auto& indices)
+		{
+			generate_lods(indices, mesh.positions, mesh.lods, min_triangles);
+		}, mesh.indices);
+	}
+}
\ No newline at end of file
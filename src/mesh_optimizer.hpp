@@ -0,0 +1,36 @@
+#pragma once
+
+#include "mesh.hpp"
+
+// Reorders triangles and vertices for the GPU, the rendered surface stays exactly the same
+namespace mesh_optimizer
+{
+	enum flags : unsigned int
+	{
+		none = 0,
+		vertex_cache = 1 << 0, // Triangle order with post-transform cache reuse (Forsyth)
+		overdraw = 1 << 1, // Outward facing clusters first, within a small loss of cache reuse
+		vertex_fetch = 1 << 2, // Vertices in the order they are first used
+		lods = 1 << 3, // Coarser detail levels appended after the full mesh
+	};
+
+	struct statistics
+	{
+		double acmr = 0.0; // Average cache miss ratio, transformed vertices per triangle
+		double atvr = 0.0; // Average transform to vertex ratio, 1.0 means every vertex is transformed once
+	};
+
+	// Simulates a FIFO post-transform cache like most GPUs implement it, on the full detail level
+	statistics analyze_vertex_cache(const mesh& mesh, unsigned int cache_size = 16);
+
+	// Runs the requested passes in the order they depend on each other
+	void optimize(mesh& mesh, unsigned int flags);
+
+	void optimize_vertex_cache(mesh& mesh);
+	void optimize_overdraw(mesh& mesh, double threshold = 1.05);
+	void optimize_vertex_fetch(mesh& mesh);
+
+	// Simplifies the mesh to a quarter of the triangles per level, as long as that takes at least min_triangles.
+	// The other passes expect a mesh without detail levels, optimize runs this one last.
+	void generate_lods(mesh& mesh, size_t min_triangles = 1024);
+}
\ No newline at end of file
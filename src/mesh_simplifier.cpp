@@ -0,0 +1,311 @@
+#include "std_include.hpp"
+
+#include "mesh_simplifier.hpp"
+
+namespace mesh_simplifier
+{
+	namespace
+	{
+		// Keeps open borders in place, collapsing along them is still cheap
+		constexpr double border_weight = 10.0;
+
+		// Sum of squared distances to a set of planes, as the upper half of a symmetric 4x4 matrix
+		struct quadric
+		{
+			double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+			double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+			double a22 = 0.0, a23 = 0.0;
+			double a33 = 0.0;
+
+			double weight = 0.0;
+
+			void add_plane(const glm::dvec3& normal, double distance, double plane_weight)
+			{
+				this->a00 += plane_weight * normal.x * normal.x;
+				this->a01 += plane_weight * normal.x * normal.y;
+				this->a02 += plane_weight * normal.x * normal.z;
+				this->a03 += plane_weight * normal.x * distance;
+				this->a11 += plane_weight * normal.y * normal.y;
+				this->a12 += plane_weight * normal.y * normal.z;
+				this->a13 += plane_weight * normal.y * distance;
+				this->a22 += plane_weight * normal.z * normal.z;
+				this->a23 += plane_weight * normal.z * distance;
+				this->a33 += plane_weight * distance * distance;
+
+				this->weight += plane_weight;
+			}
+
+			void add(const quadric& other)
+			{
+				this->a00 += other.a00;
+				this->a01 += other.a01;
+				this->a02 += other.a02;
+				this->a03 += other.a03;
+				this->a11 += other.a11;
+				this->a12 += other.a12;
+				this->a13 += other.a13;
+				this->a22 += other.a22;
+				this->a23 += other.a23;
+				this->a33 += other.a33;
+
+				this->weight += other.weight;
+			}
+
+			// Weighted mean of the squared plane distances, independent of the mesh's triangle sizes
+			static double evaluate(const quadric& a, const quadric& b, const glm::dvec3& p)
+			{
+				const auto value =
+					(a.a00 + b.a00) * p.x * p.x + 2.0 * (a.a01 + b.a01) * p.x * p.y + 2.0 * (a.a02 + b.a02) * p.x * p.z + 2.0 * (a.a03 + b.a03) * p.x +
+					(a.a11 + b.a11) * p.y * p.y + 2.0 * (a.a12 + b.a12) * p.y * p.z + 2.0 * (a.a13 + b.a13) * p.y +
+					(a.a22 + b.a22) * p.z * p.z + 2.0 * (a.a23 + b.a23) * p.z +
+					(a.a33 + b.a33);
+
+				const auto total_weight = a.weight + b.weight;
+				return total_weight > 0.0 ? std::max(value, 0.0) / total_weight : 0.0;
+			}
+		};
+
+		struct collapse
+		{
+			unsigned int source;
+			unsigned int target;
+			double error;
+		};
+
+		struct edge
+		{
+			unsigned int a;
+			unsigned int b;
+			unsigned int triangle;
+
+			bool operator<(const edge& other) const
+			{
+				return this->a != other.a ? this->a < other.a : this->b < other.b;
+			}
+		};
+
+		glm::dvec3 get_position(gsl::span<const float> positions, size_t index)
+		{
+			return glm::dvec3(positions[index * 3], positions[index * 3 + 1], positions[index * 3 + 2]);
+		}
+
+		std::vector<edge> collect_edges(const std::vector<unsigned int>& indices)
+		{
+			std::vector<edge> edges;
+			edges.reserve(indices.size());
+
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (size_t c = 0; c < 3; ++c)
+				{
+					const auto a = indices[i + c];
+					const auto b = indices[i + (c + 1) % 3];
+
+					edges.push_back({ std::min(a, b), std::max(a, b), static_cast<unsigned int>(i / 3) });
+				}
+			}
+
+			std::sort(edges.begin(), edges.end());
+			return edges;
+		}
+
+		std::vector<quadric> compute_quadrics(gsl::span<const float> positions, const std::vector<unsigned int>& indices, const std::vector<edge>& edges)
+		{
+			std::vector<quadric> quadrics(static_cast<size_t>(positions.size()) / 3);
+
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				const auto p0 = get_position(positions, indices[i]);
+				const auto p1 = get_position(positions, indices[i + 1]);
+				const auto p2 = get_position(positions, indices[i + 2]);
+
+				auto normal = glm::cross(p1 - p0, p2 - p0);
+				const auto length = glm::length(normal);
+				if (length <= 0.0) continue;
+
+				normal /= length;
+
+				// Weighted by area, large triangles define the surface more than slivers
+				for (size_t c = 0; c < 3; ++c)
+				{
+					quadrics[indices[i + c]].add_plane(normal, -glm::dot(normal, p0), length * 0.5);
+				}
+			}
+
+			// Edges used by a single triangle are borders, a plane perpendicular to the triangle keeps them from moving inwards
+			for (size_t i = 0; i < edges.size(); ++i)
+			{
+				const auto shared = (i > 0 && edges[i - 1].a == edges[i].a && edges[i - 1].b == edges[i].b) ||
+					(i + 1 < edges.size() && edges[i + 1].a == edges[i].a && edges[i + 1].b == edges[i].b);
+				if (shared) continue;
+
+				const auto triangle = edges[i].triangle * 3ull;
+				const auto p0 = get_position(positions, indices[triangle]);
+				const auto p1 = get_position(positions, indices[triangle + 1]);
+				const auto p2 = get_position(positions, indices[triangle + 2]);
+
+				const auto a = get_position(positions, edges[i].a);
+				const auto b = get_position(positions, edges[i].b);
+
+				const auto direction = b - a;
+				auto normal = glm::cross(direction, glm::cross(p1 - p0, p2 - p0));
+				const auto length = glm::length(normal);
+				if (length <= 0.0) continue;
+
+				normal /= length;
+
+				const auto plane_weight = glm::dot(direction, direction) * border_weight;
+				quadrics[edges[i].a].add_plane(normal, -glm::dot(normal, a), plane_weight);
+				quadrics[edges[i].b].add_plane(normal, -glm::dot(normal, a), plane_weight);
+			}
+
+			return quadrics;
+		}
+
+		// A collapse must not turn any of the remaining triangles around the source vertex upside down
+		bool flips_triangles(gsl::span<const float> positions, const std::vector<unsigned int>& indices, gsl::span<const unsigned int> triangles,
+			unsigned int source, unsigned int target)
+		{
+			const auto target_position = get_position(positions, target);
+
+			for (auto triangle : triangles)
+			{
+				const auto base = triangle * 3ull;
+				const unsigned int corners[3] = { indices[base], indices[base + 1], indices[base + 2] };
+
+				if (corners[0] == target || corners[1] == target || corners[2] == target) continue;
+
+				glm::dvec3 before[3], after[3];
+				for (size_t c = 0; c < 3; ++c)
+				{
+					before[c] = get_position(positions, corners[c]);
+					after[c] = corners[c] == source ? target_position : before[c];
+				}
+
+				const auto normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+				const auto normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+				// Besides real flips, this rejects triangles that rotate by more than about 75 degrees
+				if (glm::dot(normal_before, normal_after) < 0.25 * glm::length(normal_before) * glm::length(normal_after)) return true;
+			}
+
+			return false;
+		}
+	}
+
+	float simplify(gsl::span<const float> positions, std::vector<unsigned int>& indices, size_t target_triangles)
+	{
+		const auto vertex_count = static_cast<size_t>(positions.size()) / 3;
+		if (indices.size() / 3 <= target_triangles || !vertex_count) return 0.0f;
+
+		const auto valid = std::all_of(indices.begin(), indices.end(), [vertex_count](unsigned int index)
+		{
+			return index < vertex_count;
+		});
+
+		if (!valid) return 0.0f;
+
+		auto edges = collect_edges(indices);
+		auto quadrics = compute_quadrics(positions, indices, edges);
+
+		std::vector<unsigned int> remap(vertex_count);
+		for (size_t i = 0; i < vertex_count; ++i) remap[i] = static_cast<unsigned int>(i);
+
+		std::vector<unsigned int> offsets, adjacency;
+		std::vector<collapse> collapses;
+		std::vector<unsigned char> locked;
+
+		auto max_error = 0.0;
+
+		// Every pass collapses the cheapest edges whose surroundings are still untouched, until the target is reached
+		while (indices.size() / 3 > target_triangles)
+		{
+			const auto triangle_count = indices.size() / 3;
+
+			if (edges.empty()) edges = collect_edges(indices);
+
+			// Triangles of every vertex, packed into one array
+			offsets.assign(vertex_count + 1, 0);
+			for (auto index : indices) ++offsets[index + 1];
+			for (size_t i = 0; i < vertex_count; ++i) offsets[i + 1] += offsets[i];
+
+			adjacency.resize(indices.size());
+			{
+				auto fill = offsets;
+				for (size_t i = 0; i < indices.size(); ++i) adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+			}
+
+			collapses.clear();
+
+			for (size_t i = 0; i < edges.size(); ++i)
+			{
+				if (i > 0 && edges[i - 1].a == edges[i].a && edges[i - 1].b == edges[i].b) continue;
+
+				const auto a = edges[i].a;
+				const auto b = edges[i].b;
+
+				// Either end can be kept, the one that deviates less from both vertices' planes is
+				const auto error_ab = quadric::evaluate(quadrics[a], quadrics[b], get_position(positions, b));
+				const auto error_ba = quadric::evaluate(quadrics[a], quadrics[b], get_position(positions, a));
+
+				collapses.push_back(error_ab <= error_ba ? collapse{ a, b, error_ab } : collapse{ b, a, error_ba });
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const collapse& x, const collapse& y)
+			{
+				return x.error < y.error;
+			});
+
+			locked.assign(vertex_count, 0);
+
+			const auto excess = triangle_count - target_triangles;
+			size_t removed = 0, performed = 0;
+
+			for (auto& candidate : collapses)
+			{
+				if (removed >= excess) break;
+				if (locked[candidate.source] || locked[candidate.target]) continue;
+
+				const gsl::span<const unsigned int> triangles(adjacency.data() + offsets[candidate.source], offsets[candidate.source + 1] - offsets[candidate.source]);
+				if (flips_triangles(positions, indices, triangles, candidate.source, candidate.target)) continue;
+
+				remap[candidate.source] = candidate.target;
+				quadrics[candidate.target].add(quadrics[candidate.source]);
+
+				// Both ends are final for this pass, neighbours may still collapse after their own flip check
+				locked[candidate.source] = locked[candidate.target] = 1;
+
+				for (auto triangle : triangles)
+				{
+					const auto base = triangle * 3ull;
+					if (indices[base] == candidate.target || indices[base + 1] == candidate.target || indices[base + 2] == candidate.target) ++removed;
+				}
+
+				max_error = std::max(max_error, candidate.error);
+				++performed;
+			}
+
+			if (!performed) break;
+
+			// Collapsed triangles become degenerate and are dropped, the order of the others is kept
+			size_t output = 0;
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				const auto a = remap[indices[i]];
+				const auto b = remap[indices[i + 1]];
+				const auto c = remap[indices[i + 2]];
+
+				if (a == b || b == c || a == c) continue;
+
+				indices[output++] = a;
+				indices[output++] = b;
+				indices[output++] = c;
+			}
+
+			indices.resize(output);
+			edges.clear();
+		}
+
+		return static_cast<float>(sqrt(max_error));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+// Quadric error mesh simplification (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics")
+namespace mesh_simplifier
+{
+	// Collapses edges in order of their error until at most target_triangles are left, or no edge can be collapsed
+	// without flipping a triangle. Vertices are collapsed onto existing ones, so the result still indexes the same
+	// positions. Returns the largest collapse error as a distance in model units.
+	float simplify(gsl::span<const float> positions, std::vector<unsigned int>& indices, size_t target_triangles);
+}
\ No newline at end of file
@@ -1,60 +1,298 @@
 #include "std_include.hpp"
 
 #include "model.hpp"
+#include "gl_state.hpp"
 
-model::model(const std::vector<glm::dvec4>& vertices, const std::vector<std::array<int, 3>>& faces) :
-	num_faces(static_cast<int>(faces.size()))
+namespace
+{
+	template <typename T>
+	GLenum get_index_type();
+
+	template <>
+	GLenum get_index_type<unsigned int>()
+	{
+		return GL_UNSIGNED_INT;
+	}
+
+	template <>
+	GLenum get_index_type<unsigned short>()
+	{
+		return GL_UNSIGNED_SHORT;
+	}
+
+	template <typename T>
+	model::clusters build_ordered_clusters(gsl::span<const float> positions, gsl::span<const T> indices, gsl::span<const mesh::lod> lods)
+	{
+		model::clusters result;
+
+		std::vector<T> ordered;
+		result.levels = mesh_clusters::build(positions, indices, lods, ordered);
+		result.indices = std::move(ordered);
+
+		return result;
+	}
+}
+
+model::clusters model::build_clusters(const mesh& mesh)
+{
+	return std::visit([&mesh](auto& indices)
+	{
+		using index_type = typename std::decay_t<decltype(indices)>::value_type;
+		return build_ordered_clusters(gsl::span<const float>(mesh.positions), gsl::span<const index_type>(indices), gsl::span<const mesh::lod>(mesh.lods));
+	}, mesh.indices);
+}
+
+model::clusters model::build_clusters(gsl::span<const float> positions, gsl::span<const unsigned int> indices, gsl::span<const mesh::lod> lods)
+{
+	return build_ordered_clusters(positions, indices, lods);
+}
+
+model::clusters model::build_clusters(gsl::span<const float> positions, gsl::span<const unsigned short> indices, gsl::span<const mesh::lod> lods)
+{
+	return build_ordered_clusters(positions, indices, lods);
+}
+
+model::model(bool _keep_geometry) : keep_geometry(_keep_geometry)
 {
-	this->create_vertex_buffer(vertices);
-	this->create_index_buffer(faces);
 }
 
-void model::create_vertex_buffer(const std::vector<glm::dvec4>& vertices)
+model::model(const mesh& mesh, bool _keep_geometry) : keep_geometry(_keep_geometry)
 {
-	float* vertex_array = reinterpret_cast<float*>(malloc(sizeof(float) * 3 * vertices.size()));
+	this->set_geometry(mesh.positions, build_clusters(mesh));
+}
+
+model::model(gsl::span<const float> positions, gsl::span<const unsigned int> indices, gsl::span<const mesh::lod> lods, bool _keep_geometry)
+	: keep_geometry(_keep_geometry)
+{
+	this->set_geometry(positions, build_clusters(positions, indices, lods));
+}
+
+model::model(gsl::span<const float> positions, gsl::span<const unsigned short> indices, gsl::span<const mesh::lod> lods, bool _keep_geometry)
+	: keep_geometry(_keep_geometry)
+{
+	this->set_geometry(positions, build_clusters(positions, indices, lods));
+}
+
+model::~model()
+{
+	this->destroy_buffers();
+}
+
+void model::stream(const mesh& mesh, size_t vertex_count, size_t index_count)
+{
+	if (!this->levels.empty())
+	{
+		throw std::runtime_error("Model geometry is already complete");
+	}
 
-	for (size_t i = 0; i < vertices.size(); ++i)
+	if (!this->vertex_buffer)
 	{
-		auto& vertex = vertices[i];
+		this->create_vertex_buffer(nullptr, mesh.positions.size() * sizeof(float));
 
-		for (int v = 0; v < 3; ++v)
+		std::visit([this](auto& indices)
 		{
-			vertex_array[i * 3 + v] = static_cast<float>(vertex[v]);
-		}
+			using index_type = typename std::decay_t<decltype(indices)>::value_type;
+
+			this->index_size = sizeof(index_type);
+			this->create_index_buffer(nullptr, indices.size() * sizeof(index_type), get_index_type<index_type>());
+		}, mesh.indices);
+	}
+
+	if (vertex_count > this->streamed_vertices)
+	{
+		this->get_staging().upload(this->vertex_buffer, this->streamed_vertices * 3 * sizeof(float),
+			mesh.positions.data() + this->streamed_vertices * 3, (vertex_count - this->streamed_vertices) * 3 * sizeof(float));
+
+		this->streamed_vertices = vertex_count;
 	}
 
-	glGenBuffers(1, &this->vertex_buffer);
-	glBindBuffer(GL_ARRAY_BUFFER, this->vertex_buffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * vertices.size(), vertex_array, GL_STATIC_DRAW);
+	if (index_count > this->streamed_indices)
+	{
+		std::visit([this, index_count](auto& indices)
+		{
+			this->get_staging().upload(this->index_buffer, this->streamed_indices * this->index_size,
+				indices.data() + this->streamed_indices, (index_count - this->streamed_indices) * this->index_size);
+		}, mesh.indices);
 
-	free(vertex_array);
+		this->streamed_indices = index_count;
+	}
+
+	this->stats.triangles = this->streamed_indices / 3;
+	this->stats.visible_triangles = this->stats.triangles;
 }
 
-void model::create_index_buffer(const std::vector<std::array<int, 3>>& faces)
+void model::set_geometry(gsl::span<const float> positions, clusters&& clusters)
 {
-	unsigned int* index_array = reinterpret_cast<unsigned int*>(malloc(sizeof(unsigned int) * 3 * faces.size()));
+	this->destroy_buffers();
+
+	this->streamed_vertices = 0;
+	this->streamed_indices = 0;
+
+	this->levels = std::move(clusters.levels);
 
-	for (size_t i = 0; i < faces.size(); ++i)
+	this->bounds_min = glm::vec3(std::numeric_limits<float>::max());
+	this->bounds_max = glm::vec3(std::numeric_limits<float>::lowest());
+
+	for (auto& cluster : this->levels.front().clusters)
 	{
-		auto& face = faces[i];
+		this->bounds_min = glm::min(this->bounds_min, cluster.bounds_min);
+		this->bounds_max = glm::max(this->bounds_max, cluster.bounds_max);
+	}
 
-		for (int v = 0; v < 3; ++v)
-		{
-			index_array[i * 3 + v] = static_cast<unsigned int>(face[v]);
-		}
+	this->stats = {};
+	this->stats.levels = this->levels.size();
+
+	this->create_vertex_buffer(positions.data(), static_cast<size_t>(positions.size_bytes()));
+
+	std::visit([this](auto& ordered)
+	{
+		using index_type = typename std::decay_t<decltype(ordered)>::value_type;
+
+		this->index_size = sizeof(index_type);
+		this->create_index_buffer(ordered.data(), ordered.size() * sizeof(index_type), get_index_type<index_type>());
+	}, clusters.indices);
+
+	if (this->keep_geometry)
+	{
+		this->positions.assign(positions.begin(), positions.end());
+		this->indices = std::move(clusters.indices);
 	}
 
-	glGenBuffers(1, &this->index_buffer);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->index_buffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * 3 * faces.size(), index_array, GL_STATIC_DRAW);
+	// The geometry doesn't change anymore
+	this->staging.reset();
+}
 
-	free(index_array);
+void model::create_vertex_buffer(const void* data, size_t size)
+{
+	this->vertex_buffer = this->get_staging().create_buffer(GL_ARRAY_BUFFER, size);
+	if (data) this->get_staging().upload(this->vertex_buffer, 0, data, size);
 }
 
-model::~model()
+void model::create_index_buffer(const void* data, size_t size, GLenum type)
 {
-	glDeleteBuffers(1, &this->vertex_buffer);
-	glDeleteBuffers(1, &this->index_buffer);
+	this->index_type = type;
+
+	this->index_buffer = this->get_staging().create_buffer(GL_ELEMENT_ARRAY_BUFFER, size);
+	if (data) this->get_staging().upload(this->index_buffer, 0, data, size);
+}
+
+void model::destroy_buffers()
+{
+	gl_state::delete_buffer(this->vertex_buffer);
+	gl_state::delete_buffer(this->index_buffer);
+
+	this->vertex_buffer = 0;
+	this->index_buffer = 0;
+}
+
+staging_ring& model::get_staging()
+{
+	if (!this->staging)
+	{
+		this->staging = std::make_unique<staging_ring>();
+	}
+
+	return *this->staging;
+}
+
+void model::set_culling(bool enabled)
+{
+	this->culling = enabled;
+}
+
+const model::statistics& model::get_statistics() const
+{
+	return this->stats;
+}
+
+void model::set_lod_threshold(double pixels)
+{
+	this->lod_threshold = pixels;
+}
+
+size_t model::select_level(const glm::dmat4& projection, const glm::dmat4& modelview, int viewport_height) const
+{
+	if (this->levels.size() < 2 || this->lod_threshold <= 0.0) return 0;
+
+	// Pixels per model unit at the nearest point of the bounds, a perspective projection scales with the distance
+	auto pixels_per_unit = projection[1][1] * viewport_height * 0.5;
+
+	if (projection[2][3] != 0.0)
+	{
+		const auto eye = glm::dvec3(glm::inverse(modelview)[3]);
+		const auto nearest = glm::clamp(eye, glm::dvec3(this->bounds_min), glm::dvec3(this->bounds_max));
+
+		const auto distance = glm::length(eye - nearest);
+		if (distance <= 0.0) return 0;
+
+		pixels_per_unit /= distance;
+	}
+
+	size_t result = 0;
+	while (result + 1 < this->levels.size() && this->levels[result + 1].error * pixels_per_unit <= this->lod_threshold)
+	{
+		++result;
+	}
+
+	return result;
+}
+
+const std::vector<depth_rasterizer::range>& model::select_ranges(const glm::dmat4& projection, const glm::dmat4& modelview, int viewport_height)
+{
+	this->stats.level = this->select_level(projection, modelview, viewport_height);
+	const auto& level = this->levels[this->stats.level];
+
+	this->stats.clusters = level.clusters.size();
+	this->stats.triangles = static_cast<size_t>(level.index_count) / 3;
+
+	if (this->culling && level.clusters.size() > 1)
+	{
+		this->select_clusters(level, frustum(projection * modelview));
+	}
+	else
+	{
+		this->draw_ranges.assign(1, { static_cast<size_t>(level.first_index), static_cast<size_t>(level.index_count) });
+
+		this->stats.visible_clusters = this->stats.clusters;
+		this->stats.visible_triangles = this->stats.triangles;
+	}
+
+	return this->draw_ranges;
+}
+
+void model::select_clusters(const mesh_clusters::level& level, const frustum& view)
+{
+	this->draw_ranges.clear();
+
+	this->stats.visible_clusters = 0;
+	this->stats.visible_triangles = 0;
+
+	int previous_end = -1;
+
+	for (auto& cluster : level.clusters)
+	{
+		if (!view.intersects(cluster.bounds_min, cluster.bounds_max)) continue;
+
+		++this->stats.visible_clusters;
+		this->stats.visible_triangles += static_cast<size_t>(cluster.index_count) / 3;
+
+		// Visible neighbours are contiguous in the index buffer, they are submitted as one range
+		if (cluster.first_index == previous_end)
+		{
+			this->draw_ranges.back().index_count += static_cast<size_t>(cluster.index_count);
+		}
+		else
+		{
+			this->draw_ranges.push_back({ static_cast<size_t>(cluster.first_index), static_cast<size_t>(cluster.index_count) });
+		}
+
+		previous_end = cluster.first_index + cluster.index_count;
+	}
+}
+
+const char* model::get_name() const
+{
+	return "model";
 }
 
 void model::paint()
@@ -63,12 +301,66 @@ void model::paint()
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 	glCullFace(GL_FRONT_AND_BACK);
 
-	glBindBuffer(GL_ARRAY_BUFFER, this->vertex_buffer);
+	if (this->levels.empty())
+	{
+		// Still streaming, everything uploaded so far is drawn
+		if (!this->streamed_indices) return;
+
+		this->draw_ranges.assign(1, { size_t(0), this->streamed_indices });
+	}
+	else
+	{
+		this->select_ranges(gl_state::get_projection(), gl_state::get_modelview(), gl_state::get_viewport()[3]);
+	}
+
+	const auto& ranges = this->draw_ranges;
+	if (ranges.empty()) return;
+
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, this->vertex_buffer);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, 0);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->index_buffer);
-	glDrawElements(GL_TRIANGLES, this->num_faces * 3, GL_UNSIGNED_INT, 0);
+	gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, this->index_buffer);
+
+	if (ranges.size() == 1)
+	{
+		glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(ranges.front().index_count), this->index_type,
+			reinterpret_cast<const void*>(ranges.front().first_index * this->index_size));
+	}
+	else
+	{
+		this->draw_counts.clear();
+		this->draw_offsets.clear();
+
+		for (auto& range : ranges)
+		{
+			this->draw_counts.push_back(static_cast<GLsizei>(range.index_count));
+			this->draw_offsets.push_back(reinterpret_cast<const void*>(range.first_index * this->index_size));
+		}
+
+		glMultiDrawElements(GL_TRIANGLES, this->draw_counts.data(), this->index_type, this->draw_offsets.data(), static_cast<GLsizei>(this->draw_counts.size()));
+	}
 
 	glDisableVertexAttribArray(0);
 }
+
+void model::rasterize(depth_rasterizer& target, const glm::dmat4& projection, const glm::dmat4& modelview)
+{
+	if (!this->keep_geometry)
+	{
+		throw std::runtime_error("Model was created without keeping its geometry");
+	}
+
+	if (this->levels.empty()) return;
+
+	const auto& ranges = this->select_ranges(projection, modelview, target.get_height());
+	if (ranges.empty()) return;
+
+	const glm::mat4 view_projection(projection * modelview);
+
+	std::visit([&](auto& indices)
+	{
+		using index_type = typename std::decay_t<decltype(indices)>::value_type;
+		target.draw(this->positions, gsl::span<const index_type>(indices), view_projection, ranges);
+	}, this->indices);
+}
\ No newline at end of file
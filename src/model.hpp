@@ -1,21 +1,119 @@
 #pragma once
 
+#include <mesh.hpp>
+#include <mesh_clusters.hpp>
+#include <frustum.hpp>
 #include <paintable.hpp>
+#include <staging_ring.hpp>
+#include <depth_rasterizer.hpp>
 
 class model : public paintable
 {
 public:
-	model(const std::vector<glm::dvec4>& vertices, const std::vector<std::array<int, 3>>& faces);
+	struct statistics
+	{
+		// Detail level drawn by the last paint, 0 is the full mesh
+		size_t level = 0;
+		size_t levels = 1;
+
+		// Of the drawn level
+		size_t clusters = 0;
+		size_t triangles = 0;
+
+		// Submitted by the last paint
+		size_t visible_clusters = 0;
+		size_t visible_triangles = 0;
+	};
+
+	// Cluster order and detail levels of a mesh, building them doesn't need the GL context
+	struct clusters
+	{
+		std::vector<mesh_clusters::level> levels;
+
+		// Indices in cluster order
+		std::variant<std::vector<unsigned short>, std::vector<unsigned int>> indices;
+	};
+
+	static clusters build_clusters(const mesh& mesh);
+	static clusters build_clusters(gsl::span<const float> positions, gsl::span<const unsigned int> indices, gsl::span<const mesh::lod> lods = {});
+	static clusters build_clusters(gsl::span<const float> positions, gsl::span<const unsigned short> indices, gsl::span<const mesh::lod> lods = {});
+
+	// Draws nothing until it is streamed or given its geometry.
+	// keep_geometry holds a copy of the final geometry in memory for rasterize.
+	explicit model(bool keep_geometry = false);
+
+	// Uploads straight from the mesh's buffers, without converting or copying them first
+	model(const mesh& mesh, bool keep_geometry = false);
+
+	// Packed xyz positions and triangle indices, uploaded as they are. Without lods all indices form one level.
+	model(gsl::span<const float> positions, gsl::span<const unsigned int> indices, gsl::span<const mesh::lod> lods = {}, bool keep_geometry = false);
+	model(gsl::span<const float> positions, gsl::span<const unsigned short> indices, gsl::span<const mesh::lod> lods = {}, bool keep_geometry = false);
+
 	~model() override;
 
+	// Uploads more of a mesh that is still being loaded, its first vertex_count positions and index_count indices are final.
+	// The buffers are sized for the whole mesh on the first call. Drawn as it is, without culling or levels.
+	// Everything is uploaded through a bounded staging ring, which is released with the final geometry.
+	void stream(const mesh& mesh, size_t vertex_count, size_t index_count);
+
+	// Replaces the streamed or previous geometry
+	void set_geometry(gsl::span<const float> positions, clusters&& clusters);
+
 	void paint() override;
+	const char* get_name() const override;
+
+	// Draws the level and clusters paint would draw with these matrices into a CPU depth buffer.
+	// Requires a model created with keep_geometry.
+	void rasterize(depth_rasterizer& target, const glm::dmat4& projection, const glm::dmat4& modelview);
+
+	// Skips clusters outside the view frustum, enabled by default
+	void set_culling(bool enabled);
+
+	// Draws the coarsest level whose error projects to at most this many pixels at the model's nearest point.
+	// 0 always draws the full mesh.
+	void set_lod_threshold(double pixels);
+	const statistics& get_statistics() const;
 
 private:
 	GLuint index_buffer = 0;
 	GLuint vertex_buffer = 0;
 
-	int num_faces;
+	GLenum index_type = GL_UNSIGNED_INT;
+	size_t index_size = sizeof(unsigned int);
+
+	std::vector<mesh_clusters::level> levels;
+
+	glm::vec3 bounds_min{};
+	glm::vec3 bounds_max{};
+
+	bool culling = true;
+	double lod_threshold = 1.0;
+
+	// Cluster ordered copy of the uploaded buffers, only with keep_geometry
+	bool keep_geometry = false;
+	std::vector<float> positions;
+	std::variant<std::vector<unsigned short>, std::vector<unsigned int>> indices;
+
+	statistics stats;
+
+	size_t streamed_vertices = 0;
+	size_t streamed_indices = 0;
+
+	std::unique_ptr<staging_ring> staging;
+
+	std::vector<depth_rasterizer::range> draw_ranges;
+	std::vector<GLsizei> draw_counts;
+	std::vector<const void*> draw_offsets;
+
+	void create_vertex_buffer(const void* data, size_t size);
+	void create_index_buffer(const void* data, size_t size, GLenum type);
+	void destroy_buffers();
+
+	staging_ring& get_staging();
+
+	size_t select_level(const glm::dmat4& projection, const glm::dmat4& modelview, int viewport_height) const;
 
-	void create_vertex_buffer(const std::vector<glm::dvec4>& vertices);
-	void create_index_buffer(const std::vector<std::array<int, 3>>& faces);
-};
+	// Index ranges to draw, visible neighbouring clusters are merged into one range
+	const std::vector<depth_rasterizer::range>& select_ranges(const glm::dmat4& projection, const glm::dmat4& modelview, int viewport_height);
+	void select_clusters(const mesh_clusters::level& level, const frustum& view);
+};
\ No newline at end of file
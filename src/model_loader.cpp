@@ -0,0 +1,254 @@
+#include "std_include.hpp"
+
+#include "model_loader.hpp"
+#include "mesh_optimizer.hpp"
+#include "thread_pool.hpp"
+
+namespace
+{
+	// Streamed per frame at most, half of the model's staging ring so a frame never wraps around onto copies
+	// the GPU hasn't finished yet and waits for them
+	constexpr size_t max_upload_bytes_per_frame = staging_ring::default_size / 2;
+}
+
+model_loader::model_loader(model* _target, settings settings) : target(_target), options(std::move(settings))
+{
+	this->thread = std::thread([this]()
+	{
+		this->load();
+	});
+}
+
+model_loader::~model_loader()
+{
+	{
+		std::lock_guard<std::mutex> _(this->mutex);
+		this->cancelled = true;
+	}
+
+	this->uploaded.notify_all();
+
+	if (this->thread.joinable())
+	{
+		this->thread.join();
+	}
+}
+
+const char* model_loader::get_name() const
+{
+	return "model_loader";
+}
+
+void model_loader::paint()
+{
+	if (this->complete) return;
+
+	if (this->stats.first_frame_ms < 0.0)
+	{
+		this->stats.first_frame_ms = this->get_elapsed_ms();
+	}
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	if (this->error)
+	{
+		std::rethrow_exception(this->error);
+	}
+
+	if (this->finished)
+	{
+		auto positions = this->final_positions;
+		auto clusters = std::move(this->final_clusters);
+
+		if (this->vertex_cache)
+		{
+			this->stats.optimized = true;
+			this->stats.vertex_cache_before = this->vertex_cache->first;
+			this->stats.vertex_cache_after = this->vertex_cache->second;
+		}
+
+		lock.unlock();
+
+		this->stats.total_indices = std::visit([](auto& indices) { return indices.size(); }, clusters.indices);
+		this->target->set_geometry(positions, std::move(clusters));
+
+		// The model holds everything it needs now, the loading thread is done with the sources
+		this->thread.join();
+		this->obj_loader.reset();
+		this->cache_entry.reset();
+
+		this->complete = true;
+		this->stats.complete_ms = this->get_elapsed_ms();
+		this->stats.loaded_indices = this->stats.total_indices;
+		if (this->stats.first_triangles_ms < 0.0) this->stats.first_triangles_ms = this->stats.complete_ms;
+
+		fprintf(this->options.log, "Model loaded in %.1f ms, first frame after %.1f ms, first triangles after %.1f ms\n",
+			this->stats.complete_ms, this->stats.first_frame_ms, this->stats.first_triangles_ms);
+		return;
+	}
+
+	if (!this->parsed_mesh || (this->parsed_vertices == this->uploaded_vertices && this->parsed_indices == this->uploaded_indices))
+	{
+		return;
+	}
+
+	const auto& data = *this->parsed_mesh;
+
+	// Vertices first, indices only once every vertex they may refer to is uploaded
+	const auto vertex_size = 3 * sizeof(float);
+	const auto vertex_count = std::min(this->parsed_vertices, this->uploaded_vertices + max_upload_bytes_per_frame / vertex_size);
+	auto index_count = this->uploaded_indices;
+
+	if (vertex_count == this->parsed_vertices)
+	{
+		const auto index_size = std::visit([](auto& indices) { return sizeof(indices[0]); }, data.indices);
+		const auto budget = max_upload_bytes_per_frame - (vertex_count - this->uploaded_vertices) * vertex_size;
+
+		index_count = std::min(this->parsed_indices, this->uploaded_indices + budget / index_size);
+	}
+
+	lock.unlock();
+
+	// Uploads without the lock, the loading thread waits for it before it changes the mesh again
+	this->target->stream(data, vertex_count, index_count);
+
+	this->stats.loaded_indices = index_count;
+	this->stats.total_indices = data.get_index_count();
+	if (index_count && this->stats.first_triangles_ms < 0.0) this->stats.first_triangles_ms = this->get_elapsed_ms();
+
+	lock.lock();
+	this->uploaded_vertices = vertex_count;
+	this->uploaded_indices = index_count;
+	lock.unlock();
+
+	this->uploaded.notify_all();
+}
+
+bool model_loader::is_complete() const
+{
+	return this->complete;
+}
+
+const model_loader::statistics& model_loader::get_statistics() const
+{
+	return this->stats;
+}
+
+void model_loader::load()
+{
+	try
+	{
+		mesh_cache cache(this->options.cache_directory);
+
+		if (!this->options.use_cache || !this->load_cached(cache))
+		{
+			this->load_obj(cache);
+		}
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> _(this->mutex);
+		if (!this->cancelled) this->error = std::current_exception();
+	}
+}
+
+bool model_loader::load_cached(const mesh_cache& cache)
+{
+	this->cache_entry = cache.find(this->options.path, this->options.optimizations);
+	if (!this->cache_entry) return false;
+
+	const auto positions = this->cache_entry->get_positions();
+	const auto lods = this->cache_entry->get_lods();
+
+	auto clusters = std::visit([&](auto indices)
+	{
+		return model::build_clusters(positions, indices, lods);
+	}, this->cache_entry->get_indices());
+
+	this->finish(positions, std::move(clusters));
+	return true;
+}
+
+void model_loader::load_obj(const mesh_cache& cache)
+{
+	{
+		thread_pool pool(this->options.threads);
+		this->obj_loader = std::make_unique<mapped_obj_loader>(this->options.path, &pool, [this](const mesh& data, size_t vertex_count, size_t index_count)
+		{
+			this->report_progress(data, vertex_count, index_count);
+		});
+	}
+
+	auto& data = this->obj_loader->get_mesh();
+
+	if (this->options.optimizations)
+	{
+		// The render thread may still be reading the parsed mesh
+		this->wait_for_upload();
+
+		const auto before = mesh_optimizer::analyze_vertex_cache(data);
+		mesh_optimizer::optimize(data, this->options.optimizations);
+		const auto after = mesh_optimizer::analyze_vertex_cache(data);
+
+		fprintf(this->options.log, "Vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", before.acmr, after.acmr, before.atvr, after.atvr);
+
+		// stdout isn't visible in the windowed viewer, it shows them in the title bar
+		std::lock_guard<std::mutex> _(this->mutex);
+		this->vertex_cache.emplace(before, after);
+	}
+
+	if (this->options.use_cache)
+	{
+		try
+		{
+			cache.store(this->options.path, data, this->options.optimizations);
+		}
+		catch (std::exception&)
+		{
+			// The cache only speeds up the next start, a read-only model folder is no reason to fail
+		}
+	}
+
+	this->finish(data.positions, model::build_clusters(data));
+}
+
+void model_loader::report_progress(const mesh& data, size_t vertex_count, size_t index_count)
+{
+	std::lock_guard<std::mutex> _(this->mutex);
+
+	// Thrown on a pool thread, parsing stops and the exception ends up in load
+	if (this->cancelled) throw std::runtime_error("Loading cancelled");
+
+	this->parsed_mesh = &data;
+	this->parsed_vertices = vertex_count;
+	this->parsed_indices = index_count;
+}
+
+void model_loader::wait_for_upload()
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->uploaded.wait(lock, [this]()
+	{
+		return this->cancelled || (this->uploaded_vertices == this->parsed_vertices && this->uploaded_indices == this->parsed_indices);
+	});
+
+	if (this->cancelled) throw std::runtime_error("Loading cancelled");
+
+	// Nothing is streamed from here on, the mesh is only read again for the final geometry
+	this->parsed_mesh = nullptr;
+}
+
+void model_loader::finish(gsl::span<const float> positions, model::clusters&& clusters)
+{
+	std::lock_guard<std::mutex> _(this->mutex);
+
+	this->parsed_mesh = nullptr;
+	this->final_positions = positions;
+	this->final_clusters = std::move(clusters);
+	this->finished = true;
+}
+
+double model_loader::get_elapsed_ms() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - this->start).count();
+}
\ No newline at end of file
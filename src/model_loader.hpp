@@ -0,0 +1,102 @@
+#pragma once
+
+#include "model.hpp"
+#include "mesh_cache.hpp"
+#include "mapped_obj_loader.hpp"
+#include "mesh_optimizer.hpp"
+
+// Loads a model on a background thread while the window already paints. Parsed parts of an obj file are uploaded
+// every frame as they become available, the optimized and clustered mesh replaces them once it is done.
+// Paint it before the model it fills.
+class model_loader : public paintable
+{
+public:
+	struct settings
+	{
+		std::string path;
+
+		bool use_cache = true;
+		std::string cache_directory;
+
+		// mesh_optimizer flags
+		unsigned int optimizations = 0;
+
+		// Parsing threads, separate from the render thread's pool so synthesis never waits for them. 0 uses all.
+		unsigned int threads = 0;
+
+		// Load times and optimization results are printed here, stderr keeps stdout free for other output
+		FILE* log = stdout;
+	};
+
+	// In milliseconds since the loader was created, negative until reached
+	struct statistics
+	{
+		double first_frame_ms = -1.0;
+		double first_triangles_ms = -1.0;
+		double complete_ms = -1.0;
+
+		size_t loaded_indices = 0;
+		size_t total_indices = 0;
+
+		// Set once an optimized model is complete, cached models were optimized before
+		bool optimized = false;
+		mesh_optimizer::statistics vertex_cache_before;
+		mesh_optimizer::statistics vertex_cache_after;
+	};
+
+	// Starts loading right away, the model has to outlive the loader
+	model_loader(model* target, settings settings);
+	~model_loader() override;
+
+	model_loader(const model_loader&) = delete;
+	model_loader& operator=(const model_loader&) = delete;
+
+	// Uploads what was loaded since the last frame, loading errors are rethrown here
+	void paint() override;
+	const char* get_name() const override;
+
+	bool is_complete() const;
+	const statistics& get_statistics() const;
+
+private:
+	model* target;
+	settings options;
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	// Shared with the loading thread
+	std::mutex mutex;
+	std::condition_variable uploaded;
+	bool cancelled = false;
+
+	const mesh* parsed_mesh = nullptr;
+	size_t parsed_vertices = 0;
+	size_t parsed_indices = 0;
+	size_t uploaded_vertices = 0;
+	size_t uploaded_indices = 0;
+
+	bool finished = false;
+	std::optional<std::pair<mesh_optimizer::statistics, mesh_optimizer::statistics>> vertex_cache;
+	gsl::span<const float> final_positions;
+	model::clusters final_clusters;
+	std::exception_ptr error;
+
+	// Written by the loading thread only, until it finished
+	std::unique_ptr<mesh_cache::entry> cache_entry;
+	std::unique_ptr<mapped_obj_loader> obj_loader;
+
+	bool complete = false;
+	statistics stats;
+
+	std::thread thread;
+
+	void load();
+	bool load_cached(const mesh_cache& cache);
+	void load_obj(const mesh_cache& cache);
+
+	void report_progress(const mesh& data, size_t vertex_count, size_t index_count);
+	void wait_for_upload();
+	void finish(gsl::span<const float> positions, model::clusters&& clusters);
+
+	double get_elapsed_ms() const;
+};
\ No newline at end of file
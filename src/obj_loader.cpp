@@ -26,6 +26,8 @@ void obj_loader::parse_file()
 			this->parse_line(line);
 		}
 	}
+
+	this->data.set_indices(std::move(this->indices));
 }
 
 void obj_loader::parse_line(std::string line)
@@ -47,7 +49,7 @@ void obj_loader::parse_line(std::string line)
 
 void obj_loader::parse_face(std::string data)
 {
-	std::array<int, 3> face = { 0,0,0 };
+	std::array<unsigned int, 3> face = { 0,0,0 };
 
 	int index = 0;
 	this->temporary_values.clear();
@@ -83,30 +85,32 @@ void obj_loader::parse_face(std::string data)
 
 	for (size_t i = 0; i < this->temporary_values.size() && i < 3; ++i)
 	{
-		face[i] = atoi(this->temporary_values[i].data()) - 1;
+		face[i] = static_cast<unsigned int>(atoi(this->temporary_values[i].data()) - 1);
 	}
 
-	this->faces.push_back(face);
+	this->indices.insert(this->indices.end(), face.begin(), face.end());
 
 	if (this->temporary_values.size() == 4)
 	{
 		for (size_t i = 2; i <= this->temporary_values.size(); ++i)
 		{
-			face[i - 2] = atoi(this->temporary_values[i % this->temporary_values.size()].data()) - 1;
+			face[i - 2] = static_cast<unsigned int>(atoi(this->temporary_values[i % this->temporary_values.size()].data()) - 1);
 		}
 
-		this->faces.push_back(face);
+		this->indices.insert(this->indices.end(), face.begin(), face.end());
 	}
 
 	if (this->temporary_values.size() > 4)
 	{
+#ifdef _WIN32
 		OutputDebugStringA("Triangulation needed");
+#endif
 	}
 }
 
 void obj_loader::parse_vertex(std::string data)
 {
-	glm::dvec4 vertex = { 1.0, 1.0, 1.0, 1.0 };
+	glm::vec3 vertex = { 1.0f, 1.0f, 1.0f };
 
 	this->temporary_values.clear();
 	this->temporary_number.clear();
@@ -133,15 +137,15 @@ void obj_loader::parse_vertex(std::string data)
 		this->temporary_values.push_back(this->temporary_number);
 	}
 
-	for (size_t i = 0; i < this->temporary_values.size() && i < 4; ++i)
+	for (size_t i = 0; i < this->temporary_values.size() && i < 3; ++i)
 	{
-		vertex[glm::dvec4::length_type(i)] = atof(this->temporary_values[i].data());
+		vertex[glm::vec3::length_type(i)] = static_cast<float>(atof(this->temporary_values[i].data()));
 	}
 
-	this->vertices.push_back(vertex);
+	this->data.positions.insert(this->data.positions.end(), { vertex.x, vertex.y, vertex.z });
 }
 
-model obj_loader::get_model()
+const mesh& obj_loader::get_mesh() const
 {
-	return model(this->vertices, this->faces);
-}
+	return this->data;
+}
\ No newline at end of file
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "model.hpp"
+#include "mesh.hpp"
 
 class obj_loader
 {
@@ -8,13 +8,13 @@ public:
 	obj_loader(std::string path);
 	~obj_loader();
 
-	model get_model();
+	const mesh& get_mesh() const;
 
 private:
 	std::string file_path;
 
-	std::vector<glm::dvec4> vertices;
-	std::vector<std::array<int,3>> faces;
+	mesh data;
+	std::vector<unsigned int> indices;
 
 	std::string temporary_number;
 	std::vector<std::string> temporary_values;
@@ -24,4 +24,4 @@ private:
 
 	void parse_face(std::string line);
 	void parse_vertex(std::string line);
-};
+};
\ No newline at end of file
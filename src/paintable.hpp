@@ -6,4 +6,7 @@ public:
 	virtual ~paintable() {}
 
 	virtual void paint() = 0;
+
+	// Stage name of the paintable in profiles
+	virtual const char* get_name() const = 0;
 };
@@ -2,44 +2,72 @@
 
 #include "painter_list.hpp"
 
-void painter_list::add(paintable* object)
+painter_list::~painter_list()
 {
-	std::lock_guard<std::recursive_mutex> _(this->mutex);
+	auto entry = this->pending_edits.exchange(nullptr);
 
-	this->remove(object);
-	this->objects.push_back(object);
+	while (entry)
+	{
+		delete std::exchange(entry, entry->next);
+	}
+}
+
+void painter_list::add(paintable* object)
+{
+	this->queue_edit(object, true);
 }
 
 void painter_list::remove(paintable* object)
 {
-	std::lock_guard<std::recursive_mutex> _(this->mutex);
+	this->queue_edit(object, false);
+}
+
+void painter_list::paint()
+{
+	this->apply_edits();
 
-	if (this->painting)
+	// Edits made while painting are queued for the next frame, the snapshot stays valid
+	for (const auto object : this->objects)
 	{
-		throw std::runtime_error("Modifying the painter list while painting is forbidden");
+		profiler::scope paint_scope(this->frame_profiler, object->get_name());
+		object->paint();
 	}
+}
 
-	auto element = std::find(this->objects.begin(), this->objects.end(), object);
+void painter_list::set_profiler(profiler* _frame_profiler)
+{
+	this->frame_profiler = _frame_profiler;
+}
 
-	if (element != this->objects.end())
+void painter_list::queue_edit(paintable* object, bool add)
+{
+	auto entry = new edit{object, add, this->pending_edits.load()};
+	while (!this->pending_edits.compare_exchange_weak(entry->next, entry))
 	{
-		this->objects.remove(object);
 	}
 }
 
-void painter_list::paint()
+void painter_list::apply_edits()
 {
-	std::lock_guard<std::recursive_mutex> _(this->mutex);
+	auto entry = this->pending_edits.exchange(nullptr);
+	if (!entry) return;
 
-	this->painting = true;
-	auto __ = gsl::finally([this]
+	// Reverse the queue into the order the edits were made
+	edit* oldest = nullptr;
+	while (entry)
 	{
-		this->painting = false;
-	});
+		const auto next = entry->next;
+		entry->next = oldest;
+		oldest = entry;
+		entry = next;
+	}
 
-	for (auto& object : this->objects)
+	entry = oldest;
+	while (entry)
 	{
-		object->paint();
-	}
+		this->objects.erase(std::remove(this->objects.begin(), this->objects.end(), entry->object), this->objects.end());
+		if (entry->add) this->objects.push_back(entry->object);
 
-}
+		delete std::exchange(entry, entry->next);
+	}
+}
\ No newline at end of file
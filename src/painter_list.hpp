@@ -1,18 +1,44 @@
 #pragma once
 
 #include "paintable.hpp"
+#include "profiler.hpp"
 
+// Paints a snapshot of its objects that only changes between frames. Edits can come from any thread, even from
+// within paint, they are queued without locks and applied in order right before the next frame is painted.
 class painter_list
 {
 public:
+	painter_list() = default;
+	~painter_list();
+
+	painter_list(const painter_list&) = delete;
+	painter_list& operator=(const painter_list&) = delete;
+
+	// Adding a listed object again moves it to the end
 	void add(paintable* object);
+
+	// The object may still be painted until the next frame starts, only destroy it after that frame
 	void remove(paintable* object);
 
 	void paint();
 
+	// Times every paintable as a stage of its name, nullptr disables it. Only call it from the painting thread.
+	void set_profiler(profiler* frame_profiler);
+
 private:
-	bool painting = false;
+	struct edit
+	{
+		paintable* object;
+		bool add;
+		edit* next;
+	};
+
+	// Most recent edit first
+	std::atomic<edit*> pending_edits{nullptr};
+
+	std::vector<paintable*> objects;
+	profiler* frame_profiler = nullptr;
 
-	std::recursive_mutex mutex;
-	std::list<paintable*> objects;
-};
+	void queue_edit(paintable* object, bool add);
+	void apply_edits();
+};
\ No newline at end of file
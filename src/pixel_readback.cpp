@@ -0,0 +1,164 @@
+#include "std_include.hpp"
+
+#include "pixel_readback.hpp"
+#include "gl_state.hpp"
+
+pixel_readback::pixel_readback(mode mode, int buffer_count) : current_mode(mode)
+{
+	this->slots.resize(std::max(2, buffer_count));
+}
+
+pixel_readback::~pixel_readback()
+{
+	this->destroy_slots();
+}
+
+void pixel_readback::set_mode(mode mode)
+{
+	if (mode == this->current_mode) return;
+
+	this->destroy_slots();
+	this->current_mode = mode;
+}
+
+pixel_readback::mode pixel_readback::get_mode() const
+{
+	return this->current_mode;
+}
+
+const pixel_readback::statistics& pixel_readback::get_statistics() const
+{
+	return this->stats;
+}
+
+const void* pixel_readback::read(int width, int height, GLenum format, GLenum type, int bytes_per_pixel)
+{
+	const auto size = static_cast<size_t>(width) * height * bytes_per_pixel;
+
+	const auto alignment = gl_state::get_alignment(GL_PACK_ALIGNMENT);
+	gl_state::set_alignment(GL_PACK_ALIGNMENT, 1);
+
+	auto _ = gsl::finally([alignment]()
+	{
+		gl_state::set_alignment(GL_PACK_ALIGNMENT, alignment);
+	});
+
+	this->stats.frames++;
+
+	if (this->current_mode == mode::asynchronous)
+	{
+		return this->read_asynchronous(width, height, format, type, size);
+	}
+
+	return this->read_synchronous(width, height, format, type, size);
+}
+
+const void* pixel_readback::read_synchronous(int width, int height, GLenum format, GLenum type, size_t size)
+{
+	this->client_buffer.resize(size);
+
+	// Blocks until everything rendered so far is finished
+	const auto start = std::chrono::high_resolution_clock::now();
+	glReadPixels(0, 0, width, height, format, type, this->client_buffer.data());
+	this->record_stall(start);
+
+	return this->client_buffer.data();
+}
+
+const void* pixel_readback::read_asynchronous(int width, int height, GLenum format, GLenum type, size_t size)
+{
+	this->unmap();
+	this->adjust_slots(size, format, type);
+
+	// Queue this frame's transfer, it completes in the background while the next frames render
+	auto& target = this->slots[this->next_slot];
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, target.buffer);
+	glReadPixels(0, 0, width, height, format, type, nullptr);
+	target.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	this->next_slot = (this->next_slot + 1) % static_cast<int>(this->slots.size());
+
+	// The slot written next is the oldest one in flight
+	auto& source = this->slots[this->next_slot];
+	if (!source.fence)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		return nullptr;
+	}
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	glClientWaitSync(source.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+	glDeleteSync(source.fence);
+	source.fence = nullptr;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, source.buffer);
+	auto data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_READ_BIT);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	this->record_stall(start);
+
+	if (!data)
+	{
+		throw std::runtime_error("Unable to map pixel buffer");
+	}
+
+	this->mapped_slot = this->next_slot;
+	return data;
+}
+
+void pixel_readback::adjust_slots(size_t size, GLenum format, GLenum type)
+{
+	if (this->slots.front().buffer && size == this->buffer_size && format == this->buffer_format && type == this->buffer_type) return;
+
+	this->destroy_slots();
+
+	this->buffer_size = size;
+	this->buffer_format = format;
+	this->buffer_type = type;
+
+	for (auto& slot : this->slots)
+	{
+		glGenBuffers(1, &slot.buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_READ);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void pixel_readback::destroy_slots()
+{
+	this->unmap();
+
+	for (auto& slot : this->slots)
+	{
+		if (slot.fence) glDeleteSync(slot.fence);
+		gl_state::delete_buffer(slot.buffer);
+
+		slot = {};
+	}
+
+	this->next_slot = 0;
+	this->buffer_size = 0;
+}
+
+void pixel_readback::unmap()
+{
+	if (this->mapped_slot < 0) return;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, this->slots[this->mapped_slot].buffer);
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	this->mapped_slot = -1;
+}
+
+void pixel_readback::record_stall(std::chrono::high_resolution_clock::time_point start)
+{
+	const auto stall = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+
+	this->stats.last_stall_us = stall;
+	this->stats.stall_us += static_cast<unsigned long long>(stall);
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+class pixel_readback
+{
+public:
+	enum class mode
+	{
+		synchronous, // Pixels of the current frame, waits for the GPU to finish it
+		asynchronous, // Pixels of an earlier frame, read through a ring of pixel buffer objects
+	};
+
+	struct statistics
+	{
+		unsigned long long frames = 0;
+		unsigned long long stall_us = 0;
+		long long last_stall_us = 0;
+	};
+
+	pixel_readback(mode mode = mode::synchronous, int buffer_count = 2);
+	~pixel_readback();
+
+	void set_mode(mode mode);
+	mode get_mode() const;
+
+	// Reads the current read framebuffer. In asynchronous mode the result lags buffer_count - 1 frames
+	// behind and is nullptr until the ring is filled. The data stays valid until the next call.
+	const void* read(int width, int height, GLenum format, GLenum type, int bytes_per_pixel);
+
+	const statistics& get_statistics() const;
+
+private:
+	struct slot
+	{
+		GLuint buffer = 0;
+		GLsync fence = nullptr;
+	};
+
+	mode current_mode;
+
+	std::vector<slot> slots;
+	int next_slot = 0;
+	int mapped_slot = -1;
+
+	size_t buffer_size = 0;
+	GLenum buffer_format = 0;
+	GLenum buffer_type = 0;
+
+	std::vector<unsigned char> client_buffer;
+
+	statistics stats;
+
+	const void* read_synchronous(int width, int height, GLenum format, GLenum type, size_t size);
+	const void* read_asynchronous(int width, int height, GLenum format, GLenum type, size_t size);
+
+	void adjust_slots(size_t size, GLenum format, GLenum type);
+	void destroy_slots();
+	void unmap();
+
+	void record_stall(std::chrono::high_resolution_clock::time_point start);
+};
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "std_include.hpp"
+
+#include "pixel_upload.hpp"
+#include "gl_state.hpp"
+
+pixel_upload::pixel_upload(mode mode, int buffer_count) : current_mode(mode)
+{
+	this->slots.resize(std::max(2, buffer_count));
+}
+
+pixel_upload::~pixel_upload()
+{
+	this->destroy_slots();
+}
+
+void pixel_upload::set_mode(mode mode)
+{
+	if (mode == this->current_mode) return;
+
+	this->destroy_slots();
+	this->client_buffer = {};
+	this->current_mode = mode;
+}
+
+pixel_upload::mode pixel_upload::get_mode() const
+{
+	return this->current_mode;
+}
+
+const pixel_upload::statistics& pixel_upload::get_statistics() const
+{
+	return this->stats;
+}
+
+void* pixel_upload::map(size_t size)
+{
+	if (this->current_mode == mode::client_memory)
+	{
+		this->client_buffer.resize(size);
+		return this->client_buffer.data();
+	}
+
+	this->adjust_slots(size);
+
+	auto& target = this->slots[this->current_slot];
+
+	if (target.fence)
+	{
+		// Only blocks if the GPU is more than a ring behind
+		const auto start = std::chrono::high_resolution_clock::now();
+		glClientWaitSync(target.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		this->stats.stall_us += static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count());
+
+		glDeleteSync(target.fence);
+		target.fence = nullptr;
+	}
+
+	if (this->persistent) return target.mapping;
+
+	// Only the stereogram uses the unpack target, its binding is neither tracked nor restored
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, target.buffer);
+	auto data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (!data)
+	{
+		throw std::runtime_error("Unable to map pixel unpack buffer");
+	}
+
+	this->mapped = true;
+	return data;
+}
+
+void pixel_upload::upload(GLuint texture, int width, int begin, int end, GLenum format, GLenum type, int bytes_per_pixel)
+{
+	if (this->current_mode == mode::client_memory)
+	{
+		this->transfer(texture, 0, this->client_buffer.data(), width, begin, end, format, type, bytes_per_pixel);
+	}
+	else
+	{
+		this->unmap();
+		this->transfer(texture, this->slots[this->current_slot].buffer, nullptr, width, begin, end, format, type, bytes_per_pixel);
+	}
+}
+
+void pixel_upload::upload(GLuint texture, const void* pixels, int width, int begin, int end, GLenum format, GLenum type, int bytes_per_pixel)
+{
+	this->transfer(texture, 0, pixels, width, begin, end, format, type, bytes_per_pixel);
+}
+
+void pixel_upload::transfer(GLuint texture, GLuint buffer, const void* pixels, int width, int begin, int end, GLenum format, GLenum type, int bytes_per_pixel)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	const auto texture_2d = gl_state::get_texture_2d();
+	const auto alignment = gl_state::get_alignment(GL_UNPACK_ALIGNMENT);
+
+	// Rows of 4 byte pixels are always aligned, only packed 3 byte rows need byte alignment
+	if (bytes_per_pixel % 4) gl_state::set_alignment(GL_UNPACK_ALIGNMENT, 1);
+	gl_state::bind_texture_2d(texture);
+
+	const auto offset = static_cast<size_t>(begin) * width * bytes_per_pixel;
+	// A bound unpack buffer turns the pointer into an offset
+	const auto source = buffer ? reinterpret_cast<const void*>(offset) : static_cast<const unsigned char*>(pixels) + offset;
+
+	// From a buffer the call returns right away, the copy is queued like any other command
+	if (buffer) glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, begin, width, end - begin, format, type, source);
+	if (buffer) glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	gl_state::bind_texture_2d(texture_2d);
+	gl_state::set_alignment(GL_UNPACK_ALIGNMENT, alignment);
+
+	this->stats.upload_us += static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count());
+}
+
+void pixel_upload::finish()
+{
+	this->stats.frames++;
+
+	if (this->current_mode == mode::client_memory || !this->buffer_size) return;
+
+	this->unmap();
+
+	auto& target = this->slots[this->current_slot];
+	target.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	this->current_slot = (this->current_slot + 1) % static_cast<int>(this->slots.size());
+}
+
+void pixel_upload::adjust_slots(size_t size)
+{
+	if (this->slots.front().buffer && size == this->buffer_size) return;
+
+	this->destroy_slots();
+
+	this->buffer_size = size;
+	this->persistent = GLEW_ARB_buffer_storage == GL_TRUE;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	for (auto& slot : this->slots)
+	{
+		glGenBuffers(1, &slot.buffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+
+		if (this->persistent)
+		{
+			glBufferStorage(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, flags);
+			slot.mapping = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size), flags);
+		}
+		else
+		{
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+		}
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	for (const auto& slot : this->slots)
+	{
+		if (this->persistent && !slot.mapping)
+		{
+			this->destroy_slots();
+			throw std::runtime_error("Unable to map pixel unpack buffer");
+		}
+	}
+}
+
+void pixel_upload::destroy_slots()
+{
+	this->unmap();
+
+	for (auto& slot : this->slots)
+	{
+		if (slot.fence) glDeleteSync(slot.fence);
+
+		// Deleting a persistently mapped buffer unmaps it
+		gl_state::delete_buffer(slot.buffer);
+
+		slot = {};
+	}
+
+	this->current_slot = 0;
+	this->buffer_size = 0;
+}
+
+void pixel_upload::unmap()
+{
+	if (!this->mapped) return;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->slots[this->current_slot].buffer);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	this->mapped = false;
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+class pixel_upload
+{
+public:
+	enum class mode
+	{
+		client_memory, // Images are written to client memory, the driver copies them during glTexSubImage2D
+		mapped_ring, // Images are written straight into a ring of mapped pixel unpack buffers, the driver copies them asynchronously
+	};
+
+	struct statistics
+	{
+		unsigned long long frames = 0;
+		unsigned long long upload_us = 0;
+		unsigned long long stall_us = 0;
+	};
+
+	pixel_upload(mode mode = mode::client_memory, int buffer_count = 3);
+	~pixel_upload();
+
+	pixel_upload(const pixel_upload&) = delete;
+	pixel_upload& operator=(const pixel_upload&) = delete;
+
+	void set_mode(mode mode);
+	mode get_mode() const;
+
+	// Memory to write the next image into, valid until finish. Client memory keeps its content across frames,
+	// ring slots don't. Waits only if the GPU still reads the slot from buffer_count frames ago.
+	void* map(size_t size);
+
+	// Copies rows [begin, end) of the mapped image into the texture, may be called several times per image
+	void upload(GLuint texture, int width, int begin, int end, GLenum format, GLenum type, int bytes_per_pixel);
+
+	// Same from client memory the caller owns, in either mode
+	void upload(GLuint texture, const void* pixels, int width, int begin, int end, GLenum format, GLenum type, int bytes_per_pixel);
+
+	// Done with the image, the next map moves on to the next slot
+	void finish();
+
+	const statistics& get_statistics() const;
+
+private:
+	struct slot
+	{
+		GLuint buffer = 0;
+		void* mapping = nullptr;
+		GLsync fence = nullptr;
+	};
+
+	mode current_mode;
+
+	std::vector<slot> slots;
+	int current_slot = 0;
+	size_t buffer_size = 0;
+
+	// Without ARB_buffer_storage slots are mapped every frame and unmapped before the first upload
+	bool persistent = false;
+	bool mapped = false;
+
+	std::vector<unsigned char> client_buffer;
+
+	statistics stats;
+
+	void transfer(GLuint texture, GLuint buffer, const void* pixels, int width, int begin, int end, GLenum format, GLenum type, int bytes_per_pixel);
+
+	void adjust_slots(size_t size);
+	void destroy_slots();
+	void unmap();
+};
\ No newline at end of file
@@ -0,0 +1,421 @@
+#include "std_include.hpp"
+
+#include "profiler.hpp"
+
+namespace
+{
+	constexpr size_t no_gpu_range = ~size_t(0);
+
+	// Frames whose queries are in flight before they are read, the GPU is usually at most two frames behind
+	constexpr size_t gpu_frame_latency = 4;
+
+	int get_bucket(double us, int buckets_per_octave, int bucket_count)
+	{
+		if (!(us >= 1.0)) return 0;
+
+		const auto bucket = static_cast<int>(std::log2(us) * buckets_per_octave) + 1;
+		return std::min(bucket, bucket_count - 1);
+	}
+
+	// Upper bound of a bucket, so percentiles are at most one bucket (9%) too high and never too low
+	double get_bucket_limit(int bucket, int buckets_per_octave)
+	{
+		return std::exp2(static_cast<double>(bucket) / buckets_per_octave);
+	}
+
+	std::string escape_json(const std::string& text)
+	{
+		std::string result;
+		result.reserve(text.size());
+
+		for (const auto c : text)
+		{
+			if (c == '"' || c == '\\') result.push_back('\\');
+			if (static_cast<unsigned char>(c) >= 0x20) result.push_back(c);
+		}
+
+		return result;
+	}
+
+	std::string format_statistics(const profiler::statistics& stats)
+	{
+		char buffer[96];
+		snprintf(buffer, sizeof(buffer), "%8.3f %8.3f %8.3f %8.3f", stats.p50_ms, stats.p90_ms, stats.p99_ms, stats.max_ms);
+		return buffer;
+	}
+}
+
+profiler::scope::scope(profiler* _owner, const char* name) : owner(_owner), gpu_range(no_gpu_range)
+{
+	if (!this->owner) return;
+
+	this->stage = this->owner->get_stage(name);
+	this->gpu_range = this->owner->begin_gpu_range(this->stage);
+	this->start_us = this->owner->now_us();
+}
+
+profiler::scope::~scope()
+{
+	if (!this->owner) return;
+
+	this->owner->add_cpu_time(this->stage, this->start_us, this->owner->now_us());
+	this->owner->end_gpu_range(this->gpu_range);
+}
+
+profiler::histogram::histogram(size_t window_frames) : samples(std::max(window_frames, size_t(1)))
+{
+}
+
+void profiler::histogram::add(double us)
+{
+	if (this->count == this->samples.size())
+	{
+		--this->buckets[this->samples[this->next]];
+	}
+	else
+	{
+		++this->count;
+	}
+
+	const auto bucket = get_bucket(us, buckets_per_octave, bucket_count);
+
+	this->samples[this->next] = static_cast<unsigned char>(bucket);
+	++this->buckets[bucket];
+
+	this->next = (this->next + 1) % this->samples.size();
+}
+
+profiler::statistics profiler::histogram::get() const
+{
+	statistics result;
+	result.frames = this->count;
+
+	if (!this->count) return result;
+
+	const auto percentile = [this](double fraction)
+	{
+		const auto target = std::max(size_t(1), static_cast<size_t>(std::ceil(fraction * this->count)));
+
+		size_t sum = 0;
+		for (int bucket = 0; bucket < bucket_count; ++bucket)
+		{
+			sum += this->buckets[bucket];
+			if (sum >= target) return get_bucket_limit(bucket, buckets_per_octave) / 1000.0;
+		}
+
+		return get_bucket_limit(bucket_count - 1, buckets_per_octave) / 1000.0;
+	};
+
+	result.p50_ms = percentile(0.5);
+	result.p90_ms = percentile(0.9);
+	result.p99_ms = percentile(0.99);
+	result.max_ms = percentile(1.0);
+
+	return result;
+}
+
+profiler::profiler(size_t _window_frames) : window_frames(_window_frames)
+{
+	this->gpu_timing = GLEW_ARB_timer_query != GL_FALSE;
+
+	if (this->gpu_timing)
+	{
+		this->gpu_frames.resize(gpu_frame_latency);
+	}
+
+	this->frame_stage = this->get_stage("frame");
+}
+
+profiler::~profiler()
+{
+	for (auto& frame : this->gpu_frames)
+	{
+		for (auto& range : frame.ranges)
+		{
+			glDeleteQueries(2, range.queries);
+		}
+	}
+}
+
+void profiler::begin_frame()
+{
+	if (this->in_frame) throw std::runtime_error("Frame already started");
+
+	this->frame_start_us = this->now_us();
+
+	if (this->gpu_timing)
+	{
+		auto& frame = this->gpu_frames[this->current_gpu_frame];
+		this->collect_gpu_frame(frame);
+
+		frame.reference_us = this->now_us();
+		glGetInteger64v(GL_TIMESTAMP, &frame.reference_ns);
+	}
+
+	this->in_frame = true;
+	this->frame_gpu_range = this->begin_gpu_range(this->frame_stage);
+}
+
+void profiler::end_frame()
+{
+	if (!this->in_frame) throw std::runtime_error("No frame started");
+
+	this->end_gpu_range(this->frame_gpu_range);
+	this->add_cpu_time(this->frame_stage, this->frame_start_us, this->now_us());
+
+	this->in_frame = false;
+
+	for (auto& stage : this->stages)
+	{
+		if (!stage.ran_on_cpu) continue;
+
+		stage.cpu.add(stage.frame_cpu_us);
+		stage.frame_cpu_us = 0.0;
+		stage.ran_on_cpu = false;
+	}
+
+	if (this->gpu_timing)
+	{
+		this->current_gpu_frame = (this->current_gpu_frame + 1) % this->gpu_frames.size();
+	}
+}
+
+bool profiler::has_gpu_timing() const
+{
+	return this->gpu_timing;
+}
+
+bool profiler::get_cpu_statistics(const std::string& name, statistics& result) const
+{
+	const auto stage = this->find_stage(name);
+	if (!stage) return false;
+
+	result = stage->cpu.get();
+	return result.frames > 0;
+}
+
+bool profiler::get_gpu_statistics(const std::string& name, statistics& result) const
+{
+	const auto stage = this->find_stage(name);
+	if (!stage) return false;
+
+	result = stage->gpu.get();
+	return result.frames > 0;
+}
+
+std::string profiler::get_summary(size_t max_stages) const
+{
+	std::vector<std::pair<double, const stage*>> slowest;
+
+	for (const auto& stage : this->stages)
+	{
+		if (&stage == &this->stages[this->frame_stage]) continue;
+
+		const auto stats = stage.cpu.get();
+		if (stats.frames) slowest.emplace_back(stats.p50_ms, &stage);
+	}
+
+	std::sort(slowest.begin(), slowest.end(), [](const auto& a, const auto& b)
+	{
+		return a.first > b.first;
+	});
+
+	slowest.resize(std::min(slowest.size(), max_stages));
+	slowest.insert(slowest.begin(), {0.0, &this->stages[this->frame_stage]});
+
+	std::string result;
+
+	for (const auto& entry : slowest)
+	{
+		const auto cpu = entry.second->cpu.get();
+		const auto gpu = entry.second->gpu.get();
+
+		char buffer[128];
+		if (gpu.frames)
+		{
+			snprintf(buffer, sizeof(buffer), "%s %.1f/%.1f ms (gpu %.1f)", entry.second->name.data(), cpu.p50_ms, cpu.p99_ms, gpu.p50_ms);
+		}
+		else
+		{
+			snprintf(buffer, sizeof(buffer), "%s %.1f/%.1f ms", entry.second->name.data(), cpu.p50_ms, cpu.p99_ms);
+		}
+
+		if (!result.empty()) result += ", ";
+		result += buffer;
+	}
+
+	return result;
+}
+
+std::string profiler::get_report() const
+{
+	char buffer[256];
+	snprintf(buffer, sizeof(buffer), "%-28s %7s %8s %8s %8s %8s   %8s %8s %8s %8s\n", "stage (ms)", "frames", "cpu p50", "p90", "p99", "max", "gpu p50", "p90", "p99", "max");
+
+	std::string result = buffer;
+
+	for (const auto& entry : this->stage_indices)
+	{
+		const auto& stage = this->stages[entry.second];
+		const auto cpu = stage.cpu.get();
+		const auto gpu = stage.gpu.get();
+
+		snprintf(buffer, sizeof(buffer), "%-28s %7zu %s", stage.name.data(), cpu.frames, format_statistics(cpu).data());
+		result += buffer;
+
+		if (gpu.frames) result += "   " + format_statistics(gpu);
+		result += "\n";
+	}
+
+	return result;
+}
+
+void profiler::set_tracing(bool enabled)
+{
+	this->tracing = enabled;
+}
+
+void profiler::write_report(const std::string& path) const
+{
+	std::ofstream stream(path, std::ios::binary);
+	if (!stream.good()) throw std::runtime_error("Unable to open " + path);
+
+	stream << this->get_report();
+
+	if (!stream.good()) throw std::runtime_error("Unable to write " + path);
+}
+
+void profiler::write_trace(const std::string& path) const
+{
+	std::ofstream stream(path, std::ios::binary);
+	if (!stream.good()) throw std::runtime_error("Unable to open " + path);
+
+	stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+	char buffer[64];
+
+	for (const auto& event : this->trace)
+	{
+		stream << ",\n{\"name\":\"" << escape_json(this->stages[event.stage].name) << "\",\"cat\":\"" << (event.gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\"";
+
+		snprintf(buffer, sizeof(buffer), ",\"ts\":%.3f,\"dur\":%.3f", event.start_us, event.duration_us);
+		stream << buffer << ",\"pid\":1,\"tid\":" << (event.gpu ? 2 : 1) << "}";
+	}
+
+	stream << "\n]}\n";
+
+	if (!stream.good()) throw std::runtime_error("Unable to write " + path);
+}
+
+double profiler::now_us() const
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - this->epoch).count();
+}
+
+size_t profiler::get_stage(const char* name)
+{
+	// Transparent lookup, only the first use of a stage allocates
+	const auto entry = this->stage_indices.find(name);
+	if (entry != this->stage_indices.end()) return entry->second;
+
+	const auto index = this->stages.size();
+	this->stages.push_back({name, histogram(this->window_frames), histogram(this->window_frames)});
+	this->stage_indices.emplace(name, index);
+
+	return index;
+}
+
+const profiler::stage* profiler::find_stage(const std::string& name) const
+{
+	const auto entry = this->stage_indices.find(name);
+	return entry == this->stage_indices.end() ? nullptr : &this->stages[entry->second];
+}
+
+size_t profiler::begin_gpu_range(size_t stage)
+{
+	// Outside of frames there's no query pool to take them from
+	if (!this->gpu_timing || !this->in_frame) return no_gpu_range;
+
+	auto& frame = this->gpu_frames[this->current_gpu_frame];
+
+	if (frame.used == frame.ranges.size())
+	{
+		gpu_range range{};
+		glGenQueries(2, range.queries);
+		frame.ranges.push_back(range);
+	}
+
+	const auto index = frame.used++;
+	auto& range = frame.ranges[index];
+
+	range.stage = stage;
+	glQueryCounter(range.queries[0], GL_TIMESTAMP);
+
+	return index;
+}
+
+void profiler::end_gpu_range(size_t range)
+{
+	if (range == no_gpu_range) return;
+
+	glQueryCounter(this->gpu_frames[this->current_gpu_frame].ranges[range].queries[1], GL_TIMESTAMP);
+}
+
+void profiler::collect_gpu_frame(gpu_frame& frame)
+{
+	const auto ranges = gsl::make_span(frame.ranges.data(), frame.used);
+	frame.used = 0;
+
+	// Never wait for the GPU, a frame that is still not done after the whole ring is dropped
+	for (const auto& range : ranges)
+	{
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(range.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		if (!available) return;
+	}
+
+	for (const auto& range : ranges)
+	{
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(range.queries[0], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(range.queries[1], GL_QUERY_RESULT, &end);
+
+		const auto duration_us = static_cast<double>(end - begin) / 1000.0;
+
+		auto& stage = this->stages[range.stage];
+		stage.frame_gpu_us += duration_us;
+		stage.ran_on_gpu = true;
+
+		// GPU clock to CPU time, by the timestamp taken when the frame started on the CPU
+		const auto start_us = frame.reference_us + static_cast<double>(static_cast<GLint64>(begin) - frame.reference_ns) / 1000.0;
+		this->add_trace_event(range.stage, true, start_us, duration_us);
+	}
+
+	for (auto& stage : this->stages)
+	{
+		if (!stage.ran_on_gpu) continue;
+
+		stage.gpu.add(stage.frame_gpu_us);
+		stage.frame_gpu_us = 0.0;
+		stage.ran_on_gpu = false;
+	}
+}
+
+void profiler::add_cpu_time(size_t stage, double start_us, double end_us)
+{
+	auto& entry = this->stages[stage];
+	entry.frame_cpu_us += end_us - start_us;
+	entry.ran_on_cpu = true;
+
+	this->add_trace_event(stage, false, start_us, end_us - start_us);
+}
+
+void profiler::add_trace_event(size_t stage, bool gpu, double start_us, double duration_us)
+{
+	if (!this->tracing || this->trace.size() >= max_trace_events) return;
+
+	this->trace.push_back({stage, gpu, start_us, duration_us});
+}
\ No newline at end of file
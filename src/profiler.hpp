@@ -0,0 +1,155 @@
+#pragma once
+
+// Measures named stages per frame on the CPU and, with GL timer queries, on the GPU. Only use it on the thread owning the GL context.
+class profiler
+{
+public:
+	// Times everything until it is destroyed as the given stage, scopes nest. A null profiler measures nothing.
+	// The name has to outlive the profiler, stages are told apart by their text.
+	class scope
+	{
+	public:
+		scope(profiler* owner, const char* name);
+		~scope();
+
+		scope(const scope&) = delete;
+		scope& operator=(const scope&) = delete;
+
+	private:
+		profiler* owner;
+		size_t stage = 0;
+		size_t gpu_range = 0;
+		double start_us = 0.0;
+	};
+
+	// Percentiles of a stage's summed time per frame, over the recent frames the stage ran in
+	struct statistics
+	{
+		size_t frames = 0;
+
+		double p50_ms = 0.0;
+		double p90_ms = 0.0;
+		double p99_ms = 0.0;
+		double max_ms = 0.0;
+	};
+
+	// Needs a current GL context, GPU times are only measured if it supports timer queries
+	profiler(size_t window_frames = 512);
+	~profiler();
+
+	profiler(const profiler&) = delete;
+	profiler& operator=(const profiler&) = delete;
+
+	void begin_frame();
+	void end_frame();
+
+	bool has_gpu_timing() const;
+
+	// Returns false if the stage didn't run within the window yet
+	bool get_cpu_statistics(const std::string& stage, statistics& result) const;
+	bool get_gpu_statistics(const std::string& stage, statistics& result) const;
+
+	// Median and 99th percentile of the slowest stages, short enough for the title bar
+	std::string get_summary(size_t max_stages = 3) const;
+
+	// One line per stage with all percentiles
+	std::string get_report() const;
+	void write_report(const std::string& path) const;
+
+	// Records every scope as an event until disabled, at most max_trace_events
+	void set_tracing(bool enabled);
+
+	// Chrome trace event format, opens in chrome://tracing or Perfetto. CPU and GPU stages are separate threads.
+	void write_trace(const std::string& path) const;
+
+private:
+	static constexpr size_t max_trace_events = 1 << 20;
+
+	// Times are sorted into logarithmic buckets, buckets_per_octave per doubling starting at 1 us
+	static constexpr int buckets_per_octave = 8;
+	static constexpr int bucket_count = 24 * buckets_per_octave;
+
+	class histogram
+	{
+	public:
+		explicit histogram(size_t window_frames);
+
+		// Replaces the oldest sample once the window is full
+		void add(double us);
+		statistics get() const;
+
+	private:
+		std::vector<unsigned char> samples;
+		size_t next = 0;
+		size_t count = 0;
+
+		std::array<unsigned int, bucket_count> buckets{};
+	};
+
+	struct stage
+	{
+		std::string name;
+
+		histogram cpu;
+		histogram gpu;
+
+		double frame_cpu_us = 0.0;
+		double frame_gpu_us = 0.0;
+		bool ran_on_cpu = false;
+		bool ran_on_gpu = false;
+	};
+
+	struct gpu_range
+	{
+		size_t stage;
+		GLuint queries[2];
+	};
+
+	// Queries of one frame, read a few frames later when the GPU is done with them
+	struct gpu_frame
+	{
+		std::vector<gpu_range> ranges;
+		size_t used = 0;
+
+		double reference_us = 0.0;
+		GLint64 reference_ns = 0;
+	};
+
+	struct trace_event
+	{
+		size_t stage;
+		bool gpu;
+		double start_us;
+		double duration_us;
+	};
+
+	size_t window_frames;
+	std::chrono::high_resolution_clock::time_point epoch = std::chrono::high_resolution_clock::now();
+
+	std::vector<stage> stages;
+	std::map<std::string, size_t, std::less<>> stage_indices;
+
+	bool gpu_timing = false;
+	bool in_frame = false;
+	std::vector<gpu_frame> gpu_frames;
+	size_t current_gpu_frame = 0;
+
+	size_t frame_stage;
+	size_t frame_gpu_range = 0;
+	double frame_start_us = 0.0;
+
+	bool tracing = false;
+	std::vector<trace_event> trace;
+
+	double now_us() const;
+
+	size_t get_stage(const char* name);
+	const stage* find_stage(const std::string& name) const;
+
+	size_t begin_gpu_range(size_t stage);
+	void end_gpu_range(size_t range);
+	void collect_gpu_frame(gpu_frame& frame);
+
+	void add_cpu_time(size_t stage, double start_us, double end_us);
+	void add_trace_event(size_t stage, bool gpu, double start_us, double duration_us);
+};
\ No newline at end of file
@@ -1,11 +1,55 @@
 #pragma once
 
-namespace random
+// Counter based generator, every word is a pure function of the seed, a stream and a counter.
+// Ranges can be generated on any thread, in any order and with SIMD, and always yield the same bytes.
+class random_generator
 {
-	inline int fastrand()
+public:
+	explicit random_generator(unsigned int seed = 0) : seed(seed)
 	{
-		static unsigned int g_seed = static_cast<unsigned int>(time(nullptr));
-		g_seed = (214013 * g_seed + 2531011);
-		return (g_seed >> 16) & 0x7FFF;
 	}
-}
+
+	unsigned int get_seed() const
+	{
+		return this->seed;
+	}
+
+	// Key of an independent stream, e.g. one per frame or pattern row
+	unsigned int get_stream_key(unsigned int stream) const
+	{
+		return random_generator::mix(this->seed ^ random_generator::mix(stream + 0x9E3779B9u));
+	}
+
+	static unsigned int get_word(unsigned int stream_key, unsigned int counter)
+	{
+		return random_generator::mix(stream_key + counter);
+	}
+
+	// Writes the words counter, counter + 1, ... of a stream in little endian byte order
+	static void fill_bytes(unsigned int stream_key, unsigned int counter, unsigned char* output, int count)
+	{
+		for (int i = 0; i < count; i += 4, ++counter)
+		{
+			const auto word = random_generator::get_word(stream_key, counter);
+
+			for (int b = 0; b < 4 && i + b < count; ++b)
+			{
+				output[i + b] = static_cast<unsigned char>(word >> (b * 8));
+			}
+		}
+	}
+
+	// Bijective 32 bit integer hash (lowbias32), only 32 bit multiplies so it maps to SIMD and GLSL
+	static unsigned int mix(unsigned int value)
+	{
+		value ^= value >> 16;
+		value *= 0x7FEB352Du;
+		value ^= value >> 15;
+		value *= 0x846CA68Bu;
+		value ^= value >> 16;
+		return value;
+	}
+
+private:
+	unsigned int seed;
+};
\ No newline at end of file
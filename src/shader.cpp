@@ -1,6 +1,7 @@
 #include "std_include.hpp"
 
 #include "shader.hpp"
+#include "gl_state.hpp"
 
 shader::shader(std::string vertex_source, std::string fragment_source, std::vector<std::string> attributes)
 {
@@ -13,8 +14,8 @@ shader::shader(std::string vertex_source, std::string fragment_source, std::vect
 
 	this->fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
 	glShaderSource(this->fragment_shader, 1, &fragment_shader_source, NULL);
-	glCompileShader(this->fragment_shader);
-
+	glCompileShader(this->fragment_shader);
+
 	this->shader_program = glCreateProgram();
 	glAttachShader(this->shader_program, this->fragment_shader);
 	glAttachShader(this->shader_program, this->vertex_shader);
@@ -27,17 +28,70 @@ shader::shader(std::string vertex_source, std::string fragment_source, std::vect
 	glLinkProgram(this->shader_program);
 }
 
+shader::shader(std::string compute_source)
+{
+	char* compute_shader_source = compute_source.data();
+
+	this->compute_shader = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(this->compute_shader, 1, &compute_shader_source, NULL);
+	glCompileShader(this->compute_shader);
+
+	this->shader_program = glCreateProgram();
+	glAttachShader(this->shader_program, this->compute_shader);
+	glLinkProgram(this->shader_program);
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(this->shader_program, GL_LINK_STATUS, &status);
+
+	if (status != GL_TRUE)
+	{
+		char log[1024] = { 0 };
+		glGetProgramInfoLog(this->shader_program, sizeof(log), nullptr, log);
+
+		gl_state::delete_program(this->shader_program);
+		glDeleteShader(this->compute_shader);
+
+		throw std::runtime_error("Unable to build compute shader: "s + log);
+	}
+}
+
 shader::~shader()
 {
-	glDeleteProgram(this->shader_program);
-	glDeleteShader(this->fragment_shader);
-	glDeleteShader(this->vertex_shader);
+	gl_state::delete_program(this->shader_program);
+	if (this->compute_shader) glDeleteShader(this->compute_shader);
+	if (this->fragment_shader) glDeleteShader(this->fragment_shader);
+	if (this->vertex_shader) glDeleteShader(this->vertex_shader);
 }
 
 void shader::use()
 {
 	if (this->shader_program)
 	{
-		glUseProgram(this->shader_program);
+		gl_state::use_program(this->shader_program);
 	}
 }
+
+void shader::set_uniform(const std::string& name, int value)
+{
+	glUniform1i(this->get_uniform_location(name), value);
+}
+
+void shader::set_uniform(const std::string& name, unsigned int value)
+{
+	glUniform1ui(this->get_uniform_location(name), value);
+}
+
+void shader::set_uniform(const std::string& name, float value)
+{
+	glUniform1f(this->get_uniform_location(name), value);
+}
+
+GLint shader::get_uniform_location(const std::string& name)
+{
+	const auto entry = this->uniform_locations.find(name);
+	if (entry != this->uniform_locations.end()) return entry->second;
+
+	const auto location = glGetUniformLocation(this->shader_program, name.data());
+	this->uniform_locations.emplace(name, location);
+	return location;
+}
\ No newline at end of file
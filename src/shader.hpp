@@ -4,12 +4,25 @@ class shader
 {
 public:
 	shader(std::string vertex_source, std::string fragment_source, std::vector<std::string> attributes = {});
+
+	// Compute program, requires OpenGL 4.3 and throws if the shader fails to build
+	explicit shader(std::string compute_source);
 	~shader();
 
 	void use();
 
+	void set_uniform(const std::string& name, int value);
+	void set_uniform(const std::string& name, unsigned int value);
+	void set_uniform(const std::string& name, float value);
+
 private:
 	GLuint vertex_shader = 0;
 	GLuint fragment_shader = 0;
+	GLuint compute_shader = 0;
 	GLuint shader_program = 0;
-};
+
+	// Looked up once per name, uniforms are set every frame
+	std::map<std::string, GLint> uniform_locations;
+
+	GLint get_uniform_location(const std::string& name);
+};
\ No newline at end of file
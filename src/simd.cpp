@@ -0,0 +1,274 @@
+#include "std_include.hpp"
+
+#include "simd.hpp"
+#include "random.hpp"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define SIMD_X86 1
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#include <emmintrin.h>
+#endif
+
+namespace simd
+{
+#ifdef SIMD_X86
+	namespace
+	{
+		void cpuid(int result[4], int leaf, int subleaf = 0)
+		{
+#ifdef _MSC_VER
+			__cpuidex(result, leaf, subleaf);
+#else
+			unsigned int registers[4] = {};
+			__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+			std::memcpy(result, registers, sizeof(registers));
+#endif
+		}
+
+		unsigned long long xgetbv()
+		{
+#ifdef _MSC_VER
+			return _xgetbv(0);
+#else
+			unsigned int eax, edx;
+			__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+			return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+		}
+
+		bool supports_avx2()
+		{
+			int info[4];
+			cpuid(info, 0);
+			if (info[0] < 7) return false;
+
+			cpuid(info, 1);
+
+			const auto os_saves_avx = (info[2] & (1 << 27)) != 0;
+			const auto has_avx = (info[2] & (1 << 28)) != 0;
+
+			// The OS must preserve the YMM registers across context switches
+			if (!os_saves_avx || !has_avx || (xgetbv() & 6) != 6) return false;
+
+			cpuid(info, 7);
+			return (info[1] & (1 << 5)) != 0;
+		}
+
+		// SSE2 has no 32 bit low multiply, combine the even and odd lane products instead
+		__m128i multiply_low(__m128i a, __m128i b)
+		{
+			const auto even = _mm_mul_epu32(a, b);
+			const auto odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+			return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+		}
+	}
+#endif
+
+	instruction_set detect()
+	{
+#ifdef SIMD_X86
+		static const auto set = supports_avx2() ? instruction_set::avx2 : instruction_set::sse2;
+		return set;
+#else
+		return instruction_set::none;
+#endif
+	}
+
+	const char* get_name(instruction_set set)
+	{
+		switch (set)
+		{
+		case instruction_set::sse2: return "sse2";
+		case instruction_set::avx2: return "avx2";
+		default: return "scalar";
+		}
+	}
+
+#ifdef SIMD_X86
+	void convert_depth_sse2(const float* depth, int count, int pattern_div, int* shifts)
+	{
+		const auto one = _mm_set1_pd(1.0);
+		const auto scale = _mm_set1_pd(255.0);
+		const auto zero = _mm_setzero_pd();
+		const auto divisor = _mm_set1_ps(static_cast<float>(pattern_div));
+
+		int x = 0;
+		for (; x + 4 <= count; x += 4)
+		{
+			const auto values = _mm_loadu_ps(depth + x);
+
+			// Same double precision math as the scalar path, so truncation matches exactly
+			auto low = _mm_cvtps_pd(values);
+			auto high = _mm_cvtps_pd(_mm_movehl_ps(values, values));
+
+			low = _mm_min_pd(_mm_max_pd(_mm_mul_pd(_mm_sub_pd(one, low), scale), zero), scale);
+			high = _mm_min_pd(_mm_max_pd(_mm_mul_pd(_mm_sub_pd(one, high), scale), zero), scale);
+
+			const auto levels = _mm_unpacklo_epi64(_mm_cvttpd_epi32(low), _mm_cvttpd_epi32(high));
+
+			// Levels are small integers, so float division followed by truncation is exact
+			const auto shift = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(levels), divisor));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(shifts + x), shift);
+		}
+
+		for (; x < count; ++x)
+		{
+			const auto level = static_cast<int>(std::clamp((1.0 - depth[x]) * 255, 0.0, 255.0));
+			shifts[x] = level / pattern_div;
+		}
+	}
+
+	void convert_shifts_sse2(const unsigned char* values, int count, int max_shift, int* shifts)
+	{
+		const auto limit = _mm_set1_epi8(static_cast<char>(max_shift));
+		const auto zero = _mm_setzero_si128();
+
+		int x = 0;
+		for (; x + 16 <= count; x += 16)
+		{
+			const auto bytes = _mm_min_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + x)), limit);
+
+			const auto low = _mm_unpacklo_epi8(bytes, zero);
+			const auto high = _mm_unpackhi_epi8(bytes, zero);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(shifts + x), _mm_unpacklo_epi16(low, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(shifts + x + 4), _mm_unpackhi_epi16(low, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(shifts + x + 8), _mm_unpacklo_epi16(high, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(shifts + x + 12), _mm_unpackhi_epi16(high, zero));
+		}
+
+		for (; x < count; ++x)
+		{
+			shifts[x] = std::min<int>(values[x], max_shift);
+		}
+	}
+
+	void random_bytes_sse2(unsigned int stream_key, unsigned char* output, int count)
+	{
+		const auto first_multiplier = _mm_set1_epi32(0x7FEB352D);
+		const auto second_multiplier = _mm_set1_epi32(static_cast<int>(0x846CA68Bu));
+		const auto step = _mm_set1_epi32(4);
+
+		auto counters = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(stream_key)), _mm_setr_epi32(0, 1, 2, 3));
+
+		int i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			auto value = counters;
+			value = _mm_xor_si128(value, _mm_srli_epi32(value, 16));
+			value = multiply_low(value, first_multiplier);
+			value = _mm_xor_si128(value, _mm_srli_epi32(value, 15));
+			value = multiply_low(value, second_multiplier);
+			value = _mm_xor_si128(value, _mm_srli_epi32(value, 16));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), value);
+			counters = _mm_add_epi32(counters, step);
+		}
+
+		if (i < count)
+		{
+			random_generator::fill_bytes(stream_key, static_cast<unsigned int>(i / 4), output + i, count - i);
+		}
+	}
+
+	void rasterize_row_sse2(const raster_row& row, float* depth, int begin, int end)
+	{
+		const auto lanes = _mm_setr_epi32(0, 1, 2, 3);
+		const auto zero = _mm_setzero_ps();
+		const auto one = _mm_set1_ps(1.0f);
+
+		const auto edge0 = _mm_set1_ps(row.edges[0]), step0 = _mm_set1_ps(row.edge_steps[0]);
+		const auto edge1 = _mm_set1_ps(row.edges[1]), step1 = _mm_set1_ps(row.edge_steps[1]);
+		const auto edge2 = _mm_set1_ps(row.edges[2]), step2 = _mm_set1_ps(row.edge_steps[2]);
+		const auto depth0 = _mm_set1_ps(row.depth), depth_step = _mm_set1_ps(row.depth_step);
+
+		int x = begin;
+		for (; x + 4 <= end; x += 4)
+		{
+			const auto position = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x), lanes));
+
+			const auto w0 = _mm_add_ps(edge0, _mm_mul_ps(position, step0));
+			const auto w1 = _mm_add_ps(edge1, _mm_mul_ps(position, step1));
+			const auto w2 = _mm_add_ps(edge2, _mm_mul_ps(position, step2));
+			const auto z = _mm_add_ps(depth0, _mm_mul_ps(position, depth_step));
+
+			const auto current = _mm_loadu_ps(depth + x);
+
+			auto mask = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)), _mm_cmpge_ps(w2, zero));
+			mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(z, zero), _mm_cmple_ps(z, one)));
+			mask = _mm_and_ps(mask, _mm_cmplt_ps(z, current));
+
+			_mm_storeu_ps(depth + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, current)));
+		}
+
+		for (; x < end; ++x)
+		{
+			const auto position = static_cast<float>(x);
+
+			const auto w0 = row.edges[0] + position * row.edge_steps[0];
+			const auto w1 = row.edges[1] + position * row.edge_steps[1];
+			const auto w2 = row.edges[2] + position * row.edge_steps[2];
+			const auto z = row.depth + position * row.depth_step;
+
+			if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f && z >= 0.0f && z <= 1.0f && z < depth[x]) depth[x] = z;
+		}
+	}
+#else
+	void convert_depth_sse2(const float*, int, int, int*)
+	{
+		throw std::runtime_error("SSE2 is not available on this platform");
+	}
+
+	void convert_depth_avx2(const float*, int, int, int*)
+	{
+		throw std::runtime_error("AVX2 is not available on this platform");
+	}
+
+	void convert_shifts_sse2(const unsigned char*, int, int, int*)
+	{
+		throw std::runtime_error("SSE2 is not available on this platform");
+	}
+
+	void convert_shifts_avx2(const unsigned char*, int, int, int*)
+	{
+		throw std::runtime_error("AVX2 is not available on this platform");
+	}
+
+	int copy_pixels_avx2(unsigned char*, const int*, int, int, int)
+	{
+		throw std::runtime_error("AVX2 is not available on this platform");
+	}
+
+	int copy_pixels_bgra_avx2(unsigned char*, const int*, int, int, int)
+	{
+		throw std::runtime_error("AVX2 is not available on this platform");
+	}
+
+	void random_bytes_sse2(unsigned int, unsigned char*, int)
+	{
+		throw std::runtime_error("SSE2 is not available on this platform");
+	}
+
+	void random_bytes_avx2(unsigned int, unsigned char*, int)
+	{
+		throw std::runtime_error("AVX2 is not available on this platform");
+	}
+
+	void rasterize_row_sse2(const raster_row&, float*, int, int)
+	{
+		throw std::runtime_error("SSE2 is not available on this platform");
+	}
+
+	void rasterize_row_avx2(const raster_row&, float*, int, int)
+	{
+		throw std::runtime_error("AVX2 is not available on this platform");
+	}
+#endif
+}
\ No newline at end of file
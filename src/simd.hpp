@@ -0,0 +1,49 @@
+#pragma once
+
+namespace simd
+{
+	enum class instruction_set
+	{
+		none,
+		sse2,
+		avx2,
+	};
+
+	instruction_set detect();
+	const char* get_name(instruction_set set);
+
+	// Converts window-space depth into pattern shifts, bit exact with the scalar double precision conversion
+	void convert_depth_sse2(const float* depth, int count, int pattern_div, int* shifts);
+	void convert_depth_avx2(const float* depth, int count, int pattern_div, int* shifts);
+
+	// Widens precomputed 8 bit shifts, clamped to max_shift
+	void convert_shifts_sse2(const unsigned char* values, int count, int max_shift, int* shifts);
+	void convert_shifts_avx2(const unsigned char* values, int count, int max_shift, int* shifts);
+
+	// Synthesizes row[x] = row[x - pattern_width + shifts[x]] for 3 byte pixels, starting at begin.
+	// Requires every source to lie at least 8 pixels behind its target. Stops early near end to stay
+	// inside the row and returns the first pixel left to the caller.
+	int copy_pixels_avx2(unsigned char* row, const int* shifts, int begin, int end, int pattern_width);
+
+	// Same for 4 byte pixels, which are gathered and stored whole and need no headroom
+	int copy_pixels_bgra_avx2(unsigned char* row, const int* shifts, int begin, int end, int pattern_width);
+
+	// Same bytes as random_generator::fill_bytes starting at counter 0, never writes past count
+	void random_bytes_sse2(unsigned int stream_key, unsigned char* output, int count);
+	void random_bytes_avx2(unsigned int stream_key, unsigned char* output, int count);
+
+	// Edge functions and window depth of a triangle at the first pixel of a row span and their change per pixel.
+	// A pixel is covered when all three edges are >= 0 at it.
+	struct raster_row
+	{
+		float edges[3];
+		float edge_steps[3];
+		float depth;
+		float depth_step;
+	};
+
+	// Depth tests the covered pixels depth[begin, end) of the span and keeps the nearer values.
+	// Pixel i is evaluated as value + i * step, bit exact with the scalar loop in depth_rasterizer.
+	void rasterize_row_sse2(const raster_row& row, float* depth, int begin, int end);
+	void rasterize_row_avx2(const raster_row& row, float* depth, int begin, int end);
+}
\ No newline at end of file
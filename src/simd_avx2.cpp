@@ -0,0 +1,172 @@
+#include "std_include.hpp"
+
+#include "simd.hpp"
+#include "random.hpp"
+
+// Compiled with AVX2 code generation, only call into this file after simd::detect() reported AVX2
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+
+namespace simd
+{
+	void convert_depth_avx2(const float* depth, int count, int pattern_div, int* shifts)
+	{
+		const auto one = _mm256_set1_pd(1.0);
+		const auto scale = _mm256_set1_pd(255.0);
+		const auto zero = _mm256_setzero_pd();
+		const auto divisor = _mm256_set1_ps(static_cast<float>(pattern_div));
+
+		int x = 0;
+		for (; x + 8 <= count; x += 8)
+		{
+			auto low = _mm256_cvtps_pd(_mm_loadu_ps(depth + x));
+			auto high = _mm256_cvtps_pd(_mm_loadu_ps(depth + x + 4));
+
+			low = _mm256_min_pd(_mm256_max_pd(_mm256_mul_pd(_mm256_sub_pd(one, low), scale), zero), scale);
+			high = _mm256_min_pd(_mm256_max_pd(_mm256_mul_pd(_mm256_sub_pd(one, high), scale), zero), scale);
+
+			const auto levels = _mm256_set_m128i(_mm256_cvttpd_epi32(high), _mm256_cvttpd_epi32(low));
+
+			const auto shift = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(levels), divisor));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(shifts + x), shift);
+		}
+
+		if (x < count)
+		{
+			convert_depth_sse2(depth + x, count - x, pattern_div, shifts + x);
+		}
+	}
+
+	void convert_shifts_avx2(const unsigned char* values, int count, int max_shift, int* shifts)
+	{
+		const auto limit = _mm_set1_epi8(static_cast<char>(max_shift));
+
+		int x = 0;
+		for (; x + 16 <= count; x += 16)
+		{
+			const auto bytes = _mm_min_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + x)), limit);
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(shifts + x), _mm256_cvtepu8_epi32(bytes));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(shifts + x + 8), _mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+		}
+
+		if (x < count)
+		{
+			convert_shifts_sse2(values + x, count - x, max_shift, shifts + x);
+		}
+	}
+
+	int copy_pixels_avx2(unsigned char* row, const int* shifts, int begin, int end, int pattern_width)
+	{
+		// Packs the low 3 bytes of every gathered dword, 12 valid bytes per 128 bit lane
+		const auto pack = _mm256_setr_epi8(
+			0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+			0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+		const auto lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		const auto source_base = reinterpret_cast<const int*>(row);
+
+		int x = begin;
+
+		// Each block stores 4 bytes past its last pixel, keep 2 pixels of headroom to the row end
+		for (; x + 10 <= end; x += 8)
+		{
+			const auto shift = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(shifts + x));
+			const auto source = _mm256_add_epi32(_mm256_add_epi32(lanes, _mm256_set1_epi32(x - pattern_width)), shift);
+			const auto offsets = _mm256_add_epi32(_mm256_slli_epi32(source, 1), source);
+
+			const auto pixels = _mm256_shuffle_epi8(_mm256_i32gather_epi32(source_base, offsets, 1), pack);
+
+			auto target = row + x * 3;
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm256_castsi256_si128(pixels));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(target + 12), _mm256_extracti128_si256(pixels, 1));
+		}
+
+		return x;
+	}
+
+	int copy_pixels_bgra_avx2(unsigned char* row, const int* shifts, int begin, int end, int pattern_width)
+	{
+		const auto lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		const auto source_base = reinterpret_cast<const int*>(row);
+
+		int x = begin;
+
+		for (; x + 8 <= end; x += 8)
+		{
+			const auto shift = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(shifts + x));
+			const auto source = _mm256_add_epi32(_mm256_add_epi32(lanes, _mm256_set1_epi32(x - pattern_width)), shift);
+
+			const auto pixels = _mm256_i32gather_epi32(source_base, source, 4);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(row + x * 4), pixels);
+		}
+
+		return x;
+	}
+
+	void random_bytes_avx2(unsigned int stream_key, unsigned char* output, int count)
+	{
+		const auto first_multiplier = _mm256_set1_epi32(0x7FEB352D);
+		const auto second_multiplier = _mm256_set1_epi32(static_cast<int>(0x846CA68Bu));
+		const auto step = _mm256_set1_epi32(8);
+
+		auto counters = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(stream_key)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+		int i = 0;
+		for (; i + 32 <= count; i += 32)
+		{
+			auto value = counters;
+			value = _mm256_xor_si256(value, _mm256_srli_epi32(value, 16));
+			value = _mm256_mullo_epi32(value, first_multiplier);
+			value = _mm256_xor_si256(value, _mm256_srli_epi32(value, 15));
+			value = _mm256_mullo_epi32(value, second_multiplier);
+			value = _mm256_xor_si256(value, _mm256_srli_epi32(value, 16));
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), value);
+			counters = _mm256_add_epi32(counters, step);
+		}
+
+		if (i < count)
+		{
+			random_generator::fill_bytes(stream_key, static_cast<unsigned int>(i / 4), output + i, count - i);
+		}
+	}
+
+	void rasterize_row_avx2(const raster_row& row, float* depth, int begin, int end)
+	{
+		const auto lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		const auto zero = _mm256_setzero_ps();
+		const auto one = _mm256_set1_ps(1.0f);
+
+		const auto edge0 = _mm256_set1_ps(row.edges[0]), step0 = _mm256_set1_ps(row.edge_steps[0]);
+		const auto edge1 = _mm256_set1_ps(row.edges[1]), step1 = _mm256_set1_ps(row.edge_steps[1]);
+		const auto edge2 = _mm256_set1_ps(row.edges[2]), step2 = _mm256_set1_ps(row.edge_steps[2]);
+		const auto depth0 = _mm256_set1_ps(row.depth), depth_step = _mm256_set1_ps(row.depth_step);
+
+		int x = begin;
+		for (; x + 8 <= end; x += 8)
+		{
+			const auto position = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x), lanes));
+
+			// Separate multiply and add, a fused one would round differently than the other paths
+			const auto w0 = _mm256_add_ps(edge0, _mm256_mul_ps(position, step0));
+			const auto w1 = _mm256_add_ps(edge1, _mm256_mul_ps(position, step1));
+			const auto w2 = _mm256_add_ps(edge2, _mm256_mul_ps(position, step2));
+			const auto z = _mm256_add_ps(depth0, _mm256_mul_ps(position, depth_step));
+
+			const auto current = _mm256_loadu_ps(depth + x);
+
+			auto mask = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(w0, zero, _CMP_GE_OQ), _mm256_cmp_ps(w1, zero, _CMP_GE_OQ)), _mm256_cmp_ps(w2, zero, _CMP_GE_OQ));
+			mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(z, zero, _CMP_GE_OQ), _mm256_cmp_ps(z, one, _CMP_LE_OQ)));
+			mask = _mm256_and_ps(mask, _mm256_cmp_ps(z, current, _CMP_LT_OQ));
+
+			_mm256_storeu_ps(depth + x, _mm256_blendv_ps(current, z, mask));
+		}
+
+		if (x < end)
+		{
+			rasterize_row_sse2(row, depth, x, end);
+		}
+	}
+}
+#endif
\ No newline at end of file
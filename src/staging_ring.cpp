@@ -0,0 +1,134 @@
+#include "std_include.hpp"
+
+#include "staging_ring.hpp"
+#include "gl_state.hpp"
+
+staging_ring::staging_ring(size_t size, int segment_count)
+{
+	segment_count = std::max(2, segment_count);
+
+	this->segment_size = std::max(size_t(1), size / segment_count);
+	this->fences.resize(segment_count, nullptr);
+
+	if (!GLEW_ARB_buffer_storage) return;
+
+	const auto total_size = static_cast<GLsizeiptr>(this->segment_size * segment_count);
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	// Only uploads use the copy targets, their bindings are neither tracked nor restored
+	glGenBuffers(1, &this->staging_buffer);
+	glBindBuffer(GL_COPY_READ_BUFFER, this->staging_buffer);
+	glBufferStorage(GL_COPY_READ_BUFFER, total_size, nullptr, flags);
+
+	this->mapping = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, total_size, flags));
+
+	if (!this->mapping)
+	{
+		gl_state::delete_buffer(this->staging_buffer);
+		this->staging_buffer = 0;
+	}
+}
+
+staging_ring::~staging_ring()
+{
+	for (auto& fence : this->fences)
+	{
+		if (fence) glDeleteSync(fence);
+	}
+
+	// Deleting a mapped buffer unmaps it, copies still in flight finish regardless
+	gl_state::delete_buffer(this->staging_buffer);
+}
+
+bool staging_ring::is_persistent() const
+{
+	return this->mapping != nullptr;
+}
+
+GLuint staging_ring::create_buffer(GLenum target, size_t size) const
+{
+	GLuint buffer = 0;
+	glGenBuffers(1, &buffer);
+	gl_state::bind_buffer(target, buffer);
+
+	// Zero sized storage is invalid, empty meshes still get a buffer
+	const auto storage_size = static_cast<GLsizeiptr>(std::max(size, size_t(1)));
+
+	if (this->is_persistent())
+	{
+		glBufferStorage(target, storage_size, nullptr, 0);
+	}
+	else
+	{
+		glBufferData(target, storage_size, nullptr, GL_STATIC_DRAW);
+	}
+
+	return buffer;
+}
+
+void staging_ring::upload(GLuint buffer, size_t offset, const void* data, size_t size)
+{
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	if (this->is_persistent()) glBindBuffer(GL_COPY_READ_BUFFER, this->staging_buffer);
+
+	auto source = static_cast<const unsigned char*>(data);
+	this->stats.bytes += size;
+
+	while (size > 0)
+	{
+		if (this->segment_offset == this->segment_size)
+		{
+			this->next_segment();
+		}
+
+		const auto piece = std::min(size, this->segment_size - this->segment_offset);
+
+		if (this->is_persistent())
+		{
+			const auto staging_offset = static_cast<size_t>(this->segment) * this->segment_size + this->segment_offset;
+			std::memcpy(this->mapping + staging_offset, source, piece);
+
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(staging_offset), static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(piece));
+		}
+		else
+		{
+			glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(piece), source);
+		}
+
+		this->segment_offset += piece;
+		source += piece;
+		offset += piece;
+		size -= piece;
+	}
+}
+
+const staging_ring::statistics& staging_ring::get_statistics() const
+{
+	return this->stats;
+}
+
+void staging_ring::next_segment()
+{
+	this->segment_offset = 0;
+	if (!this->is_persistent()) return;
+
+	// Everything copied from the full segment so far has to finish before it is written again
+	auto& fence = this->fences[this->segment];
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	this->segment = (this->segment + 1) % static_cast<int>(this->fences.size());
+
+	auto& next = this->fences[this->segment];
+	if (!next) return;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	while (glClientWaitSync(next, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+	{
+	}
+
+	this->stats.stall_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+
+	glDeleteSync(next);
+	next = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+// Uploads buffer data through a fixed amount of persistently mapped staging memory, in pieces of at most a segment.
+// The driver never has to copy a whole array at once, however big the upload is. Without ARB_buffer_storage
+// the pieces are uploaded with glBufferSubData instead.
+class staging_ring
+{
+public:
+	struct statistics
+	{
+		unsigned long long bytes = 0;
+		unsigned long long stall_us = 0;
+	};
+
+	static constexpr size_t default_size = 32 * 1024 * 1024;
+
+	staging_ring(size_t size = default_size, int segment_count = 4);
+	~staging_ring();
+
+	staging_ring(const staging_ring&) = delete;
+	staging_ring& operator=(const staging_ring&) = delete;
+
+	bool is_persistent() const;
+
+	// Immutable storage if supported, only ever written by uploads. Binds the buffer to the target.
+	GLuint create_buffer(GLenum target, size_t size) const;
+
+	// Waits for the GPU only when the ring wraps around onto a segment it still copies from
+	void upload(GLuint buffer, size_t offset, const void* data, size_t size);
+
+	const statistics& get_statistics() const;
+
+private:
+	GLuint staging_buffer = 0;
+	unsigned char* mapping = nullptr;
+
+	size_t segment_size;
+	std::vector<GLsync> fences;
+
+	int segment = 0;
+	size_t segment_offset = 0;
+
+	statistics stats;
+
+	void next_segment();
+};
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "std_include.hpp"
+
+#include "status_display.hpp"
+
+status_display::status_display(window* _frame, std::string _title) : frame(_frame), title(std::move(_title))
+{
+
+}
+
+status_display::~status_display()
+{
+
+}
+
+void status_display::add(std::function<std::string()> provider)
+{
+	this->providers.push_back(std::move(provider));
+}
+
+const char* status_display::get_name() const
+{
+	return "status_display";
+}
+
+void status_display::paint()
+{
+	++this->frames;
+
+	const auto now = std::chrono::high_resolution_clock::now();
+	const auto elapsed = std::chrono::duration<double>(now - this->last_update).count();
+	if (elapsed < 1.0) return;
+
+	auto text = this->title + " | " + std::to_string(static_cast<int>(this->frames / elapsed + 0.5)) + " fps";
+
+	for (auto& provider : this->providers)
+	{
+		auto status = provider();
+		if (!status.empty()) text += " | " + status;
+	}
+
+	this->frame->set_title(text);
+
+	this->frames = 0;
+	this->last_update = now;
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "window.hpp"
+#include "paintable.hpp"
+
+class status_display : public paintable
+{
+public:
+	status_display(window* frame, std::string title);
+	~status_display() override;
+
+	// Providers are polled once per second, their text is appended to the window title
+	void add(std::function<std::string()> provider);
+
+	void paint() override;
+	const char* get_name() const override;
+
+private:
+	window* frame;
+	std::string title;
+
+	std::vector<std::function<std::string()>> providers;
+
+	int frames = 0;
+	std::chrono::high_resolution_clock::time_point last_update = std::chrono::high_resolution_clock::now();
+};
\ No newline at end of file
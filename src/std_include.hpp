@@ -15,13 +15,25 @@
 
 #pragma warning(push)
 #pragma warning(disable: 4244)
+#include <cmath>
+#include <cstring>
 #include <map>
 #include <list>
+#include <array>
 #include <string>
 #include <vector>
+#include <memory>
+#include <variant>
+#include <optional>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <chrono>
 #include <mutex>
 #include <thread>
 #include <fstream>
+#include <filesystem>
 #include <random>
 
 #include <gsl/gsl>
@@ -36,4 +48,4 @@
 #include <GLFW/glfw3.h>
 #pragma warning(pop)
 
-using namespace std::literals;
+using namespace std::literals;
\ No newline at end of file
@@ -1,12 +1,41 @@
 #include "std_include.hpp"
 
-#include "random.hpp"
 #include "stereogram.hpp"
 #include "context_saver.hpp"
+#include "gl_state.hpp"
 
-stereogram::stereogram()
+namespace
 {
-	static_assert(sizeof(stereogram::color) == 3);
+	// Window depth difference that counts as a software depth mismatch, a quarter of the levels the synthesizer distinguishes
+	constexpr float software_depth_tolerance = 0.25f / 255.0f;
+
+	bool is_depth_view_enabled()
+	{
+		return GetKeyState(VK_CAPITAL) & 0x0001; // Ugly, but for now it's ok
+	}
+
+	struct pixel_format
+	{
+		GLint internal_format;
+		GLenum format;
+		GLenum type;
+		int size;
+	};
+
+	pixel_format get_pixel_format(stereogram::color_format format)
+	{
+		if (format == stereogram::color_format::bgra)
+		{
+			return { GL_RGBA8, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, static_cast<int>(sizeof(synthesizer::color_bgra)) };
+		}
+
+		return { GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, static_cast<int>(sizeof(synthesizer::color)) };
+	}
+}
+
+stereogram::stereogram(thread_pool* _pool, int chunk_rows) : pool(_pool)
+{
+	this->engine.set_thread_pool(this->pool, chunk_rows);
 
 	static auto vertex_shader_source =
 		"void main(void)"
@@ -24,47 +53,238 @@ stereogram::stereogram()
 		"}";
 
 	this->shader_program = std::make_unique<shader>(vertex_shader_source, fragment_shader_source);
+	this->set_depth_reduction(true);
 }
 
 stereogram::~stereogram()
 {
+	// The worker may still use the synthesizer
+	this->pipeline.reset();
+}
 
+const char* stereogram::get_name() const
+{
+	return "stereogram";
 }
 
 void stereogram::paint()
 {
 	glFlush();
 
-	this->adjust_buffers();
-	this->fill_depth_buffer();
-	this->fill_color_buffer();
+	++this->frame_index;
+
+	{
+		profiler::scope _(this->frame_profiler, "stereogram/adjust");
+		this->adjust_buffers();
+	}
+
+	if (this->gpu)
+	{
+		profiler::scope _(this->frame_profiler, "stereogram/gpu_synthesis");
+		this->synthesize_on_gpu();
+	}
+	else
+	{
+		{
+			profiler::scope _(this->frame_profiler, "stereogram/depth");
+			this->fill_depth_buffer();
+			this->depth_time = std::chrono::high_resolution_clock::now();
+		}
+
+		if (this->pipeline)
+		{
+			this->synthesize_pipelined();
+		}
+		else
+		{
+			this->fill_color_buffer();
+		}
+	}
+
+	profiler::scope _(this->frame_profiler, "stereogram/present");
 	this->paint_color_buffer();
 }
 
+void stereogram::set_depth_reduction(bool enabled)
+{
+	if (enabled == (this->reduction != nullptr)) return;
+
+	if (enabled)
+	{
+		this->reduction = std::make_unique<depth_reduction>();
+	}
+	else
+	{
+		this->reduction.reset();
+	}
+
+	this->depth_data = nullptr;
+	this->engine.invalidate_rows();
+}
+
+void stereogram::set_readback_mode(pixel_readback::mode mode)
+{
+	this->readback.set_mode(mode);
+	this->depth_data = nullptr;
+	this->engine.invalidate_rows();
+}
+
+const pixel_readback::statistics& stereogram::get_readback_statistics() const
+{
+	return this->readback.get_statistics();
+}
+
+void stereogram::set_stable_pattern(bool enabled)
+{
+	this->stable_pattern = enabled;
+	this->update_upload_mode();
+	this->engine.invalidate_rows();
+}
+
+const stereogram::update_statistics& stereogram::get_update_statistics() const
+{
+	return this->update_stats;
+}
+
+void stereogram::set_color_format(color_format _format)
+{
+	if (_format == this->format) return;
+
+	this->format = _format;
+
+	if (this->pipeline) this->pipeline->reset();
+
+	// Recreated with the new format by the next frame
+	gl_state::delete_texture(this->texture);
+	this->texture = 0;
+
+	this->engine.invalidate_rows();
+}
+
+void stereogram::set_mapped_upload(bool enabled)
+{
+	this->mapped_upload = enabled;
+	this->update_upload_mode();
+	this->engine.invalidate_rows();
+}
+
+const pixel_upload::statistics& stereogram::get_upload_statistics() const
+{
+	return this->upload.get_statistics();
+}
+
+void stereogram::set_pipelined(bool enabled)
+{
+	if (enabled == (this->pipeline != nullptr)) return;
+
+	if (enabled)
+	{
+		this->pipeline = std::make_unique<synthesis_pipeline>(&this->engine);
+	}
+	else
+	{
+		this->pipeline.reset();
+	}
+
+	this->update_upload_mode();
+	this->engine.invalidate_rows();
+}
+
+const stereogram::present_statistics& stereogram::get_present_statistics() const
+{
+	return this->present_stats;
+}
+
+synthesis_pipeline::statistics stereogram::get_pipeline_statistics() const
+{
+	return this->pipeline ? this->pipeline->get_statistics() : synthesis_pipeline::statistics{};
+}
+
+void stereogram::set_gpu_synthesis(bool enabled)
+{
+	if (enabled == (this->gpu != nullptr)) return;
+
+	if (enabled)
+	{
+		this->gpu = std::make_unique<gpu_synthesizer>();
+	}
+	else
+	{
+		this->gpu.reset();
+	}
+
+	this->depth_data = nullptr;
+	this->engine.invalidate_rows();
+}
+
+void stereogram::set_gpu_verification(bool enabled)
+{
+	this->verify_gpu = enabled;
+	this->gpu_mismatches = -1;
+
+	if (enabled && !this->verification_reduction)
+	{
+		this->verification_reduction = std::make_unique<depth_reduction>();
+	}
+}
+
+long long stereogram::get_gpu_mismatches() const
+{
+	return this->gpu_mismatches;
+}
+
+void stereogram::set_software_depth(model* source)
+{
+	this->software_source = source;
+
+	if (source && !this->rasterizer)
+	{
+		this->rasterizer = std::make_unique<depth_rasterizer>(this->width, this->height);
+		this->rasterizer->set_thread_pool(this->pool);
+	}
+
+	this->depth_data = nullptr;
+	this->engine.invalidate_rows();
+}
+
+void stereogram::set_software_verification(bool enabled)
+{
+	this->verify_software = enabled;
+	this->software_mismatches = -1;
+}
+
+long long stereogram::get_software_mismatches() const
+{
+	return this->software_mismatches;
+}
+
+void stereogram::set_profiler(profiler* _frame_profiler)
+{
+	this->frame_profiler = _frame_profiler;
+}
+
 void stereogram::adjust_buffers()
 {
-	GLint viewport[4];
-	glGetIntegerv(GL_VIEWPORT, viewport);
+	const auto& viewport = gl_state::get_viewport();
 
 	int viewport_width = viewport[2] - viewport[0];
 	int viewport_height = viewport[3] - viewport[1];
 
-	if (!this->texture || !this->depth_buffer || !this->pattern || viewport_width != this->width || viewport_height != this->height)
+	if (!this->texture || viewport_width != this->width || viewport_height != this->height)
 	{
 		this->width = viewport_width;
 		this->height = viewport_height;
-		this->depth_buffer.reset(new float[this->width * this->height]);
-		this->color_buffer.reset(new stereogram::color[this->width * this->height]);
 
-		this->pattern_width = static_cast<int>((this->width * 1.0) / this->pattern_div);
-		this->pattern.reset(new stereogram::color[this->pattern_width * height]);
+		// Images of the old size are never presented
+		if (this->pipeline) this->pipeline->reset();
 
-		this->randomize_pattern();
+		this->engine.resize(this->width, this->height);
 		this->create_texture();
 	}
-	else
+	else if (!this->stable_pattern && !this->pipeline)
 	{
-		this->randomize_pattern();
+		// The pipeline's worker moves on to the next pattern itself
+		this->engine.randomize_pattern();
 	}
 }
 
@@ -72,10 +292,10 @@ void stereogram::create_texture()
 {
 	context_saver _;
 
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	gl_state::delete_texture(this->texture);
 
 	glGenTextures(1, &this->texture);
-	glBindTexture(GL_TEXTURE_2D, this->texture);
+	gl_state::bind_texture_2d(this->texture);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -83,94 +303,270 @@ void stereogram::create_texture()
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, this->width, this->height, 0, GL_RGB, GL_UNSIGNED_BYTE, this->color_buffer.get());
+	// Filled by the first synthesized frame
+	const auto pixels = get_pixel_format(this->format);
+	glTexImage2D(GL_TEXTURE_2D, 0, pixels.internal_format, this->width, this->height, 0, pixels.format, pixels.type, nullptr);
 }
 
 void stereogram::update_texture()
 {
-	GLint texture_2d;
-	glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture_2d);
-	glBindTexture(GL_TEXTURE_2D, this->texture);
+	this->update_texture(0, this->height);
+}
 
-	if (GetKeyState(VK_CAPITAL) & 0x0001) // Ugly, but for now it's ok
+void stereogram::update_texture(int begin, int end)
+{
+	const auto pixels = get_pixel_format(this->format);
+	this->upload.upload(this->texture, this->width, begin, end, pixels.format, pixels.type, pixels.size);
+}
+
+void stereogram::update_dirty_rows()
+{
+	// Uploads runs of consecutive dirty rows, one call per run
+	for (int y = 0; y < this->height;)
 	{
-		for (int y = 0; y < this->height; ++y)
+		if (!this->dirty_rows[y])
 		{
-			for (int x = 0; x < this->width; ++x)
-			{
-				unsigned char depth_value = static_cast<unsigned char>(this->get_depth_value(x, y));
-
-				color color;
-				color.r = depth_value;
-				color.g = depth_value;
-				color.b = depth_value;
-				this->set_color_value(x, y, color);
-			}
+			++y;
+			continue;
 		}
-	}
 
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, this->width, this->height, GL_RGB, GL_UNSIGNED_BYTE, this->color_buffer.get());
+		const auto begin = y;
+		while (y < this->height && this->dirty_rows[y]) ++y;
 
-	glBindTexture(GL_TEXTURE_2D, texture_2d);
+		this->update_texture(begin, y);
+	}
 }
 
-void stereogram::randomize_pattern()
+void stereogram::fill_depth_buffer()
 {
-	for (int i = 0; i < this->pattern_width * this->height; ++i)
+	if (this->software_source)
 	{
-		stereogram::color value;
+		this->rasterize_depth();
+	}
+	else if (this->reduction)
+	{
+		const auto depth_texture = this->depth.update(this->width, this->height);
+		this->depth_data = this->reduction->read_shifts(depth_texture, this->width, this->height, this->engine.get_pattern_div(), this->readback);
+	}
+	else
+	{
+		this->depth_data = this->readback.read(this->width, this->height, GL_DEPTH_COMPONENT, GL_FLOAT, sizeof(float));
+	}
+}
+
+void stereogram::fill_color_buffer()
+{
+	// Asynchronous readback has nothing to show until its ring is filled, keep the last image meanwhile
+	if (!this->depth_data) return;
+
+	const auto size = this->width * this->height;
+	const auto output = this->upload.map(static_cast<size_t>(size) * get_pixel_format(this->format).size);
+
+	const auto depth_view = is_depth_view_enabled();
 
-		for (int c = 0; c < 3; ++c)
+	const auto process = [&](auto depth, auto colors)
+	{
+		if (depth_view)
+		{
+			this->engine.visualize(depth, colors);
+			this->engine.invalidate_rows();
+		}
+		else if (this->stable_pattern)
 		{
-			(&value.r)[c] = static_cast<unsigned char>(random::fastrand());
+			this->update_stats.dirty_rows += this->engine.synthesize_changed(depth, colors, this->dirty_rows);
+			this->update_stats.rows += this->height;
 		}
+		else
+		{
+			this->engine.synthesize(depth, colors);
+		}
+	};
+
+	const auto process_depth = [&](auto colors)
+	{
+		if (this->reduction && !this->software_source)
+		{
+			process(gsl::span<const synthesizer::shift>(static_cast<const synthesizer::shift*>(this->depth_data), size), colors);
+		}
+		else
+		{
+			process(gsl::span<const float>(static_cast<const float*>(this->depth_data), size), colors);
+		}
+	};
+
+	{
+		profiler::scope _(this->frame_profiler, "stereogram/synthesis");
+
+		if (this->format == color_format::bgra)
+		{
+			process_depth(gsl::span<synthesizer::color_bgra>(static_cast<synthesizer::color_bgra*>(output), size));
+		}
+		else
+		{
+			process_depth(gsl::span<synthesizer::color>(static_cast<synthesizer::color*>(output), size));
+		}
+	}
 
-		pattern[i] = value;
+	profiler::scope _(this->frame_profiler, "stereogram/upload");
+
+	if (this->stable_pattern && !depth_view)
+	{
+		this->update_dirty_rows();
+	}
+	else
+	{
+		this->update_texture();
 	}
 
-	this->prepare_color_buffer();
+	this->upload.finish();
+	this->record_presentation(this->frame_index, this->depth_time);
 }
 
-void stereogram::fill_depth_buffer()
+void stereogram::synthesize_pipelined()
 {
-	if (this->depth_buffer)
+	if (this->depth_data)
+	{
+		profiler::scope _(this->frame_profiler, "stereogram/submit");
+
+		const auto size = this->width * this->height;
+
+		synthesis_pipeline::frame frame;
+		frame.bgra = this->format == color_format::bgra;
+		frame.depth_view = is_depth_view_enabled();
+		frame.randomize_pattern = !this->stable_pattern;
+		frame.index = this->frame_index;
+		frame.captured = this->depth_time;
+
+		if (this->reduction && !this->software_source)
+		{
+			frame.shifts = gsl::span<const synthesizer::shift>(static_cast<const synthesizer::shift*>(this->depth_data), size);
+		}
+		else
+		{
+			frame.depth = gsl::span<const float>(static_cast<const float*>(this->depth_data), size);
+		}
+
+		this->pipeline->submit(frame);
+	}
+
+	const auto image = this->pipeline->acquire();
+	if (!image) return;
+
+	// A failed upload must not keep the slot, every later submit would run out of them
+	auto release = gsl::finally([this]()
+	{
+		this->pipeline->release();
+	});
+
 	{
-		glReadPixels(0, 0, this->width, this->height, GL_DEPTH_COMPONENT, GL_FLOAT, this->depth_buffer.get());
+		profiler::scope _(this->frame_profiler, "stereogram/upload");
+
+		const auto pixels = get_pixel_format(this->format);
+		this->upload.upload(this->texture, image->colors.data(), this->width, 0, this->height, pixels.format, pixels.type, pixels.size);
+		this->upload.finish();
 	}
+
+	this->record_presentation(image->index, image->captured);
 }
 
-void stereogram::prepare_color_buffer()
+void stereogram::record_presentation(unsigned long long index, std::chrono::high_resolution_clock::time_point captured)
 {
-	const auto row_length = this->pattern_width * sizeof(stereogram::color);
+	const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - captured).count();
 
-	for (int y = 0; y < this->height; ++y)
-	{
-		auto color_offset = y * this->width;
-		auto pattern_offset = y * this->pattern_width;
+	this->present_stats.images++;
+	this->present_stats.latency_us += static_cast<unsigned long long>(latency);
+	this->present_stats.frames_behind += this->frame_index - index;
+}
+
+void stereogram::update_upload_mode()
+{
+	// Ring slots don't keep the previous image, which a stable pattern only partially rewrites.
+	// The pipeline's images are synthesized on the worker, into memory of its own.
+	const auto ring = this->mapped_upload && !this->stable_pattern && !this->pipeline;
+	this->upload.set_mode(ring ? pixel_upload::mode::mapped_ring : pixel_upload::mode::client_memory);
+}
 
-		std::memmove(this->color_buffer.get() + color_offset, this->pattern.get() + pattern_offset, row_length);
+void stereogram::rasterize_depth()
+{
+	this->rasterizer->resize(this->width, this->height);
+	this->rasterizer->clear();
+	this->software_source->rasterize(*this->rasterizer, gl_state::get_projection(), gl_state::get_modelview());
+
+	this->depth_data = this->rasterizer->get_depth().data();
+
+	if (this->verify_software)
+	{
+		this->verify_software_depth();
 	}
 }
 
-void stereogram::fill_color_buffer()
+void stereogram::verify_software_depth()
 {
-	for (int y = 0; y < this->height; ++y)
+	// Synchronous, the reference has to be the very same frame
+	pixel_readback reference_readback;
+
+	const auto size = this->width * this->height;
+	const auto reference = static_cast<const float*>(reference_readback.read(this->width, this->height, GL_DEPTH_COMPONENT, GL_FLOAT, sizeof(float)));
+	const auto depth = this->rasterizer->get_depth();
+
+	this->software_mismatches = 0;
+
+	for (int i = 0; i < size; ++i)
 	{
-		for (int x = this->pattern_width; x < this->width; ++x)
-		{
-			auto depth_value = this->get_depth_value(x, y);
+		if (std::abs(depth[i] - reference[i]) > software_depth_tolerance) ++this->software_mismatches;
+	}
+}
 
-			auto shift = depth_value / this->pattern_div;
-			auto x_translate = x - this->pattern_width + shift;
+void stereogram::synthesize_on_gpu()
+{
+	const auto depth_texture = this->depth.update(this->width, this->height);
 
-			while (x_translate < 0) x_translate += this->pattern_width;
+	if (is_depth_view_enabled())
+	{
+		this->gpu->visualize(depth_texture, this->engine);
+		return;
+	}
 
-			auto color = this->get_color_value(x_translate, y);
-			this->set_color_value(x, y, color);
-		}
+	this->gpu->synthesize(depth_texture, this->engine);
+
+	if (this->verify_gpu)
+	{
+		this->verify_gpu_output(depth_texture);
 	}
+}
+
+void stereogram::verify_gpu_output(GLuint depth_texture)
+{
+	// Synchronous, the reference has to be built from the very same frame
+	pixel_readback reference_readback;
+
+	const auto size = this->width * this->height;
+	const auto shifts = this->verification_reduction->read_shifts(depth_texture, this->width, this->height, this->engine.get_pattern_div(), reference_readback);
+
+	this->verification_colors.resize(size);
+	this->engine.synthesize(gsl::span<const synthesizer::shift>(shifts, size), this->verification_colors);
+
+	this->verification_buffer.resize(size);
+
+	const auto texture_2d = gl_state::get_texture_2d();
+	const auto alignment = gl_state::get_alignment(GL_PACK_ALIGNMENT);
+
+	gl_state::set_alignment(GL_PACK_ALIGNMENT, 1);
+	gl_state::bind_texture_2d(this->gpu->get_texture());
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_UNSIGNED_BYTE, this->verification_buffer.data());
+
+	gl_state::bind_texture_2d(texture_2d);
+	gl_state::set_alignment(GL_PACK_ALIGNMENT, alignment);
+
+	this->gpu_mismatches = 0;
+
+	for (int i = 0; i < size; ++i)
+	{
+		const auto& a = this->verification_colors[i];
+		const auto& b = this->verification_buffer[i];
 
-	this->update_texture();
+		if (a.r != b.r || a.g != b.g || a.b != b.b) ++this->gpu_mismatches;
+	}
 }
 
 void stereogram::paint_color_buffer()
@@ -179,21 +575,17 @@ void stereogram::paint_color_buffer()
 
 	//glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-	glOrtho(0.0, this->width * 1.0, 0.0, this->height * 1.0, -1.0, 1.0);
+	gl_state::load_matrix(GL_PROJECTION, glm::dmat4(1.0));
+	gl_state::load_matrix(GL_MODELVIEW, glm::ortho(0.0, this->width * 1.0, 0.0, this->height * 1.0, -1.0, 1.0));
 
 	this->shader_program->use();
 
-	glEnable(GL_TEXTURE_2D);
-	glDisable(GL_LIGHTING);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gl_state::set_enabled(GL_TEXTURE_2D, true);
+	gl_state::set_enabled(GL_LIGHTING, false);
+	gl_state::set_enabled(GL_BLEND, true);
+	gl_state::set_blend_function(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glColor4i(255, 255, 255, 255);
-	glBindTexture(GL_TEXTURE_2D, this->texture);
+	gl_state::bind_texture_2d(this->gpu ? this->gpu->get_texture() : this->texture);
 
 	glBegin(GL_QUADS);
 	int x = 0, y = 0;
@@ -202,24 +594,4 @@ void stereogram::paint_color_buffer()
 	glTexCoord2i(1, 1); glVertex3i((this->width + x), (this->height + y), 0);
 	glTexCoord2i(1, 0); glVertex3i((this->width + x), y, 0);
 	glEnd();
-
-	glEnable(GL_TEXTURE_2D);
-}
-
-unsigned int stereogram::get_depth_value(int x, int y)
-{
-	double val = this->depth_buffer[x + y * this->width];
-	val = 1.0 - val;
-	val *= 255;
-	return static_cast<unsigned int>(val);
-}
-
-stereogram::color stereogram::get_color_value(int x, int y)
-{
-	return this->color_buffer[x + y * this->width];
-}
-
-void stereogram::set_color_value(int x, int y, stereogram::color value)
-{
-	this->color_buffer[x + y * this->width] = value;
-}
+}
\ No newline at end of file
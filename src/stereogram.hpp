@@ -1,48 +1,151 @@
 #pragma once
 
+#include <model.hpp>
 #include <shader.hpp>
+#include <profiler.hpp>
+#include <pixel_upload.hpp>
 #include <paintable.hpp>
+#include <synthesizer.hpp>
+#include <depth_copy.hpp>
+#include <depth_reduction.hpp>
+#include <gpu_synthesizer.hpp>
+#include <synthesis_pipeline.hpp>
 
 class stereogram : public paintable
 {
 public:
-	stereogram();
-	~stereogram() override;
+	struct update_statistics
+	{
+		unsigned long long rows = 0;
+		unsigned long long dirty_rows = 0;
+	};
 
-	void paint() override;
+	// Images that reached the texture
+	struct present_statistics
+	{
+		unsigned long long images = 0;
 
-private:
-	struct color
+		// From reading the depth to uploading its image, and the frames painted in between, summed over all images
+		unsigned long long latency_us = 0;
+		unsigned long long frames_behind = 0;
+	};
+
+	enum class color_format
 	{
-		unsigned char r;
-		unsigned char g;
-		unsigned char b;
+		rgb, // Packed 3 byte pixels, uploaded with byte alignment
+		bgra, // 4 byte pixels in the order GPUs store them, uploaded without conversion
 	};
 
+	stereogram(thread_pool* pool = nullptr, int chunk_rows = 0);
+	~stereogram() override;
+
+	void paint() override;
+	const char* get_name() const override;
+
+	// Converts depth to pattern shifts on the GPU and reads back 8 bit shifts instead of float depth
+	void set_depth_reduction(bool enabled);
+
+	// Asynchronous readback trades one frame of latency for not waiting on the GPU
+	void set_readback_mode(pixel_readback::mode mode);
+	const pixel_readback::statistics& get_readback_statistics() const;
+
+	// Keeps the random pattern across frames and only re-synthesizes and uploads rows whose depth changed
+	void set_stable_pattern(bool enabled);
+	const update_statistics& get_update_statistics() const;
+
+	void set_color_format(color_format format);
+
+	// Synthesizes straight into a ring of mapped pixel unpack buffers, the driver copies them to the texture asynchronously.
+	// Ignored with a stable pattern, which needs the previous image.
+	void set_mapped_upload(bool enabled);
+	const pixel_upload::statistics& get_upload_statistics() const;
+
+	// Synthesizes on a worker thread while the next frames are rendered and presents the newest finished image,
+	// for at least a frame of latency. Ignored while synthesizing on the GPU. A stable pattern stays, but every row
+	// is synthesized again.
+	void set_pipelined(bool enabled);
+	const present_statistics& get_present_statistics() const;
+	synthesis_pipeline::statistics get_pipeline_statistics() const;
+
+	// Synthesizes with a compute shader, the image never leaves the GPU
+	void set_gpu_synthesis(bool enabled);
+
+	// Additionally runs the CPU path on every GPU frame and counts the pixels that differ
+	void set_gpu_verification(bool enabled);
+	long long get_gpu_mismatches() const;
+
+	// Rasterizes the source's depth on the CPU instead of reading back the GL depth buffer, nullptr reads it back again.
+	// Ignored while synthesizing on the GPU.
+	void set_software_depth(model* source);
+
+	// Additionally reads back the GL depth buffer and counts the pixels whose software depth differs by more than a tolerance
+	void set_software_verification(bool enabled);
+	long long get_software_mismatches() const;
+
+	// Times the depth, synthesis, upload and presentation stages separately, nullptr disables it
+	void set_profiler(profiler* frame_profiler);
+
+private:
 	int width = 0;
 	int height = 0;
 
-	int pattern_width = 0;
-	const int pattern_div = 12;
+	synthesizer engine;
+
+	depth_copy depth;
+	pixel_readback readback;
+	std::unique_ptr<depth_reduction> reduction;
+
+	std::unique_ptr<gpu_synthesizer> gpu;
+
+	bool verify_gpu = false;
+	long long gpu_mismatches = -1;
+	std::unique_ptr<depth_reduction> verification_reduction;
+	std::vector<synthesizer::color> verification_buffer;
+	std::vector<synthesizer::color> verification_colors;
 
-	std::unique_ptr<float[]> depth_buffer;
-	std::unique_ptr<color[]> color_buffer;
-	std::unique_ptr<color[]> pattern;
+	const void* depth_data = nullptr;
+
+	// Holds the synthesized image
+	pixel_upload upload;
+	color_format format = color_format::rgb;
+	bool mapped_upload = false;
+
+	std::unique_ptr<synthesis_pipeline> pipeline;
+
+	unsigned long long frame_index = 0;
+	std::chrono::high_resolution_clock::time_point depth_time;
+	present_statistics present_stats;
+
+	thread_pool* pool;
+	profiler* frame_profiler = nullptr;
+
+	model* software_source = nullptr;
+	std::unique_ptr<depth_rasterizer> rasterizer;
+
+	bool verify_software = false;
+	long long software_mismatches = -1;
+
+	bool stable_pattern = false;
+	std::vector<unsigned char> dirty_rows;
+	update_statistics update_stats;
 
 	GLuint texture = 0;
 	std::unique_ptr<shader> shader_program;
 
 	void adjust_buffers();
-	void randomize_pattern();
-	void prepare_color_buffer();
 	void fill_depth_buffer();
+	void rasterize_depth();
+	void verify_software_depth();
 	void fill_color_buffer();
+	void update_upload_mode();
+	void synthesize_pipelined();
+	void record_presentation(unsigned long long index, std::chrono::high_resolution_clock::time_point captured);
+	void synthesize_on_gpu();
+	void verify_gpu_output(GLuint depth_texture);
 	void paint_color_buffer();
 
 	void create_texture();
 	void update_texture();
-
-	unsigned int get_depth_value(int x, int y);
-	color get_color_value(int x, int y);
-	void set_color_value(int x, int y, color value);
-};
+	void update_texture(int begin, int end);
+	void update_dirty_rows();
+};
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "std_include.hpp"
+
+#include "synthesis_pipeline.hpp"
+
+synthesis_pipeline::synthesis_pipeline(synthesizer* _engine) : engine(_engine)
+{
+	this->thread = std::thread([this]()
+	{
+		this->run();
+	});
+}
+
+synthesis_pipeline::~synthesis_pipeline()
+{
+	{
+		std::lock_guard<std::mutex> _(this->mutex);
+		this->stopping = true;
+	}
+
+	this->changed.notify_all();
+
+	if (this->thread.joinable())
+	{
+		this->thread.join();
+	}
+}
+
+void synthesis_pipeline::submit(const frame& frame)
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	if (this->error)
+	{
+		std::rethrow_exception(std::exchange(this->error, nullptr));
+	}
+
+	auto target = this->find(state::queued);
+
+	if (target)
+	{
+		// The worker didn't get to it, the newer depth wins
+		++this->stats.dropped;
+	}
+	else
+	{
+		// One slot is synthesized and one holds the newest image at most, the third is always free here
+		target = this->find(state::empty);
+		if (!target) throw std::runtime_error("No free synthesis slot");
+	}
+
+	target->current = state::filling;
+	lock.unlock();
+
+	// Only the submitting thread touches a filling slot
+	const auto shifts = !frame.shifts.empty();
+	const auto data = shifts ? static_cast<const void*>(frame.shifts.data()) : static_cast<const void*>(frame.depth.data());
+	const auto size = shifts ? frame.shifts.size_bytes() : frame.depth.size_bytes();
+
+	target->depth.resize(static_cast<size_t>(size));
+	std::memcpy(target->depth.data(), data, static_cast<size_t>(size));
+
+	target->shifts = shifts;
+	target->depth_view = frame.depth_view;
+	target->randomize_pattern = frame.randomize_pattern;
+	target->result.bgra = frame.bgra;
+	target->result.index = frame.index;
+	target->result.captured = frame.captured;
+
+	lock.lock();
+	target->current = state::queued;
+	lock.unlock();
+
+	this->changed.notify_all();
+}
+
+const synthesis_pipeline::image* synthesis_pipeline::acquire()
+{
+	std::lock_guard<std::mutex> _(this->mutex);
+
+	auto source = this->find(state::ready);
+	if (!source) return nullptr;
+
+	source->current = state::presenting;
+	return &source->result;
+}
+
+void synthesis_pipeline::release()
+{
+	{
+		std::lock_guard<std::mutex> _(this->mutex);
+
+		auto source = this->find(state::presenting);
+		if (source) source->current = state::empty;
+	}
+
+	this->changed.notify_all();
+}
+
+void synthesis_pipeline::wait()
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->changed.wait(lock, [this]()
+	{
+		return !this->is_busy();
+	});
+}
+
+void synthesis_pipeline::reset()
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->changed.wait(lock, [this]()
+	{
+		return !this->is_busy();
+	});
+
+	for (auto& slot : this->slots)
+	{
+		slot.current = state::empty;
+	}
+}
+
+synthesis_pipeline::statistics synthesis_pipeline::get_statistics() const
+{
+	std::lock_guard<std::mutex> _(this->mutex);
+	return this->stats;
+}
+
+void synthesis_pipeline::run()
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	while (true)
+	{
+		this->changed.wait(lock, [this]()
+		{
+			return this->stopping || this->find(state::queued);
+		});
+
+		if (this->stopping) return;
+
+		auto& target = *this->find(state::queued);
+		target.current = state::synthesizing;
+		lock.unlock();
+
+		std::exception_ptr exception;
+
+		try
+		{
+			this->synthesize(target);
+		}
+		catch (...)
+		{
+			exception = std::current_exception();
+		}
+
+		lock.lock();
+
+		if (exception)
+		{
+			this->error = exception;
+			target.current = state::empty;
+		}
+		else
+		{
+			// An older image nobody acquired is never shown
+			auto older = this->find(state::ready);
+			if (older)
+			{
+				older->current = state::empty;
+				++this->stats.dropped;
+			}
+
+			target.current = state::ready;
+			++this->stats.synthesized;
+		}
+
+		this->changed.notify_all();
+	}
+}
+
+void synthesis_pipeline::synthesize(slot& target)
+{
+	if (target.randomize_pattern) this->engine->randomize_pattern();
+
+	const auto size = static_cast<size_t>(this->engine->get_width()) * this->engine->get_height();
+	const auto pixel_size = target.result.bgra ? sizeof(synthesizer::color_bgra) : sizeof(synthesizer::color);
+	target.result.colors.resize(size * pixel_size);
+
+	const auto process = [&](auto depth, auto colors)
+	{
+		if (target.depth_view)
+		{
+			this->engine->visualize(depth, colors);
+		}
+		else
+		{
+			this->engine->synthesize(depth, colors);
+		}
+	};
+
+	const auto process_depth = [&](auto colors)
+	{
+		if (target.shifts)
+		{
+			process(gsl::span<const synthesizer::shift>(reinterpret_cast<const synthesizer::shift*>(target.depth.data()), static_cast<std::ptrdiff_t>(size)), colors);
+		}
+		else
+		{
+			process(gsl::span<const float>(reinterpret_cast<const float*>(target.depth.data()), static_cast<std::ptrdiff_t>(size)), colors);
+		}
+	};
+
+	const auto colors = target.result.colors.data();
+
+	if (target.result.bgra)
+	{
+		process_depth(gsl::span<synthesizer::color_bgra>(reinterpret_cast<synthesizer::color_bgra*>(colors), static_cast<std::ptrdiff_t>(size)));
+	}
+	else
+	{
+		process_depth(gsl::span<synthesizer::color>(reinterpret_cast<synthesizer::color*>(colors), static_cast<std::ptrdiff_t>(size)));
+	}
+}
+
+synthesis_pipeline::slot* synthesis_pipeline::find(state state)
+{
+	for (auto& slot : this->slots)
+	{
+		if (slot.current == state) return &slot;
+	}
+
+	return nullptr;
+}
+
+bool synthesis_pipeline::is_busy()
+{
+	return this->find(state::filling) || this->find(state::queued) || this->find(state::synthesizing);
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "synthesizer.hpp"
+
+// Synthesizes stereograms on a worker thread, triple buffered: while the worker synthesizes one image, the newest
+// finished one is presented and the next depth is queued. Depth submitted faster than the worker synthesizes replaces
+// the queued depth, finished images replace older ones nobody acquired. Submit, acquire and release from one thread.
+class synthesis_pipeline
+{
+public:
+	struct frame
+	{
+		// One of both is set
+		gsl::span<const float> depth;
+		gsl::span<const synthesizer::shift> shifts;
+
+		bool bgra = false;
+		bool depth_view = false;
+		bool randomize_pattern = true;
+
+		unsigned long long index = 0;
+		std::chrono::high_resolution_clock::time_point captured;
+	};
+
+	struct image
+	{
+		// synthesizer::color or synthesizer::color_bgra pixels
+		std::vector<unsigned char> colors;
+		bool bgra = false;
+
+		unsigned long long index = 0;
+		std::chrono::high_resolution_clock::time_point captured;
+	};
+
+	struct statistics
+	{
+		unsigned long long synthesized = 0;
+		unsigned long long dropped = 0;
+	};
+
+	// The worker is the only one using the synthesizer while it is busy, see wait
+	synthesis_pipeline(synthesizer* engine);
+	~synthesis_pipeline();
+
+	synthesis_pipeline(const synthesis_pipeline&) = delete;
+	synthesis_pipeline& operator=(const synthesis_pipeline&) = delete;
+
+	// Copies the depth and returns right away. Errors of the worker are rethrown here.
+	void submit(const frame& frame);
+
+	// Newest finished image, nullptr if there is none since the last one. Valid until release.
+	const image* acquire();
+	void release();
+
+	// Waits until nothing is queued or synthesized, the synthesizer can be changed afterwards
+	void wait();
+
+	// Waits and drops every image, for example after the synthesizer was resized
+	void reset();
+
+	statistics get_statistics() const;
+
+private:
+	enum class state
+	{
+		empty,
+		filling,
+		queued,
+		synthesizing,
+		ready,
+		presenting,
+	};
+
+	struct slot
+	{
+		state current = state::empty;
+
+		std::vector<unsigned char> depth;
+		bool shifts = false;
+		bool depth_view = false;
+		bool randomize_pattern = true;
+
+		image result;
+	};
+
+	synthesizer* engine;
+
+	std::array<slot, 3> slots;
+
+	mutable std::mutex mutex;
+	std::condition_variable changed;
+	bool stopping = false;
+	std::exception_ptr error;
+
+	statistics stats;
+
+	std::thread thread;
+
+	void run();
+	void synthesize(slot& target);
+
+	slot* find(state state);
+	bool is_busy();
+};
\ No newline at end of file
@@ -0,0 +1,666 @@
+#include "std_include.hpp"
+
+#include "synthesizer.hpp"
+
+synthesizer::synthesizer(int _width, int _height, int _pattern_div) : pattern_div(_pattern_div), generator(static_cast<unsigned int>(time(nullptr)))
+{
+	static_assert(sizeof(synthesizer::color) == 3);
+	static_assert(sizeof(synthesizer::color_bgra) == 4);
+	static_assert(sizeof(synthesizer::shift) == 1);
+
+	if (this->pattern_div <= 0)
+	{
+		throw std::runtime_error("Invalid pattern divisor");
+	}
+
+	this->resize(_width, _height);
+}
+
+synthesizer::~synthesizer()
+{
+
+}
+
+void synthesizer::resize(int _width, int _height)
+{
+	if (_width < 0 || _height < 0)
+	{
+		throw std::runtime_error("Invalid stereogram dimensions");
+	}
+
+	if (_width == this->width && _height == this->height) return;
+
+	this->width = _width;
+	this->height = _height;
+
+	this->pattern_width = static_cast<int>((this->width * 1.0) / this->pattern_div);
+	this->row_hashes.resize(this->height);
+
+	this->randomize_pattern();
+}
+
+void synthesizer::randomize_pattern()
+{
+	this->pattern_seed = this->generator.get_stream_key(this->pattern_index++);
+	this->invalidate_rows();
+}
+
+void synthesizer::set_seed(unsigned int seed)
+{
+	this->generator = random_generator(seed);
+	this->pattern_index = 0;
+
+	this->randomize_pattern();
+}
+
+void synthesizer::select_pattern(unsigned int index)
+{
+	this->pattern_index = index;
+	this->randomize_pattern();
+}
+
+unsigned int synthesizer::get_seed() const
+{
+	return this->generator.get_seed();
+}
+
+unsigned int synthesizer::get_pattern_seed() const
+{
+	return this->pattern_seed;
+}
+
+void synthesizer::set_thread_pool(thread_pool* _pool, int _chunk_rows)
+{
+	this->pool = _pool;
+	this->chunk_rows = _chunk_rows;
+}
+
+void synthesizer::set_instruction_set(simd::instruction_set set)
+{
+	if (set > simd::detect())
+	{
+		throw std::runtime_error("Instruction set "s + simd::get_name(set) + " is not supported by this CPU");
+	}
+
+	this->instruction_set = set;
+}
+
+simd::instruction_set synthesizer::get_instruction_set() const
+{
+	return this->instruction_set;
+}
+
+void synthesizer::set_fused_rows(bool enabled)
+{
+	this->fused_rows = enabled;
+
+	if (enabled) this->frame_shifts = {};
+}
+
+bool synthesizer::get_fused_rows() const
+{
+	return this->fused_rows;
+}
+
+void synthesizer::synthesize(gsl::span<const float> depth, gsl::span<color> output)
+{
+	this->validate_buffers(depth.size(), output.size());
+	this->synthesize(depth.data(), output.data());
+}
+
+void synthesizer::synthesize(gsl::span<const unsigned char> depth, gsl::span<color> output)
+{
+	this->validate_buffers(depth.size(), output.size());
+	this->synthesize(depth.data(), output.data());
+}
+
+void synthesizer::synthesize(gsl::span<const unsigned short> depth, gsl::span<color> output)
+{
+	this->validate_buffers(depth.size(), output.size());
+	this->synthesize(depth.data(), output.data());
+}
+
+void synthesizer::synthesize(gsl::span<const shift> shifts, gsl::span<color> output)
+{
+	this->validate_buffers(shifts.size(), output.size());
+	this->synthesize(shifts.data(), output.data());
+}
+
+void synthesizer::synthesize(gsl::span<const float> depth, gsl::span<color_bgra> output)
+{
+	this->validate_buffers(depth.size(), output.size());
+	this->synthesize(depth.data(), output.data());
+}
+
+void synthesizer::synthesize(gsl::span<const unsigned char> depth, gsl::span<color_bgra> output)
+{
+	this->validate_buffers(depth.size(), output.size());
+	this->synthesize(depth.data(), output.data());
+}
+
+void synthesizer::synthesize(gsl::span<const unsigned short> depth, gsl::span<color_bgra> output)
+{
+	this->validate_buffers(depth.size(), output.size());
+	this->synthesize(depth.data(), output.data());
+}
+
+void synthesizer::synthesize(gsl::span<const shift> shifts, gsl::span<color_bgra> output)
+{
+	this->validate_buffers(shifts.size(), output.size());
+	this->synthesize(shifts.data(), output.data());
+}
+
+int synthesizer::synthesize_changed(gsl::span<const float> depth, gsl::span<color> output, std::vector<unsigned char>& dirty_rows)
+{
+	this->validate_buffers(depth.size(), output.size());
+	return this->synthesize_changed(depth.data(), output.data(), dirty_rows);
+}
+
+int synthesizer::synthesize_changed(gsl::span<const unsigned char> depth, gsl::span<color> output, std::vector<unsigned char>& dirty_rows)
+{
+	this->validate_buffers(depth.size(), output.size());
+	return this->synthesize_changed(depth.data(), output.data(), dirty_rows);
+}
+
+int synthesizer::synthesize_changed(gsl::span<const unsigned short> depth, gsl::span<color> output, std::vector<unsigned char>& dirty_rows)
+{
+	this->validate_buffers(depth.size(), output.size());
+	return this->synthesize_changed(depth.data(), output.data(), dirty_rows);
+}
+
+int synthesizer::synthesize_changed(gsl::span<const shift> shifts, gsl::span<color> output, std::vector<unsigned char>& dirty_rows)
+{
+	this->validate_buffers(shifts.size(), output.size());
+	return this->synthesize_changed(shifts.data(), output.data(), dirty_rows);
+}
+
+int synthesizer::synthesize_changed(gsl::span<const float> depth, gsl::span<color_bgra> output, std::vector<unsigned char>& dirty_rows)
+{
+	this->validate_buffers(depth.size(), output.size());
+	return this->synthesize_changed(depth.data(), output.data(), dirty_rows);
+}
+
+int synthesizer::synthesize_changed(gsl::span<const unsigned char> depth, gsl::span<color_bgra> output, std::vector<unsigned char>& dirty_rows)
+{
+	this->validate_buffers(depth.size(), output.size());
+	return this->synthesize_changed(depth.data(), output.data(), dirty_rows);
+}
+
+int synthesizer::synthesize_changed(gsl::span<const unsigned short> depth, gsl::span<color_bgra> output, std::vector<unsigned char>& dirty_rows)
+{
+	this->validate_buffers(depth.size(), output.size());
+	return this->synthesize_changed(depth.data(), output.data(), dirty_rows);
+}
+
+int synthesizer::synthesize_changed(gsl::span<const shift> shifts, gsl::span<color_bgra> output, std::vector<unsigned char>& dirty_rows)
+{
+	this->validate_buffers(shifts.size(), output.size());
+	return this->synthesize_changed(shifts.data(), output.data(), dirty_rows);
+}
+
+void synthesizer::invalidate_rows()
+{
+	this->row_hashes_valid = false;
+}
+
+void synthesizer::visualize(gsl::span<const float> depth, gsl::span<color> output)
+{
+	this->validate_buffers(depth.size(), output.size());
+	this->visualize(depth.data(), output.data());
+}
+
+void synthesizer::visualize(gsl::span<const unsigned char> depth, gsl::span<color> output)
+{
+	this->validate_buffers(depth.size(), output.size());
+	this->visualize(depth.data(), output.data());
+}
+
+void synthesizer::visualize(gsl::span<const unsigned short> depth, gsl::span<color> output)
+{
+	this->validate_buffers(depth.size(), output.size());
+	this->visualize(depth.data(), output.data());
+}
+
+void synthesizer::visualize(gsl::span<const shift> shifts, gsl::span<color> output)
+{
+	this->validate_buffers(shifts.size(), output.size());
+	this->visualize(shifts.data(), output.data());
+}
+
+void synthesizer::visualize(gsl::span<const float> depth, gsl::span<color_bgra> output)
+{
+	this->validate_buffers(depth.size(), output.size());
+	this->visualize(depth.data(), output.data());
+}
+
+void synthesizer::visualize(gsl::span<const unsigned char> depth, gsl::span<color_bgra> output)
+{
+	this->validate_buffers(depth.size(), output.size());
+	this->visualize(depth.data(), output.data());
+}
+
+void synthesizer::visualize(gsl::span<const unsigned short> depth, gsl::span<color_bgra> output)
+{
+	this->validate_buffers(depth.size(), output.size());
+	this->visualize(depth.data(), output.data());
+}
+
+void synthesizer::visualize(gsl::span<const shift> shifts, gsl::span<color_bgra> output)
+{
+	this->validate_buffers(shifts.size(), output.size());
+	this->visualize(shifts.data(), output.data());
+}
+
+int synthesizer::get_width() const
+{
+	return this->width;
+}
+
+int synthesizer::get_height() const
+{
+	return this->height;
+}
+
+int synthesizer::get_pattern_width() const
+{
+	return this->pattern_width;
+}
+
+int synthesizer::get_pattern_div() const
+{
+	return this->pattern_div;
+}
+
+void synthesizer::for_each_rows(const std::function<void(int, int)>& callback)
+{
+	if (this->pool)
+	{
+		this->pool->parallel_for(this->height, this->chunk_rows, callback);
+	}
+	else
+	{
+		callback(0, this->height);
+	}
+}
+
+void synthesizer::validate_buffers(std::ptrdiff_t depth_size, std::ptrdiff_t output_size) const
+{
+	const auto size = static_cast<std::ptrdiff_t>(this->width) * this->height;
+
+	if (depth_size < size || output_size < size)
+	{
+		throw std::runtime_error("Buffer too small for stereogram dimensions");
+	}
+}
+
+void synthesizer::fill_pattern(color* row, int y) const
+{
+	const auto key = random_generator(this->pattern_seed).get_stream_key(static_cast<unsigned int>(y));
+	const auto bytes = static_cast<int>(this->pattern_width * sizeof(synthesizer::color));
+
+	switch (this->instruction_set)
+	{
+	case simd::instruction_set::avx2:
+		simd::random_bytes_avx2(key, &row->r, bytes);
+		break;
+	case simd::instruction_set::sse2:
+		simd::random_bytes_sse2(key, &row->r, bytes);
+		break;
+	default:
+		random_generator::fill_bytes(key, 0, &row->r, bytes);
+		break;
+	}
+}
+
+void synthesizer::fill_pattern(color_bgra* row, int y) const
+{
+	// Same colors as the 3 byte pattern, generated into the front of the row and spread out back to front
+	auto bytes = &row->b;
+	this->fill_pattern(reinterpret_cast<color*>(bytes), y);
+
+	for (int x = this->pattern_width - 1; x >= 0; --x)
+	{
+		const auto r = bytes[x * 3];
+		const auto g = bytes[x * 3 + 1];
+		const auto b = bytes[x * 3 + 2];
+
+		row[x] = { b, g, r, 255 };
+	}
+}
+
+template <typename P>
+void synthesizer::prepare_color_buffer(P* output, int begin, int end) const
+{
+	// The pattern is generated straight into the rows, there is no pattern buffer to copy from
+	for (int y = begin; y < end; ++y)
+	{
+		this->fill_pattern(output + y * this->width, y);
+	}
+}
+
+template <typename T, typename P>
+void synthesizer::synthesize(const T* depth, P* output)
+{
+	if (this->pattern_width <= 0)
+	{
+		// Too narrow to hold a single pattern pixel, black
+		std::fill(output, output + static_cast<size_t>(this->width) * this->height, P{});
+		return;
+	}
+
+	if (!this->fused_rows)
+	{
+		this->synthesize_passes(depth, output);
+		return;
+	}
+
+	// Rows are independent, each one is generated, converted and synthesized while it is still in cache
+	this->for_each_rows([&](int begin, int end)
+	{
+		for (int y = begin; y < end; ++y)
+		{
+			this->prepare_color_buffer(output, y, y + 1);
+			this->fill_color_buffer(depth, output, y, y + 1);
+		}
+	});
+}
+
+template <typename T, typename P>
+void synthesizer::synthesize_passes(const T* depth, P* output)
+{
+	this->for_each_rows([&](int begin, int end)
+	{
+		this->prepare_color_buffer(output, begin, end);
+	});
+
+	if (this->instruction_set == simd::instruction_set::none)
+	{
+		this->for_each_rows([&](int begin, int end)
+		{
+			this->fill_color_buffer_scalar(depth, output, begin, end);
+		});
+
+		return;
+	}
+
+	// Shifts of the whole frame, written and read back once more
+	this->frame_shifts.resize(static_cast<size_t>(this->width) * this->height);
+
+	this->for_each_rows([&](int begin, int end)
+	{
+		const auto offset = this->pattern_width;
+
+		for (int y = begin; y < end; ++y)
+		{
+			const auto row = static_cast<size_t>(y) * this->width;
+			this->convert_depth_row(depth + row + offset, this->frame_shifts.data() + row + offset, this->width - offset);
+		}
+	});
+
+	this->for_each_rows([&](int begin, int end)
+	{
+		for (int y = begin; y < end; ++y)
+		{
+			const auto row = static_cast<size_t>(y) * this->width;
+			this->copy_pixels(output + row, this->frame_shifts.data() + row);
+		}
+	});
+}
+
+template <typename T, typename P>
+int synthesizer::synthesize_changed(const T* depth, P* output, std::vector<unsigned char>& dirty_rows)
+{
+	dirty_rows.assign(this->height, 1);
+
+	if (this->pattern_width <= 0 || !this->row_hashes_valid)
+	{
+		// Nothing to compare against, synthesize everything and remember the rows
+		this->for_each_rows([&](int begin, int end)
+		{
+			for (int y = begin; y < end; ++y)
+			{
+				this->row_hashes[y] = synthesizer::hash_row(depth + y * this->width, this->width * sizeof(T));
+			}
+		});
+
+		this->synthesize(depth, output);
+		this->row_hashes_valid = true;
+
+		return this->height;
+	}
+
+	std::atomic<int> dirty_count = 0;
+
+	this->for_each_rows([&](int begin, int end)
+	{
+		int count = 0;
+
+		for (int y = begin; y < end; ++y)
+		{
+			const auto hash = synthesizer::hash_row(depth + y * this->width, this->width * sizeof(T));
+
+			if (hash == this->row_hashes[y])
+			{
+				dirty_rows[y] = 0;
+				continue;
+			}
+
+			this->row_hashes[y] = hash;
+			this->prepare_color_buffer(output, y, y + 1);
+			this->fill_color_buffer(depth, output, y, y + 1);
+			++count;
+		}
+
+		dirty_count += count;
+	});
+
+	return dirty_count;
+}
+
+template <typename T, typename P>
+void synthesizer::visualize(const T* depth, P* output)
+{
+	this->for_each_rows([&](int begin, int end)
+	{
+		this->fill_depth_view(depth, output, begin, end);
+	});
+}
+
+template <typename T, typename P>
+void synthesizer::fill_color_buffer(const T* depth, P* output, int begin, int end) const
+{
+	if (this->instruction_set == simd::instruction_set::none)
+	{
+		this->fill_color_buffer_scalar(depth, output, begin, end);
+		return;
+	}
+
+	thread_local std::vector<int> shifts;
+	shifts.resize(this->width);
+
+	for (int y = begin; y < end; ++y)
+	{
+		// Pattern pixels are never shifted, only convert what gets synthesized
+		const auto offset = this->pattern_width;
+		this->convert_depth_row(depth + y * this->width + offset, shifts.data() + offset, this->width - offset);
+		this->copy_pixels(output + y * this->width, shifts.data());
+	}
+}
+
+// Reference implementation, the vectorized path must produce the exact same output
+template <typename T, typename P>
+void synthesizer::fill_color_buffer_scalar(const T* depth, P* output, int begin, int end) const
+{
+	for (int y = begin; y < end; ++y)
+	{
+		auto depth_row = depth + y * this->width;
+		auto color_row = output + y * this->width;
+
+		for (int x = this->pattern_width; x < this->width; ++x)
+		{
+			auto depth_value = this->get_level(depth_row[x]);
+
+			auto shift = static_cast<int>(depth_value) / this->pattern_div;
+			auto x_translate = x - this->pattern_width + shift;
+
+			while (x_translate < 0) x_translate += this->pattern_width;
+
+			// Narrow images can shift further than the pattern is wide, never read pixels not synthesized yet
+			x_translate = std::min(x_translate, x - 1);
+
+			color_row[x] = color_row[x_translate];
+		}
+	}
+}
+
+void synthesizer::convert_depth_row(const float* depth, int* shifts, int count) const
+{
+	if (this->instruction_set == simd::instruction_set::avx2)
+	{
+		simd::convert_depth_avx2(depth, count, this->pattern_div, shifts);
+	}
+	else
+	{
+		simd::convert_depth_sse2(depth, count, this->pattern_div, shifts);
+	}
+}
+
+void synthesizer::convert_depth_row(const unsigned char* depth, int* shifts, int count) const
+{
+	for (int x = 0; x < count; ++x)
+	{
+		shifts[x] = static_cast<int>(synthesizer::get_depth_value(depth[x])) / this->pattern_div;
+	}
+}
+
+void synthesizer::convert_depth_row(const unsigned short* depth, int* shifts, int count) const
+{
+	for (int x = 0; x < count; ++x)
+	{
+		shifts[x] = static_cast<int>(synthesizer::get_depth_value(depth[x])) / this->pattern_div;
+	}
+}
+
+void synthesizer::convert_depth_row(const shift* depth, int* shifts, int count) const
+{
+	// Clamping alone gives the same shift as get_level divided by pattern_div, without a division per pixel
+	const auto values = reinterpret_cast<const unsigned char*>(depth);
+	const auto max_shift = 255 / this->pattern_div;
+
+	if (this->instruction_set == simd::instruction_set::avx2)
+	{
+		simd::convert_shifts_avx2(values, count, max_shift, shifts);
+	}
+	else
+	{
+		simd::convert_shifts_sse2(values, count, max_shift, shifts);
+	}
+}
+
+void synthesizer::copy_pixels(color* row, const int* shifts) const
+{
+	int x = this->pattern_width;
+
+	// The gather reads whole blocks at once, which is only valid when no source lies within the block
+	const auto max_shift = 255 / this->pattern_div;
+	if (this->instruction_set == simd::instruction_set::avx2 && this->pattern_width - max_shift >= 8)
+	{
+		x = simd::copy_pixels_avx2(&row->r, shifts, x, this->width, this->pattern_width);
+	}
+
+	for (; x < this->width; ++x)
+	{
+		row[x] = row[std::min(x - this->pattern_width + shifts[x], x - 1)];
+	}
+}
+
+void synthesizer::copy_pixels(color_bgra* row, const int* shifts) const
+{
+	int x = this->pattern_width;
+
+	const auto max_shift = 255 / this->pattern_div;
+	if (this->instruction_set == simd::instruction_set::avx2 && this->pattern_width - max_shift >= 8)
+	{
+		x = simd::copy_pixels_bgra_avx2(&row->b, shifts, x, this->width, this->pattern_width);
+	}
+
+	for (; x < this->width; ++x)
+	{
+		row[x] = row[std::min(x - this->pattern_width + shifts[x], x - 1)];
+	}
+}
+
+template <typename T>
+void synthesizer::fill_depth_view(const T* depth, color* output, int begin, int end) const
+{
+	for (int i = begin * this->width; i < end * this->width; ++i)
+	{
+		auto depth_value = static_cast<unsigned char>(this->get_level(depth[i]));
+		output[i] = { depth_value, depth_value, depth_value };
+	}
+}
+
+template <typename T>
+void synthesizer::fill_depth_view(const T* depth, color_bgra* output, int begin, int end) const
+{
+	for (int i = begin * this->width; i < end * this->width; ++i)
+	{
+		auto depth_value = static_cast<unsigned char>(this->get_level(depth[i]));
+		output[i] = { depth_value, depth_value, depth_value, 255 };
+	}
+}
+
+template <typename T>
+unsigned int synthesizer::get_level(T value) const
+{
+	return synthesizer::get_depth_value(value);
+}
+
+unsigned int synthesizer::get_level(shift value) const
+{
+	// Clamped like converted depth, which keeps every shift within the limits the kernels rely on
+	const auto max_shift = 255u / this->pattern_div;
+	return std::min<unsigned int>(value.value, max_shift) * this->pattern_div;
+}
+
+unsigned long long synthesizer::hash_row(const void* data, size_t size)
+{
+	// Word-wise multiply and fold, a collision only costs a single stale row
+	const auto bytes = static_cast<const unsigned char*>(data);
+	unsigned long long hash = 0xCBF29CE484222325ull ^ size;
+
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		unsigned long long word;
+		std::memcpy(&word, bytes + i, sizeof(word));
+
+		hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+		hash ^= hash >> 32;
+	}
+
+	for (; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * 0x9E3779B97F4A7C15ull;
+	}
+
+	return hash ^ (hash >> 29);
+}
+
+unsigned int synthesizer::get_depth_value(float value)
+{
+	double val = value;
+	val = 1.0 - val;
+	val *= 255;
+	return static_cast<unsigned int>(std::clamp(val, 0.0, 255.0));
+}
+
+unsigned int synthesizer::get_depth_value(unsigned char value)
+{
+	return value;
+}
+
+unsigned int synthesizer::get_depth_value(unsigned short value)
+{
+	return value >> 8;
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "simd.hpp"
+#include "random.hpp"
+#include "thread_pool.hpp"
+
+class synthesizer
+{
+public:
+	struct color
+	{
+		unsigned char r;
+		unsigned char g;
+		unsigned char b;
+	};
+
+	// 4 byte pixel in GL_BGRA order, uploads without a conversion in the driver. Alpha is always 255.
+	struct color_bgra
+	{
+		unsigned char b;
+		unsigned char g;
+		unsigned char r;
+		unsigned char a = 255;
+	};
+
+	// Precomputed pattern shift of a pixel, as produced by the GPU depth reduction
+	struct shift
+	{
+		unsigned char value;
+	};
+
+	synthesizer(int width = 0, int height = 0, int pattern_div = 12);
+	~synthesizer();
+
+	void resize(int width, int height);
+
+	// Moves on to the next pattern of the seed's sequence. Patterns are generated while synthesizing,
+	// the sequence only depends on the seed, never on threads or instruction sets.
+	void randomize_pattern();
+
+	// Restarts the pattern sequence, synthesizers default to a time based seed
+	void set_seed(unsigned int seed);
+
+	// Jumps to a pattern of the seed's sequence, set_seed selects index 0 and every randomize_pattern the next one.
+	// Frames synthesized out of order or on different synthesizers get the same patterns this way.
+	void select_pattern(unsigned int index);
+	unsigned int get_seed() const;
+
+	// Seed of the current pattern, row y starts at random_generator(pattern_seed).get_stream_key(y)
+	unsigned int get_pattern_seed() const;
+
+	// Rows are distributed over the pool in chunks of chunk_rows, no pool means single threaded
+	void set_thread_pool(thread_pool* pool, int chunk_rows = 0);
+
+	// Defaults to the best supported set, simd::instruction_set::none selects the scalar reference
+	void set_instruction_set(simd::instruction_set set);
+	simd::instruction_set get_instruction_set() const;
+
+	// Enabled by default. Disabling it runs the pattern, depth conversion and synthesis as separate passes over the
+	// whole frame, with a full frame of shifts in between. Same output, only useful to measure the memory traffic fusing saves.
+	void set_fused_rows(bool enabled);
+	bool get_fused_rows() const;
+
+	// Float samples are window-space depth like glReadPixels returns it (0 = near, 1 = far).
+	// Integer samples are depth maps as usually stored in images (white = near).
+	void synthesize(gsl::span<const float> depth, gsl::span<color> output);
+	void synthesize(gsl::span<const unsigned char> depth, gsl::span<color> output);
+	void synthesize(gsl::span<const unsigned short> depth, gsl::span<color> output);
+	void synthesize(gsl::span<const shift> shifts, gsl::span<color> output);
+
+	// Same image in 4 byte pixels
+	void synthesize(gsl::span<const float> depth, gsl::span<color_bgra> output);
+	void synthesize(gsl::span<const unsigned char> depth, gsl::span<color_bgra> output);
+	void synthesize(gsl::span<const unsigned short> depth, gsl::span<color_bgra> output);
+	void synthesize(gsl::span<const shift> shifts, gsl::span<color_bgra> output);
+
+	// Only rewrites rows whose depth differs from the previous call, the pattern has to stay the same meanwhile.
+	// Other rows keep their content, so output must be the same buffer every time. Rewritten rows are flagged
+	// in dirty_rows, the return value is their number.
+	int synthesize_changed(gsl::span<const float> depth, gsl::span<color> output, std::vector<unsigned char>& dirty_rows);
+	int synthesize_changed(gsl::span<const unsigned char> depth, gsl::span<color> output, std::vector<unsigned char>& dirty_rows);
+	int synthesize_changed(gsl::span<const unsigned short> depth, gsl::span<color> output, std::vector<unsigned char>& dirty_rows);
+	int synthesize_changed(gsl::span<const shift> shifts, gsl::span<color> output, std::vector<unsigned char>& dirty_rows);
+	int synthesize_changed(gsl::span<const float> depth, gsl::span<color_bgra> output, std::vector<unsigned char>& dirty_rows);
+	int synthesize_changed(gsl::span<const unsigned char> depth, gsl::span<color_bgra> output, std::vector<unsigned char>& dirty_rows);
+	int synthesize_changed(gsl::span<const unsigned short> depth, gsl::span<color_bgra> output, std::vector<unsigned char>& dirty_rows);
+	int synthesize_changed(gsl::span<const shift> shifts, gsl::span<color_bgra> output, std::vector<unsigned char>& dirty_rows);
+
+	// Forces the next synthesize_changed to rewrite every row
+	void invalidate_rows();
+
+	void visualize(gsl::span<const float> depth, gsl::span<color> output);
+	void visualize(gsl::span<const unsigned char> depth, gsl::span<color> output);
+	void visualize(gsl::span<const unsigned short> depth, gsl::span<color> output);
+	void visualize(gsl::span<const shift> shifts, gsl::span<color> output);
+	void visualize(gsl::span<const float> depth, gsl::span<color_bgra> output);
+	void visualize(gsl::span<const unsigned char> depth, gsl::span<color_bgra> output);
+	void visualize(gsl::span<const unsigned short> depth, gsl::span<color_bgra> output);
+	void visualize(gsl::span<const shift> shifts, gsl::span<color_bgra> output);
+
+	int get_width() const;
+	int get_height() const;
+	int get_pattern_width() const;
+	int get_pattern_div() const;
+
+private:
+	int width = 0;
+	int height = 0;
+
+	int pattern_width = 0;
+	int pattern_div = 12;
+
+	random_generator generator;
+	unsigned int pattern_index = 0;
+	unsigned int pattern_seed = 0;
+
+	std::vector<unsigned long long> row_hashes;
+	bool row_hashes_valid = false;
+
+	thread_pool* pool = nullptr;
+	int chunk_rows = 0;
+
+	simd::instruction_set instruction_set = simd::detect();
+
+	bool fused_rows = true;
+	std::vector<int> frame_shifts;
+
+	void for_each_rows(const std::function<void(int begin, int end)>& callback);
+
+	void validate_buffers(std::ptrdiff_t depth_size, std::ptrdiff_t output_size) const;
+	void fill_pattern(color* row, int y) const;
+	void fill_pattern(color_bgra* row, int y) const;
+
+	template <typename P>
+	void prepare_color_buffer(P* output, int begin, int end) const;
+
+	template <typename T, typename P>
+	void synthesize(const T* depth, P* output);
+
+	template <typename T, typename P>
+	void synthesize_passes(const T* depth, P* output);
+
+	template <typename T, typename P>
+	int synthesize_changed(const T* depth, P* output, std::vector<unsigned char>& dirty_rows);
+
+	template <typename T, typename P>
+	void visualize(const T* depth, P* output);
+
+	template <typename T, typename P>
+	void fill_color_buffer(const T* depth, P* output, int begin, int end) const;
+
+	template <typename T, typename P>
+	void fill_color_buffer_scalar(const T* depth, P* output, int begin, int end) const;
+
+	void convert_depth_row(const float* depth, int* shifts, int count) const;
+	void convert_depth_row(const unsigned char* depth, int* shifts, int count) const;
+	void convert_depth_row(const unsigned short* depth, int* shifts, int count) const;
+	void convert_depth_row(const shift* depth, int* shifts, int count) const;
+
+	void copy_pixels(color* row, const int* shifts) const;
+	void copy_pixels(color_bgra* row, const int* shifts) const;
+
+	template <typename T>
+	void fill_depth_view(const T* depth, color* output, int begin, int end) const;
+
+	template <typename T>
+	void fill_depth_view(const T* depth, color_bgra* output, int begin, int end) const;
+
+	template <typename T>
+	unsigned int get_level(T value) const;
+	unsigned int get_level(shift value) const;
+
+	static unsigned long long hash_row(const void* data, size_t size);
+
+	static unsigned int get_depth_value(float value);
+	static unsigned int get_depth_value(unsigned char value);
+	static unsigned int get_depth_value(unsigned short value);
+};
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "std_include.hpp"
+
+#include "thread_pool.hpp"
+
+thread_pool::thread_pool(unsigned int thread_count)
+{
+	if (!thread_count)
+	{
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// The calling thread always participates, so one less worker is needed
+	for (unsigned int i = 1; i < thread_count; ++i)
+	{
+		this->threads.emplace_back([this]()
+		{
+			this->worker();
+		});
+	}
+}
+
+thread_pool::~thread_pool()
+{
+	{
+		std::lock_guard<std::mutex> _(this->mutex);
+		this->stopping = true;
+	}
+
+	this->work_available.notify_all();
+
+	for (auto& thread : this->threads)
+	{
+		thread.join();
+	}
+}
+
+unsigned int thread_pool::get_thread_count() const
+{
+	return static_cast<unsigned int>(this->threads.size() + 1);
+}
+
+void thread_pool::parallel_for(int count, int chunk_size, const std::function<void(int, int)>& callback)
+{
+	if (count <= 0) return;
+
+	if (chunk_size <= 0)
+	{
+		// A few chunks per thread balance uneven rows without too much scheduling overhead
+		chunk_size = std::max(1, count / static_cast<int>(this->get_thread_count() * 4));
+	}
+
+	if (this->threads.empty() || chunk_size >= count)
+	{
+		callback(0, count);
+		return;
+	}
+
+	std::lock_guard<std::mutex> submit_lock(this->submit_mutex);
+
+	{
+		std::lock_guard<std::mutex> _(this->mutex);
+
+		this->task = &callback;
+		this->task_count = count;
+		this->task_chunk_size = chunk_size;
+		this->next_chunk = 0;
+		this->busy_workers = static_cast<unsigned int>(this->threads.size());
+		++this->generation;
+	}
+
+	this->work_available.notify_all();
+	this->run_chunks();
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->work_done.wait(lock, [this]()
+	{
+		return this->busy_workers == 0;
+	});
+
+	this->task = nullptr;
+
+	if (this->task_exception)
+	{
+		auto exception = this->task_exception;
+		this->task_exception = nullptr;
+
+		std::rethrow_exception(exception);
+	}
+}
+
+void thread_pool::worker()
+{
+	unsigned long long last_generation = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->work_available.wait(lock, [&]()
+			{
+				return this->stopping || this->generation != last_generation;
+			});
+
+			if (this->stopping) return;
+			last_generation = this->generation;
+		}
+
+		this->run_chunks();
+
+		{
+			std::lock_guard<std::mutex> _(this->mutex);
+			if (--this->busy_workers) continue;
+		}
+
+		this->work_done.notify_one();
+	}
+}
+
+void thread_pool::run_chunks()
+{
+	while (true)
+	{
+		const auto begin = this->next_chunk.fetch_add(this->task_chunk_size);
+		if (begin >= this->task_count) break;
+
+		try
+		{
+			(*this->task)(begin, std::min(begin + this->task_chunk_size, this->task_count));
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> _(this->mutex);
+			if (!this->task_exception) this->task_exception = std::current_exception();
+
+			// Skip the remaining chunks
+			this->next_chunk = this->task_count;
+		}
+	}
+}
\ No newline at end of file
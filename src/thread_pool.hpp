@@ -0,0 +1,37 @@
+#pragma once
+
+class thread_pool
+{
+public:
+	// A thread count of 0 uses all hardware threads
+	thread_pool(unsigned int thread_count = 0);
+	~thread_pool();
+
+	unsigned int get_thread_count() const;
+
+	// Splits [0, count) into chunks and runs them on the pool and the calling thread.
+	// Blocks until every chunk is done. A chunk size of 0 picks one automatically.
+	void parallel_for(int count, int chunk_size, const std::function<void(int begin, int end)>& callback);
+
+private:
+	std::vector<std::thread> threads;
+
+	std::mutex submit_mutex;
+
+	std::mutex mutex;
+	std::condition_variable work_available;
+	std::condition_variable work_done;
+
+	bool stopping = false;
+	unsigned long long generation = 0;
+	unsigned int busy_workers = 0;
+
+	const std::function<void(int, int)>* task = nullptr;
+	int task_count = 0;
+	int task_chunk_size = 0;
+	std::atomic<int> next_chunk = 0;
+	std::exception_ptr task_exception;
+
+	void worker();
+	void run_chunks();
+};
\ No newline at end of file
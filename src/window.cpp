@@ -1,6 +1,7 @@
 #include "std_include.hpp"
 
 #include "window.hpp"
+#include "gl_state.hpp"
 
 window::window(int width, int height, const std::string& title)
 {
@@ -38,11 +39,15 @@ void window::init_glew()
 
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LESS);
+
+	// Every state change from here on goes through gl_state
+	gl_state::initialize();
 }
 
 void window::create(int width, int height, const std::string& title)
 {
-	glfwWindowHint(GLFW_SAMPLES, 4);
+	// No multisampling, depth is copied into textures and multisampled buffers can't be copied directly
+	glfwWindowHint(GLFW_SAMPLES, 0);
 	glfwWindowHint(GLFW_DEPTH_BITS, 32);
 
 	this->handle = glfwCreateWindow(width, height, title.data(), NULL, NULL);
@@ -72,7 +77,7 @@ void window::create(int width, int height, const std::string& title)
 
 void window::size_callback(int width, int height)
 {
-	glViewport(0, 0, width, height);
+	gl_state::set_viewport({ 0, 0, width, height });
 }
 
 void window::size_callback_static(GLFWwindow* _window, int width, int height)
@@ -85,9 +90,19 @@ void window::show()
 	while (this->handle && !glfwWindowShouldClose(this->handle))
 	{
 		this->update_frame_times();
+		gl_state::begin_frame();
+
+		if (this->frame_profiler) this->frame_profiler->begin_frame();
+
 		this->list.paint();
 
-		glfwSwapBuffers(this->handle);
+		{
+			profiler::scope _(this->frame_profiler, "swap_buffers");
+			glfwSwapBuffers(this->handle);
+		}
+
+		if (this->frame_profiler) this->frame_profiler->end_frame();
+
 		glfwPollEvents();
 	}
 }
@@ -97,11 +112,22 @@ painter_list* window::get_painter_list()
 	return &this->list;
 }
 
+void window::set_profiler(profiler* _frame_profiler)
+{
+	this->frame_profiler = _frame_profiler;
+	this->list.set_profiler(_frame_profiler);
+}
+
 bool window::is_key_pressed(int key)
 {
 	return glfwGetKey(*this, key) == GLFW_PRESS;
 }
 
+void window::set_title(const std::string& title)
+{
+	glfwSetWindowTitle(this->handle, title.data());
+}
+
 long long window::get_last_frame_time()
 {
 	return this->last_frame_time;
@@ -112,4 +138,4 @@ void window::update_frame_times()
 	auto now = std::chrono::system_clock::now();
 	this->last_frame_time = std::chrono::duration_cast<std::chrono::microseconds>(now - this->last_frame).count();
 	this->last_frame = now;
-}
+}
\ No newline at end of file
@@ -14,14 +14,20 @@ public:
 
 	painter_list* get_painter_list();
 
+	// Every shown frame is a profiler frame, with the buffer swap as its own stage
+	void set_profiler(profiler* frame_profiler);
+
 	bool is_key_pressed(int key);
 
+	void set_title(const std::string& title);
+
 	long long get_last_frame_time();
 
 private:
 	GLFWwindow* handle = nullptr;
 
 	painter_list list;
+	profiler* frame_profiler = nullptr;
 
 	long long last_frame_time;
 	std::chrono::system_clock::time_point last_frame = std::chrono::system_clock::now();
@@ -35,4 +41,4 @@ private:
 
 	void size_callback(int width, int height);
 	static void size_callback_static(GLFWwindow* window, int width, int height);
-};
+};
\ No newline at end of file